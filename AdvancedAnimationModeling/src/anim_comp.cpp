@@ -9,79 +9,82 @@
 #include <string>
 #include "resources.h"
 #include "node.h"
-#include "transform.h"
+#include "transform_hierarchy.h"
 #include "debug.h"
 #include "scene_graph.h"
 #include "clock.h"
+#include "animation_system.h"
 #include <iostream>
+#include <cassert>
 
 namespace cs460 {
 void anim_comp::initialize()
 {
-}
-
-void anim_comp::update()
-{
-	if (m_use_blend_tree)
-		blend_tree_update();
-	else
-		default_update();
+	m_player = g_animation_system.add_player(this);
 }
 
 void anim_comp::destroy()
 {
 	m_blend_tree.destroy();
+	g_animation_system.remove_player(m_player);
+	m_player = -1;
 }
 
 void anim_comp::imgui()
 {
 	// Get the animations of the model
 	const std::vector<animation>& anims = g_resources.get_model_rsc(get_owner()->m_model).m_anims;
+	anim_player& p = g_animation_system.get_player(m_player);
 
 	ImGui::Text("Animation");
-	if (m_play)
+	if (p.m_play)
 	{
 		if (ImGui::Button("Pause"))
-			m_play = false;
+			p.m_play = false;
 	}
 	else
 	{
 		if (ImGui::Button("Play"))
-			m_play = true;
+			p.m_play = true;
 	}
 
 	ImGui::SameLine();
 	if (ImGui::Button("Reset"))
 	{
-		m_anim_time = m_start_time;
+		p.m_time = p.m_start_time;
 	}
 
 	ImGui::SameLine();
-	ImGui::Checkbox("Loop", &m_loop);
+	ImGui::Checkbox("Loop", &p.m_loop);
 	
 	ImGui::SameLine();
-	ImGui::Checkbox("Nlerp", &m_nlerp);
+	ImGui::Checkbox("Nlerp", &p.m_nlerp);
+
+	ImGui::SameLine();
+	ImGui::Checkbox("Baked", &p.m_baked);
 
-	ImGui::SliderFloat("Animation Time", &m_anim_time, m_start_time, m_end_time);
+	ImGui::SliderFloat("Animation Time", &p.m_time, p.m_start_time, p.m_end_time);
+	ImGui::SliderFloat("Blend Time", &p.m_blend_time, 0.0f, 1.0f);
 
-	if (m_use_blend_tree)
+	layers_imgui();
+
+	if (p.m_blend_tree)
 	{
 		m_blend_tree.imgui();
 		return;
 	}
 
-	if (ImGui::BeginCombo("Set Animation", m_anim < 0 ? "none" : anims[m_anim].m_name.c_str()))
+	if (ImGui::BeginCombo("Set Animation", p.m_anim < 0 ? "none" : anims[p.m_anim].m_name.c_str()))
 	{
 		if (ImGui::Selectable("none"))
-			m_anim = -1;
+			set_animation(-1);
 
 		size_t n_anims = anims.size();
 		for (size_t i = 0; i < n_anims; ++i)
 		{
 			if (ImGui::Selectable(anims[i].m_name.c_str()))
 			{
-				m_anim = (int)i;
-				set_animation();
+				set_animation((int)i);
 				break;
 			}
 		}
@@ -91,25 +94,40 @@ void anim_comp::imgui()
 
 void anim_comp::set_animation(int anim_idx)
 {
-	m_anim = anim_idx;
+	anim_player& p = g_animation_system.get_player(m_player);
+	p.m_model = get_owner()->m_model;
+	p.m_anim = anim_idx;
 	set_animation();
 }
 
 void anim_comp::set_anim_factor(float factor)
 {
-	m_anim_factor = factor;
+	g_animation_system.get_player(m_player).m_factor = factor;
+}
+
+void anim_comp::set_blend_time(float seconds)
+{
+	g_animation_system.get_player(m_player).m_blend_time = glm::max(seconds, 0.0f);
 }
 
 void anim_comp::set_1d_blend_tree()
 {
-	m_use_blend_tree = true;
+	anim_player& p = g_animation_system.get_player(m_player);
+	p.m_model = get_owner()->m_model;
+	p.m_blend_tree = true;
+	g_animation_system.set_dirty();
 	m_blend_tree.create_1d_blend_tree();
+	start_transition();
 }
 
 void anim_comp::set_2d_blend_tree()
 {
-	m_use_blend_tree = true;
+	anim_player& p = g_animation_system.get_player(m_player);
+	p.m_model = get_owner()->m_model;
+	p.m_blend_tree = true;
+	g_animation_system.set_dirty();
 	m_blend_tree.create_2d_blend_tree();
+	start_transition();
 }
 
 void anim_comp::insert_blend_node(int anim_idx, const glm::vec2& blend_pos)
@@ -122,102 +140,172 @@ void anim_comp::set_blend_tree_param(const glm::vec2& param)
 	m_blend_tree.set_blend_param(param);
 }
 
-void anim_comp::default_update()
+int anim_comp::add_layer(int anim_idx, int mask_root, bool additive, float weight)
 {
-	if (m_anim >= 0)
-	{
-		// Get the animation
-		int model_idx = get_owner()->m_model;
-		int inst_idx = get_owner()->m_model_inst;
-		const animation& anim = g_resources.get_model_rsc(model_idx).m_anims[m_anim];
+	anim_player& p = g_animation_system.get_player(m_player);
+	p.m_model = get_owner()->m_model;
+	p.m_layers.emplace_back();
+
+	anim_layer& layer = p.m_layers.back();
+	layer.m_anim = anim_idx;
+	layer.m_mask_root = mask_root;
+	layer.m_additive = additive;
+	layer.m_weight = weight;
+	return (int)p.m_layers.size() - 1;
+}
 
-		// Update animation timer
-		if (m_play)
-		{
-			if (m_anim_time <= m_end_time)
-				m_anim_time += m_anim_factor * g_clock.dt();
+void anim_comp::remove_layer(int layer)
+{
+	std::vector<anim_layer>& layers = g_animation_system.get_player(m_player).m_layers;
+	if (layer >= 0 && layer < (int)layers.size())
+		layers.erase(layers.begin() + layer);
+}
 
-			if (m_loop && m_anim_time > m_end_time)
-				m_anim_time = m_start_time;
-		}
+void anim_comp::set_layer_weight(int layer, float weight)
+{
+	std::vector<anim_layer>& layers = g_animation_system.get_player(m_player).m_layers;
+	if (layer >= 0 && layer < (int)layers.size())
+		layers[layer].m_weight = weight;
+}
 
-		// Get channel and samplers of the animation
-		const auto& channels = anim.m_chanels;
-		const auto& samplers = anim.m_samplers;
+void anim_comp::layers_imgui()
+{
+	anim_player& p = g_animation_system.get_player(m_player);
+	const model_rsc& model = g_resources.get_model_rsc(get_owner()->m_model);
+	if (!ImGui::TreeNode("Layers"))
+		return;
 
-		// Go through each channel
-		size_t n_channels = channels.size();
-		for (size_t i = 0; i < n_channels; ++i)
-		{
-			const auto& ch = channels[i];
-			const auto& sp = samplers.at(ch.m_sampler);
+	int removed = -1;
+	int n_layers = (int)p.m_layers.size();
+	for (int i = 0; i < n_layers; ++i)
+	{
+		anim_layer& layer = p.m_layers[i];
+		ImGui::PushID(i);
 
-			// Get the node to interpolate
-			node* n = g_scene.get_model_node(model_idx, inst_idx, ch.m_node);
+		// Clip
+		const char* clip_name = layer.m_anim < 0 ? "none" : model.m_anims[layer.m_anim].m_name.c_str();
+		if (ImGui::BeginCombo("Clip", clip_name))
+		{
+			size_t n_anims = model.m_anims.size();
+			for (size_t a = 0; a < n_anims; ++a)
+			{
+				if (ImGui::Selectable(model.m_anims[a].m_name.c_str()))
+				{
+					layer.m_anim = (int)a;
+					layer.m_dirty = true;
+				}
+			}
+			ImGui::EndCombo();
+		}
 
-			// Interpolate node
-			if (ch.m_path_type == animation::channel::path_type::translation)
+		// Root of the mask
+		auto root = model.m_nodes.find(layer.m_mask_root);
+		if (ImGui::BeginCombo("Mask", root == model.m_nodes.end() ? "whole model" : root->second.m_name.c_str()))
+		{
+			if (ImGui::Selectable("whole model"))
 			{
-				n->m_local.set_position(ch.lerp_pos(m_anim_time, sp));
+				layer.m_mask_root = -1;
+				layer.m_dirty = true;
 			}
-			else if (ch.m_path_type == animation::channel::path_type::rotation)
+			for (const auto& n : model.m_nodes)
 			{
-				n->m_local.set_rotation(ch.lerp_rot(m_anim_time, sp, m_nlerp));
+				if (ImGui::Selectable(n.second.m_name.c_str()))
+				{
+					layer.m_mask_root = n.first;
+					layer.m_dirty = true;
+				}
 			}
-			else if (ch.m_path_type == animation::channel::path_type::scale)
+			ImGui::EndCombo();
+		}
+
+		// Channels of the mask
+		const char* names[] = { "T", "R", "S" };
+		const target_type types[] = { translation, rotation, scale };
+		for (int c = 0; c < 3; ++c)
+		{
+			bool on = (layer.m_mask_flags & types[c]) != 0;
+			if (c > 0)
+				ImGui::SameLine();
+			if (ImGui::Checkbox(names[c], &on))
 			{
-				n->m_local.set_scale(ch.lerp_pos(m_anim_time, sp));
+				layer.m_mask_flags = on ? (layer.m_mask_flags | types[c]) : (layer.m_mask_flags & ~types[c]);
+				layer.m_dirty = true;
 			}
 		}
+		ImGui::SameLine();
+		if (ImGui::Checkbox("Additive", &layer.m_additive))
+			layer.m_dirty = true;
+
+		ImGui::SliderFloat("Weight", &layer.m_weight, 0.0f, 1.0f);
+		ImGui::Text("%u joints sampled", layer.m_mask.joint_count());
+		if (ImGui::Button("Remove"))
+			removed = i;
+
+		ImGui::Separator();
+		ImGui::PopID();
 	}
+	if (removed >= 0)
+		remove_layer(removed);
+
+	if (ImGui::Button("Add Layer"))
+		add_layer(model.m_anims.empty() ? -1 : 0, -1);
+	ImGui::TreePop();
 }
 
-void anim_comp::blend_tree_update()
+void anim_comp::bind_nodes(const std::vector<node*>& nodes)
 {
-	if (m_play)
-		m_anim_time += g_clock.dt();
+	std::vector<transform_handle*>& bindings = g_animation_system.get_player(m_player).m_bindings;
+	bindings.assign(nodes.size(), nullptr);
+	for (size_t i = 0; i < nodes.size(); ++i)
+		if (nodes[i])
+			bindings[i] = &nodes[i]->m_local;
+}
 
+bool anim_comp::blend_tree_pose(float time, dense_pose& pose)
+{
 	// Get the final pose after blending
-	bool fail = false;
-	const anim_pose* final_pose = m_blend_tree.produce_pose(m_anim_time);
+	const dense_pose* final_pose = m_blend_tree.produce_pose(time);
 
 	// Check for errors
 	if (!final_pose)
-		return;
+		return false;
 
-	// Set the node transforms
-	auto end = final_pose->end();
-	int model_idx = get_owner()->m_model;
-	int instance_idx = get_owner()->m_model_inst;
-	for (auto it = final_pose->begin(); it != end; ++it)
+	// Trees that produced no pose leave the joints untouched
+	if (final_pose->size() == 0)
 	{
-		// Find the node and get its transform
-		node* n = g_scene.get_model_node(model_idx, instance_idx, it->first);
-		transform& tr = n->m_local;
-
-		// Get the blend data
-		const transform& blend_tr = it->second.first;
-		unsigned char flags = it->second.second;
-
-		// Set the translation
-		if ((flags & target_type::translation) != 0)
-			tr.set_position(blend_tr.get_position());
+		pose.clear();
+		return true;
+	}
 
-		// Set the orientation
-		if ((flags & target_type::rotation) != 0)
-			tr.set_rotation(blend_tr.get_rotation());
+	// The poses of the tree are sized for the model of its clips
+	assert(final_pose->size() == pose.size());
+	if (final_pose->size() != pose.size())
+		return false;
+	pose = *final_pose;
+	return true;
+}
 
-		// Set the scale
-		if ((flags & target_type::scale) != 0)
-			tr.set_scale(blend_tr.get_scale());
+void anim_comp::set_animation()
+{
+	anim_player& p = g_animation_system.get_player(m_player);
+	const model_rsc& model = g_resources.get_model_rsc(p.m_model);
+	if (p.m_anim >= 0)
+	{
+		p.m_end_time = model.m_anims.at(p.m_anim).m_max_time;
+		p.m_context.reset(model.m_anims.at(p.m_anim).m_chanels.size());
+		p.m_baked_cursor = 1;
 	}
+	p.m_start_time = 0.0f;
+
+	// The player moves to the group of its new clip
+	g_animation_system.set_dirty();
+	start_transition();
 }
 
-void anim_comp::set_animation()
+void anim_comp::start_transition()
 {
-	const model_rsc& model = g_resources.get_model_rsc(get_owner()->m_model);
-	if (m_anim >= 0)
-		m_end_time = model.m_anims.at(m_anim).m_max_time;
-	m_start_time = 0.0f;
+	// Nothing shown yet, nothing to smooth
+	anim_player& p = g_animation_system.get_player(m_player);
+	p.m_transition = p.m_blend_time > 0.0f && p.m_pose.size() > 0;
 }
 }
\ No newline at end of file
@@ -15,16 +15,21 @@ namespace cs460 {
 struct node_rsc;
 struct model_rsc;
 class blend_tree;
+struct anim_player;
+
+// Handle to the player of a model instance in the animation system
 struct anim_comp : public component
 {
 	virtual void initialize();
-	virtual void update();
 	virtual void destroy();
 	virtual void imgui();
 
 	void set_animation(int anim_idx);
 	void set_anim_factor(float factor);
 
+	// Seconds the switch to another animation or blend tree is smoothed for (0 snaps)
+	void set_blend_time(float seconds);
+
 	void set_1d_blend_tree();
 	void set_2d_blend_tree();
 
@@ -32,22 +37,33 @@ struct anim_comp : public component
 
 	void set_blend_tree_param(const glm::vec2& param);
 
+	// Layers blended over the animation or the blend tree, returns the index of the new one.
+	// The mask is the subtree of mask_root (-1 for the whole model)
+	int add_layer(int anim_idx, int mask_root, bool additive = false, float weight = 1.0f);
+	void remove_layer(int layer);
+	void set_layer_weight(int layer, float weight);
+
 	const blend_tree& get_blend_tree() { return m_blend_tree; }
 
+	// Builds the table that maps each node of the model to its transform in this instance.
+	// The nodes are indexed by gltf node index, null if missing
+	void bind_nodes(const std::vector<node*>& nodes);
+
+	int get_player() const { return m_player; }
+
 private:
-	void default_update();
-	void blend_tree_update();
+	friend class animation_system;
+
+	// Writes the pose of the blend tree into a dense pose sized for the model
+	bool blend_tree_pose(float time, dense_pose& pose);
 	void set_animation();
+	void layers_imgui();
+
+	// Smooths the switch that just happened
+	void start_transition();
 	blend_tree m_blend_tree;
-	bool m_use_blend_tree = false;
-
-	bool m_nlerp = false;
-	bool m_play = true;
-	float m_anim_time = 0.0f;
-	bool m_loop = true;
-	int m_anim = -1;
-	float m_start_time = 0.0f;
-	float m_end_time = 0.0f;
-	float m_anim_factor = 1.0f;
+
+	// Handle of the player in the animation system
+	int m_player = -1;
 };
 }
\ No newline at end of file
@@ -0,0 +1,586 @@
+/**
+* @file animation_system.cpp
+* @date 2026/10/17
+*/
+#include "animation_system.h"
+#include "anim_comp.h"
+#include "transform_hierarchy.h"
+#include "job_system.h"
+#include "blending.h"
+#include "pose_cache.h"
+#include "node.h"
+#include <imgui.h>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+
+namespace cs460 {
+animation_system& animation_system::get_instance()
+{
+	static animation_system a;
+	return a;
+}
+
+animation_system::animation_system()
+{
+	// Full detail, then lower rates and fewer joints as the instance shrinks on screen
+	m_lods[0] = { 0.25f, 1, true, -1, false };
+	m_lods[1] = { 0.1f, 2, true, 0, false };
+	m_lods[2] = { 0.04f, 4, true, 1, true };
+	m_lods[3] = { 0.0f, 8, false, 2, true };
+}
+
+int animation_system::add_player(anim_comp* comp)
+{
+	// Reuse a free handle
+	int handle;
+	if (!m_free_handles.empty())
+	{
+		handle = m_free_handles.back();
+		m_free_handles.pop_back();
+	}
+	else
+	{
+		handle = (int)m_slots.size();
+		m_slots.push_back(-1);
+	}
+
+	// Append the player
+	m_slots[handle] = (int)m_players.size();
+	m_players.emplace_back();
+	m_players.back().m_comp = comp;
+	m_handles.push_back(handle);
+
+	m_sorted = false;
+	return handle;
+}
+
+void animation_system::remove_player(int handle)
+{
+	if (handle < 0 || handle >= (int)m_slots.size() || m_slots[handle] < 0)
+		return;
+
+	// Move the last player into the hole
+	int slot = m_slots[handle];
+	int last = (int)m_players.size() - 1;
+	if (slot != last)
+	{
+		m_players[slot] = std::move(m_players[last]);
+		m_handles[slot] = m_handles[last];
+		m_slots[m_handles[slot]] = slot;
+	}
+	m_players.pop_back();
+	m_handles.pop_back();
+
+	m_slots[handle] = -1;
+	m_free_handles.push_back(handle);
+	m_sorted = false;
+}
+
+void animation_system::update(float dt)
+{
+	if (!m_sorted)
+		sort_players();
+
+	g_pose_cache.begin_frame();
+	schedule_players();
+
+	// Each player only writes its own instance, so chunks run in parallel
+	g_jobs.parallel_for(m_players.size(), 32, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			update_player(m_players[i], dt);
+	});
+}
+
+void animation_system::update_player(int handle, float dt)
+{
+	anim_player& p = get_player(handle);
+	p.m_lod = 0;
+	p.m_sample = true;
+	p.m_heights = nullptr;
+	update_player(p, dt);
+}
+
+void animation_system::sort_players()
+{
+	// Clip players grouped by (model, clip), blend trees at the end
+	size_t n_players = m_players.size();
+	std::vector<int> order(n_players);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+		const anim_player& pa = m_players[a];
+		const anim_player& pb = m_players[b];
+		if (pa.m_blend_tree != pb.m_blend_tree)
+			return pb.m_blend_tree;
+		if (pa.m_model != pb.m_model)
+			return pa.m_model < pb.m_model;
+		return pa.m_anim < pb.m_anim;
+	});
+
+	// Reorder the packed arrays
+	std::vector<anim_player> players(n_players);
+	std::vector<int> handles(n_players);
+	for (size_t i = 0; i < n_players; ++i)
+	{
+		players[i] = std::move(m_players[order[i]]);
+		handles[i] = m_handles[order[i]];
+		m_slots[handles[i]] = (int)i;
+	}
+	m_players.swap(players);
+	m_handles.swap(handles);
+
+	m_sorted = true;
+}
+
+void animation_system::update_player(anim_player& p, float dt)
+{
+	if (!p.m_blend_tree && p.m_anim < 0)
+		return;
+
+	// Update animation timer
+	if (p.m_play)
+		p.m_time = advance_time(p, p.m_time, dt);
+
+	// Full rate, the last two poses are kept for the transitions
+	const anim_lod& lod = m_lods[p.m_lod];
+	if (lod.m_interval <= 1 && p.m_blend_time > 0.0f)
+	{
+		if (!p.m_sample)
+			return;
+
+		// The pose shown last frame becomes the previous one, and is where a transition starts from
+		std::swap(p.m_pose, p.m_pose_prev);
+		if (p.m_transition)
+			p.m_inertializer.begin(p.m_pose, p.m_pose_prev, p.m_last_dt, p.m_blend_time);
+		p.m_transition = false;
+
+		if (sample_player(p, p.m_time, p.m_pose))
+		{
+			p.m_inertializer.apply(p.m_pose, dt);
+			apply_pose(p, p.m_pose);
+		}
+		else
+			p.m_pose = p.m_pose_prev;
+		p.m_last_dt = dt;
+		return;
+	}
+
+	// Reduced detail snaps to the new clip
+	p.m_transition = false;
+	p.m_inertializer.stop();
+
+	// Full rate or held poses, the pose is sampled at the current time
+	if (lod.m_interval <= 1 || !lod.m_interpolate)
+	{
+		if (p.m_sample && sample_player(p, p.m_time, p.m_pose))
+			apply_pose(p, p.m_pose);
+		return;
+	}
+
+	// Reduced rate, sample the pose one interval ahead and interpolate toward it
+	// from the pose that was on screen
+	if (p.m_sample)
+	{
+		float span = lod.m_interval * dt;
+		float t = p.m_play ? advance_time(p, p.m_time, span) : p.m_time;
+		if (!sample_player(p, t, p.m_pose_to))
+			return;
+
+		if (p.m_pose.size() != p.m_pose_to.size())
+			p.m_pose = p.m_pose_to;
+		p.m_pose_from = p.m_pose;
+		p.m_lod_elapsed = 0.0f;
+		p.m_lod_span = p.m_play ? span : 0.0f;
+	}
+	if (p.m_pose_to.size() == 0)
+		return;
+
+	p.m_lod_elapsed += dt;
+	float alpha = p.m_lod_span > 0.0f ? glm::min(p.m_lod_elapsed / p.m_lod_span, 1.0f) : 1.0f;
+	lerp_poses(p.m_pose_from, p.m_pose_to, alpha, p.m_pose);
+	apply_pose(p, p.m_pose);
+}
+
+float animation_system::advance_time(const anim_player& p, float time, float dt) const
+{
+	// Blend trees wrap the time of each clip themselves
+	if (p.m_blend_tree)
+		return time + dt;
+
+	if (time <= p.m_end_time)
+		time += p.m_factor * dt;
+
+	if (p.m_loop && time > p.m_end_time)
+		time = p.m_start_time;
+	return time;
+}
+
+bool animation_system::sample_player(anim_player& p, float t, dense_pose& pose)
+{
+	const model_rsc& model = g_resources.get_model_rsc(p.m_model);
+	unsigned n_joints = (unsigned)p.m_bindings.size();
+	bool sampled = true;
+	if (!p.m_blend_tree)
+	{
+		// Reuse the pose of another instance at the same time. The cache samples every
+		// joint, so players that cull joints sample the clip themselves
+		int cull_height = p.m_heights ? m_lods[p.m_lod].m_cull_height : -1;
+		if (g_pose_cache.enabled() && cull_height < 0)
+		{
+			const dense_pose* cached = g_pose_cache.sample(p.m_model, p.m_anim, t, p.m_baked, p.m_nlerp, pose);
+			if (cached != &pose)
+				pose = *cached;
+		}
+		else
+			sample_clip(model.m_anims[p.m_anim], t, p.m_baked, p.m_nlerp, p.m_context, &p.m_baked_cursor, n_joints, pose, p.m_heights, cull_height);
+	}
+	else
+	{
+		// Far blend trees only sample the clip with the largest weight
+		blend_tree& tree = p.m_comp->m_blend_tree;
+		blend_node* leaf = m_lods[p.m_lod].m_single_clip ? tree.dominant_leaf() : nullptr;
+		if (leaf)
+		{
+			const animation& anim = g_resources.get_model_rsc(leaf->m_model).m_anims.at(leaf->m_anim);
+			float clip_t = anim.m_max_time > 0.0f ? t - glm::floor(t / anim.m_max_time) * anim.m_max_time : 0.0f;
+			sample_clip(anim, clip_t, p.m_baked, p.m_nlerp, leaf->m_context, &p.m_lod_cursor, n_joints, pose, p.m_heights, m_lods[p.m_lod].m_cull_height);
+		}
+		else
+		{
+			if (pose.size() != n_joints)
+				pose.resize(n_joints);
+			sampled = p.m_comp->blend_tree_pose(t, pose);
+		}
+	}
+
+	if (sampled && !p.m_layers.empty())
+		sample_layers(p, t, pose);
+	return sampled;
+}
+
+void animation_system::sample_layers(anim_player& p, float t, dense_pose& pose)
+{
+	const model_rsc& model = g_resources.get_model_rsc(p.m_model);
+	unsigned n_joints = (unsigned)p.m_bindings.size();
+	int cull_height = m_lods[p.m_lod].m_cull_height;
+	for (anim_layer& layer : p.m_layers)
+	{
+		if (layer.m_anim < 0 || layer.m_anim >= (int)model.m_anims.size() || layer.m_weight <= 0.0f)
+			continue;
+		const animation& anim = model.m_anims[layer.m_anim];
+
+		// The mask and the reference pose change with the clip and the skeleton
+		if (layer.m_dirty || layer.m_mask.size() != n_joints)
+		{
+			build_bone_mask(model, layer.m_mask_root, layer.m_mask_flags, n_joints, layer.m_mask);
+			layer.m_reference.clear();
+			if (layer.m_additive)
+			{
+				int cursor = 1;
+				sample_clip(anim, 0.0f, p.m_baked, p.m_nlerp, layer.m_context, &cursor, n_joints, layer.m_reference,
+					nullptr, -1, &layer.m_mask);
+			}
+			layer.m_dirty = false;
+		}
+		if (layer.m_mask.empty())
+			continue;
+
+		// Only the channels of the mask are sampled
+		float clip_t = anim.m_max_time > 0.0f ? t - glm::floor(t / anim.m_max_time) * anim.m_max_time : 0.0f;
+		sample_clip(anim, clip_t, p.m_baked, p.m_nlerp, layer.m_context, &layer.m_cursor, n_joints, layer.m_pose,
+			p.m_heights, cull_height, &layer.m_mask);
+		apply_layer(pose, layer.m_pose, layer.m_additive ? &layer.m_reference : nullptr, layer.m_mask, layer.m_weight);
+	}
+}
+
+void sample_clip(const animation& anim, float t, bool baked, bool nlerp, sampling_context& context, int* cursor,
+	unsigned n_joints, dense_pose& pose, const std::vector<unsigned char>* heights, int cull_height, const bone_mask* mask)
+{
+	// Sample every baked track at once
+	baked = baked && !anim.m_baked.empty();
+	if (baked)
+		anim.m_baked.sample(t, cursor, pose, mask);
+	else
+	{
+		if (pose.size() != n_joints)
+			pose.resize(n_joints);
+		pose.clear();
+	}
+
+	// Get channel and samplers of the animation
+	const auto& channels = anim.m_chanels;
+	const auto& samplers = anim.m_samplers;
+
+	// Go through each channel
+	size_t n_channels = channels.size();
+	for (size_t i = 0; i < n_channels; ++i)
+	{
+		const auto& ch = channels[i];
+		const auto& sp = samplers[ch.m_sampler];
+
+		// Cubic tracks are not baked
+		if (baked && sp.m_lerp_mode != animation::sampler::lerp_mode::cubic)
+			continue;
+		if (ch.m_node < 0 || ch.m_node >= (int)pose.size())
+			continue;
+
+		// Joints culled by the level of detail
+		if (heights && (*heights)[ch.m_node] <= cull_height)
+			continue;
+
+		// Channels out of the mask
+		if (mask)
+		{
+			unsigned char flags = (unsigned)ch.m_node < mask->size() ? mask->get_flags(ch.m_node) : 0;
+			if ((ch.m_path_type == animation::channel::path_type::translation && (flags & translation) == 0) ||
+				(ch.m_path_type == animation::channel::path_type::rotation && (flags & rotation) == 0) ||
+				(ch.m_path_type == animation::channel::path_type::scale && (flags & scale) == 0))
+				continue;
+		}
+
+		// Interpolate node
+		if (ch.m_path_type == animation::channel::path_type::translation)
+			pose.set_position(ch.m_node, ch.lerp_pos(t, sp, context.get_cursor(anim, i)));
+		else if (ch.m_path_type == animation::channel::path_type::rotation)
+			pose.set_rotation(ch.m_node, ch.lerp_rot(t, sp, nlerp, context.get_cursor(anim, i)));
+		else if (ch.m_path_type == animation::channel::path_type::scale)
+			pose.set_scale(ch.m_node, ch.lerp_pos(t, sp, context.get_cursor(anim, i)));
+	}
+}
+
+void build_bone_mask(const model_rsc& model, int root, unsigned char flags, unsigned n_joints, bone_mask& mask)
+{
+	mask.resize(n_joints);
+	if (root < 0)
+	{
+		for (unsigned j = 0; j < n_joints; ++j)
+			mask.include(j, flags);
+		mask.finalize();
+		return;
+	}
+
+	// Walk down the children of the root
+	std::vector<int> stack(1, root);
+	while (!stack.empty())
+	{
+		int node_idx = stack.back();
+		stack.pop_back();
+		auto it = model.m_nodes.find(node_idx);
+		if (it == model.m_nodes.end())
+			continue;
+
+		mask.include((unsigned)node_idx, flags);
+		for (int child : it->second.m_childs)
+			stack.push_back(child);
+	}
+	mask.finalize();
+}
+
+void animation_system::apply_pose(const anim_player& p, const dense_pose& pose)
+{
+	const std::vector<unsigned char>* heights = p.m_heights;
+	int cull_height = m_lods[p.m_lod].m_cull_height;
+
+	unsigned n_joints = glm::min(pose.size(), (unsigned)p.m_bindings.size());
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		unsigned char flags = pose.get_flags(j);
+		if (flags == 0 || !p.m_bindings[j])
+			continue;
+		if (heights && (*heights)[j] <= cull_height)
+			continue;
+
+		transform_handle* tr = p.m_bindings[j];
+		if ((flags & target_type::translation) != 0)
+			tr->set_position(pose.get_position(j));
+		if ((flags & target_type::rotation) != 0)
+			tr->set_rotation(pose.get_rotation(j));
+		if ((flags & target_type::scale) != 0)
+			tr->set_scale(pose.get_scale(j));
+	}
+}
+
+void animation_system::schedule_players()
+{
+	for (int l = 0; l < s_n_lods; ++l)
+		m_stats[l] = anim_lod_stats();
+
+	// Models imported since the last frame
+	if ((int)m_model_lods.size() < g_resources.model_count())
+		m_model_lods.resize(g_resources.model_count());
+
+	m_due.clear();
+	size_t n_players = m_players.size();
+	for (size_t i = 0; i < n_players; ++i)
+	{
+		anim_player& p = m_players[i];
+		p.m_sample = false;
+		if (p.m_model < 0 || (!p.m_blend_tree && p.m_anim < 0))
+			continue;
+
+		// Pick the level from the projected size
+		int lod = 0;
+		if (m_lod_enabled)
+		{
+			p.m_size = projected_size(p);
+			while (lod + 1 < s_n_lods && p.m_size < m_lods[lod].m_min_size)
+				++lod;
+		}
+		p.m_heights = lod > 0 ? &get_model_lod(p.m_model).m_heights : nullptr;
+
+		// Players of a level sample on different frames, spread by handle
+		int interval = glm::max(m_lods[lod].m_interval, 1);
+		bool due = lod != p.m_lod || p.m_pose.size() == 0 || (m_frame + m_handles[i]) % interval == 0;
+
+		// Hold the pose on screen until the new level samples
+		if (lod != p.m_lod && lod > 0)
+		{
+			p.m_pose_from = p.m_pose;
+			p.m_pose_to = p.m_pose;
+			p.m_lod_span = 0.0f;
+		}
+		p.m_lod = lod;
+
+		// Postponed players stay due until they sample
+		++p.m_lod_frames;
+		due = due || p.m_lod_frames >= interval;
+
+		m_stats[lod].m_players++;
+		if (due)
+			m_due.push_back((int)i);
+		else if (m_lods[lod].m_interpolate && interval > 1)
+			m_stats[lod].m_interpolated++;
+		else
+			m_stats[lod].m_held++;
+	}
+	++m_frame;
+
+	// Most significant players first, boosted by how late they are
+	if (m_budget > 0)
+	{
+		std::stable_sort(m_due.begin(), m_due.end(), [this](int a, int b) {
+			const anim_player& pa = m_players[a];
+			const anim_player& pb = m_players[b];
+			float sa = pa.m_size * pa.m_lod_frames / m_lods[pa.m_lod].m_interval;
+			float sb = pb.m_size * pb.m_lod_frames / m_lods[pb.m_lod].m_interval;
+			return sa > sb;
+		});
+	}
+
+	int joints = 0;
+	for (int i : m_due)
+	{
+		anim_player& p = m_players[i];
+		int cost = (int)p.m_bindings.size();
+		if (m_budget > 0 && joints > 0 && joints + cost > m_budget)
+		{
+			m_stats[p.m_lod].m_postponed++;
+			continue;
+		}
+
+		p.m_sample = true;
+		p.m_lod_frames = 0;
+		joints += cost;
+		m_stats[p.m_lod].m_sampled++;
+		m_stats[p.m_lod].m_joints += cost;
+	}
+}
+
+float animation_system::projected_size(const anim_player& p)
+{
+	// Bounding sphere of the instance
+	const transform_handle& world = p.m_comp->get_owner()->m_world;
+	glm::vec3 scale = glm::abs(world.get_scale());
+	float radius = get_model_lod(p.m_model).m_radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+	glm::vec3 center = world.get_position();
+
+	// Behind the camera
+	glm::vec4 c = m_view * glm::vec4(center, 1.0f);
+	glm::vec4 top = m_view * glm::vec4(center + glm::vec3(0.0f, radius, 0.0f), 1.0f);
+	if (c.w <= 0.0f || top.w <= 0.0f)
+		return 0.0f;
+
+	// Height of the sphere in normalized device coordinates (the screen is 2 units tall)
+	return glm::abs(top.y / top.w - c.y / c.w) * 0.5f;
+}
+
+const animation_system::model_lod& animation_system::get_model_lod(int model)
+{
+	model_lod& m = m_model_lods[model];
+	if (m.m_ready)
+		return m;
+	m.m_ready = true;
+
+	const model_rsc& rsc = g_resources.get_model_rsc(model);
+
+	// Radius of the mesh bounds
+	float radius = 0.0f;
+	for (const mesh& me : rsc.m_meshes)
+	{
+		if (me.m_max_vertex.x >= me.m_min_vertex.x)
+			radius = glm::max(radius, 0.5f * glm::length(me.m_max_vertex - me.m_min_vertex));
+	}
+	if (radius > 0.0f)
+		m.m_radius = radius;
+
+	// Height of the subtree below each node (0 for leaves such as fingers)
+	int n_nodes = 0;
+	for (const auto& n : rsc.m_nodes)
+		n_nodes = glm::max(n_nodes, n.first + 1);
+	m.m_heights.assign(n_nodes, 0);
+
+	std::function<int(int)> height = [&](int idx) {
+		int h = 0;
+		auto it = rsc.m_nodes.find(idx);
+		if (it != rsc.m_nodes.end())
+		{
+			for (int child : it->second.m_childs)
+				h = glm::max(h, height(child) + 1);
+		}
+		m.m_heights[idx] = (unsigned char)glm::min(h, 255);
+		return h;
+	};
+	for (int root : rsc.m_root_nodes)
+		height(root);
+
+	return m;
+}
+
+void animation_system::imgui()
+{
+	bool open = true;
+	ImGui::Begin("Animation LOD", &open, ImGuiWindowFlags_NoMove);
+
+	ImGui::Checkbox("Enabled", &m_lod_enabled);
+	ImGui::SliderInt("Joint budget", &m_budget, 0, 20000);
+
+	// Settings of each level
+	for (int l = 0; l < s_n_lods; ++l)
+	{
+		anim_lod& lod = m_lods[l];
+		ImGui::PushID(l);
+		if (ImGui::TreeNode("lod", "LOD %d", l))
+		{
+			if (l + 1 < s_n_lods)
+				ImGui::SliderFloat("min size", &lod.m_min_size, 0.0f, 1.0f);
+			ImGui::SliderInt("interval", &lod.m_interval, 1, 16);
+			ImGui::Checkbox("interpolate", &lod.m_interpolate);
+			ImGui::SliderInt("cull height", &lod.m_cull_height, -1, 4);
+			ImGui::Checkbox("single clip", &lod.m_single_clip);
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+
+	// Counters of the last frame
+	ImGui::Separator();
+	ImGui::Text("lod  players  sampled  interp  held  postponed  joints");
+	for (int l = 0; l < s_n_lods; ++l)
+	{
+		const anim_lod_stats& st = m_stats[l];
+		ImGui::Text("%3d  %7d  %7d  %6d  %4d  %9d  %6d", l, st.m_players, st.m_sampled, st.m_interpolated, st.m_held, st.m_postponed, st.m_joints);
+	}
+
+	ImGui::End();
+}
+}
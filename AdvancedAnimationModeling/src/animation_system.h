@@ -0,0 +1,209 @@
+/**
+* @file animation_system.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include "resources.h"
+#include "pose.h"
+#include "inertialization.h"
+
+namespace cs460 {
+struct anim_comp;
+class transform_handle;
+
+// Clip played on top of the pose of a player for the joints of a mask, for
+// example an upper body aim over a run. Only the masked channels are sampled
+struct anim_layer
+{
+	int m_anim = -1;
+	float m_weight = 1.0f;
+	bool m_additive = false;	// Adds the difference from the first key instead of overriding
+
+	// Subtree of this gltf node (-1 for the whole model) and its T, R, S flags
+	int m_mask_root = -1;
+	unsigned char m_mask_flags = translation | rotation | scale;
+	bone_mask m_mask;
+	bool m_dirty = true;		// The mask or the reference pose have to be built again
+
+	sampling_context m_context;
+	int m_cursor = 1;
+	dense_pose m_pose;
+	dense_pose m_reference;		// First key of the clip (additive layers)
+};
+
+// Playback state of an animated model instance
+struct anim_player
+{
+	anim_comp* m_comp = nullptr;
+	int m_model = -1;
+	int m_anim = -1;
+
+	// Clock
+	float m_time = 0.0f;
+	float m_start_time = 0.0f;
+	float m_end_time = 0.0f;
+	float m_factor = 1.0f;
+	bool m_play = true;
+	bool m_loop = true;
+
+	// Sampling
+	bool m_nlerp = false;
+	bool m_baked = true;
+	bool m_blend_tree = false;
+	sampling_context m_context;
+	dense_pose m_pose;
+	int m_baked_cursor = 1;
+
+	// Level of detail
+	int m_lod = 0;
+	float m_size = 1.0f;		// Projected size, fraction of the screen height
+	int m_lod_frames = 0;		// Frames since the last sample
+	bool m_sample = true;		// Scheduled to sample this frame
+	float m_lod_elapsed = 0.0f;	// Time since the last sample
+	float m_lod_span = 0.0f;	// Time between the two sampled poses
+	dense_pose m_pose_from;		// Pose shown when the last sample was taken
+	dense_pose m_pose_to;		// Pose sampled one update interval ahead
+	int m_lod_cursor = 1;		// Baked cursor of the clip that replaces the blend tree
+	const std::vector<unsigned char>* m_heights = nullptr;
+
+	// Local transform of each node of the instance, indexed by gltf node (null if missing)
+	std::vector<transform_handle*> m_bindings;
+
+	// Layers blended over the pose in order
+	std::vector<anim_layer> m_layers;
+
+	// Transitions, seconds the switch to a new clip or blend tree is smoothed for (0 snaps)
+	float m_blend_time = 0.2f;
+	bool m_transition = false;	// Switched since the last sample
+	dense_pose m_pose_prev;		// Pose shown the frame before m_pose
+	float m_last_dt = 0.0f;		// Time between them
+	inertializer m_inertializer;
+};
+
+// Samples a clip at time t into a dense pose of n_joints slots, through the baked
+// tracks if baked is set. Joints whose subtree is at most cull_height deep are skipped,
+// and so are the channels out of the mask if there is one
+void sample_clip(const animation& anim, float t, bool baked, bool nlerp, sampling_context& context, int* cursor,
+	unsigned n_joints, dense_pose& pose, const std::vector<unsigned char>* heights = nullptr, int cull_height = -1,
+	const bone_mask* mask = nullptr);
+
+// Mask of n_joints slots with the channels in flags of the subtree of a node (-1 for every node)
+void build_bone_mask(const model_rsc& model, int root, unsigned char flags, unsigned n_joints, bone_mask& mask);
+
+// Animation level of detail
+struct anim_lod
+{
+	float m_min_size;	// Smallest projected size (fraction of the screen height) that uses this level
+	int m_interval;		// Frames between samples
+	bool m_interpolate;	// Interpolate the frames between samples (otherwise the last pose is held)
+	int m_cull_height;	// Joints whose subtree is at most this deep are not animated (-1 animates all)
+	bool m_single_clip;	// Blend trees sample only their heaviest clip
+};
+
+// Per level counters of the last update
+struct anim_lod_stats
+{
+	int m_players = 0;
+	int m_sampled = 0;
+	int m_interpolated = 0;
+	int m_held = 0;
+	int m_postponed = 0;
+	int m_joints = 0;
+};
+
+// Keeps the players of all the animated instances packed in one array and
+// updates them in a single pass, sorted by (model, clip) so the clip data
+// stays in cache while the instances that share it are sampled
+class animation_system
+{
+public:
+	static animation_system& get_instance();
+
+	// Creates a player and returns its handle
+	int add_player(anim_comp* comp);
+	void remove_player(int handle);
+
+	anim_player& get_player(int handle) { return m_players[m_slots[handle]]; }
+	size_t player_count() const { return m_players.size(); }
+
+	// Call when the model or clip of a player changes
+	void set_dirty() { m_sorted = false; }
+
+	// Advances the clocks and samples the clips of all players
+	void update(float dt);
+
+	// Advances and samples a single player at full detail
+	void update_player(int handle, float dt);
+
+	// Camera used to pick the level of detail of each instance
+	void set_view(const glm::mat4& world_to_projection) { m_view = world_to_projection; }
+
+	// Level of detail settings and counters window
+	void imgui();
+
+	static const int s_n_lods = 4;
+	void set_lod_enabled(bool enabled) { m_lod_enabled = enabled; }
+	bool lod_enabled() const { return m_lod_enabled; }
+	void set_budget(int joints) { m_budget = joints; }
+	int budget() const { return m_budget; }
+	anim_lod& get_lod(int lod) { return m_lods[lod]; }
+	const anim_lod_stats& get_stats(int lod) const { return m_stats[lod]; }
+
+private:
+	animation_system();
+	void sort_players();
+	void update_player(anim_player& p, float dt);
+
+	// Picks the level of detail of each player and schedules the ones that sample this frame
+	void schedule_players();
+	float projected_size(const anim_player& p);
+
+	// Samples the pose of the player at time t
+	bool sample_player(anim_player& p, float t, dense_pose& pose);
+
+	// Samples the layers of the player at time t and blends them into the pose
+	void sample_layers(anim_player& p, float t, dense_pose& pose);
+
+	// Writes the pose into the nodes of the player
+	void apply_pose(const anim_player& p, const dense_pose& pose);
+
+	// Clock of the player after dt seconds
+	float advance_time(const anim_player& p, float time, float dt) const;
+
+	// Bounding radius and joint subtree heights of a model
+	struct model_lod
+	{
+		bool m_ready = false;
+		float m_radius = 1.0f;
+		std::vector<unsigned char> m_heights;
+	};
+	const model_lod& get_model_lod(int model);
+	std::vector<model_lod> m_model_lods;
+
+	anim_lod m_lods[s_n_lods];
+	anim_lod_stats m_stats[s_n_lods];
+	// Off by default, the levels cull joints and change how existing scenes look
+	bool m_lod_enabled = false;
+
+	// Joints sampled per frame (0 for no limit). Players over the budget are
+	// postponed, the most significant ones are sampled first
+	int m_budget = 0;
+
+	glm::mat4 m_view = glm::mat4(1.0f);
+	std::vector<int> m_due;
+	unsigned m_frame = 0;
+
+	// Packed players and the handle of each one
+	std::vector<anim_player> m_players;
+	std::vector<int> m_handles;
+
+	// Index in the packed array of each handle (-1 if free)
+	std::vector<int> m_slots;
+	std::vector<int> m_free_handles;
+
+	bool m_sorted = true;
+};
+
+#define g_animation_system animation_system::get_instance()
+}
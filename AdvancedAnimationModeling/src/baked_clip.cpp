@@ -0,0 +1,375 @@
+/**
+* @file baked_clip.cpp
+* @date 2026/10/17
+*/
+#include "baked_clip.h"
+#include "resources.h"
+#include <algorithm>
+
+namespace cs460 {
+// Components that are linearly interpolated (rotations are normalized afterwards)
+static const int g_lerp_comps[] = {
+	dense_pose::tx, dense_pose::ty, dense_pose::tz,
+	dense_pose::sx, dense_pose::sy, dense_pose::sz
+};
+
+void baked_clip::bake(const animation& anim, unsigned n_joints)
+{
+	typedef animation::channel::path_type path_type;
+	typedef animation::sampler::lerp_mode lerp_mode;
+
+	const auto& channels = anim.m_chanels;
+	const auto& samplers = anim.m_samplers;
+	size_t n_channels = channels.size();
+
+	// Channels that can be baked
+	std::vector<size_t> baked_channels;
+	for (size_t i = 0; i < n_channels; ++i)
+	{
+		const auto& ch = channels[i];
+		if (ch.m_path_type == path_type::weights || ch.m_node < 0 || ch.m_node >= (int)n_joints)
+			continue;
+		if (samplers[ch.m_sampler].m_lerp_mode == lerp_mode::cubic)
+			continue;
+		baked_channels.push_back(i);
+	}
+
+	// Build the shared timeline (union of the key times of all channels)
+	m_times.clear();
+	for (size_t i : baked_channels)
+	{
+		const auto& input = samplers[channels[i].m_sampler].m_input;
+		m_times.insert(m_times.end(), input.begin(), input.end());
+	}
+	std::sort(m_times.begin(), m_times.end());
+	m_times.erase(std::unique(m_times.begin(), m_times.end(), [](float a, float b) {
+		return b - a < 1e-6f;
+	}), m_times.end());
+
+	// Split the segments where nlerp would drift away from the reference slerp
+	std::vector<float> refined;
+	std::vector<int> cursors(n_channels * 2, 1);
+	size_t n_times = m_times.size();
+	for (size_t k = 0; k < n_times; ++k)
+	{
+		refined.push_back(m_times[k]);
+		if (k + 1 == n_times)
+			break;
+
+		// Widest rotation arc of the segment
+		float angle = 0.0f;
+		for (size_t i : baked_channels)
+		{
+			const auto& ch = channels[i];
+			const auto& sp = samplers[ch.m_sampler];
+			if (ch.m_path_type != path_type::rotation || sp.m_lerp_mode != lerp_mode::linear)
+				continue;
+			glm::quat q0 = ch.lerp_rot(m_times[k], sp, true, &cursors[i * 2]);
+			glm::quat q1 = ch.lerp_rot(m_times[k + 1], sp, true, &cursors[i * 2 + 1]);
+			float d = glm::min(glm::abs(glm::dot(q0, q1)), 1.0f);
+			angle = glm::max(angle, 2.0f * glm::acos(d));
+		}
+
+		int n_splits = (int)glm::ceil(angle / s_max_arc);
+		for (int s = 1; s < n_splits; ++s)
+			refined.push_back(m_times[k] + (m_times[k + 1] - m_times[k]) * s / n_splits);
+	}
+	m_times.swap(refined);
+
+	// A resampled clip keeps its fixed rate if the shared timeline is its grid
+	m_rate = 0.0f;
+	if (anim.m_fixed_rate)
+	{
+		bool uniform = true;
+		size_t n = m_times.size();
+		for (size_t k = 0; k < n && uniform; ++k)
+			uniform = glm::abs(m_times[k] - k / anim.m_sample_rate) < 1e-4f;
+		if (uniform)
+			m_rate = anim.m_sample_rate;
+	}
+
+	m_n_joints = n_joints;
+	m_stride = (n_joints + 7) & ~7u;
+	size_t block = dense_pose::n_components * m_stride;
+	size_t n_keys = m_times.size();
+
+	// Initialize every key with identity transforms
+	m_data.assign(n_keys * block, 0.0f);
+	for (size_t k = 0; k < n_keys; ++k)
+	{
+		float* key = m_data.data() + k * block;
+		std::fill(key + dense_pose::qw * m_stride, key + (dense_pose::qw + 1) * m_stride, 1.0f);
+		std::fill(key + dense_pose::sx * m_stride, key + (dense_pose::sz + 1) * m_stride, 1.0f);
+	}
+	m_weights.assign(block, 1.0f);
+
+	unsigned n_words = (m_stride + 63) / 64;
+	for (int i = 0; i < 3; ++i)
+		m_valid[i].assign(n_words, 0);
+
+	// Sample each channel at the shared keys
+	for (size_t i : baked_channels)
+	{
+		const auto& ch = channels[i];
+		const auto& sp = samplers[ch.m_sampler];
+		unsigned joint = (unsigned)ch.m_node;
+		bool step = sp.m_lerp_mode == lerp_mode::step;
+
+		int first_comp = dense_pose::tx;
+		int n_comps = 3;
+		target_type type = translation;
+		if (ch.m_path_type == path_type::rotation)
+		{
+			first_comp = dense_pose::qx;
+			n_comps = 4;
+			type = rotation;
+		}
+		else if (ch.m_path_type == path_type::scale)
+		{
+			first_comp = dense_pose::sx;
+			type = scale;
+		}
+
+		m_valid[dense_pose::channel(type)][joint >> 6] |= (uint64_t)1 << (joint & 63);
+
+		// Step tracks hold the value of the segment that starts at each key
+		for (int c = 0; c < n_comps; ++c)
+			m_weights[(first_comp + c) * m_stride + joint] = step ? 0.0f : 1.0f;
+
+		int cursor = 1;
+		for (size_t k = 0; k < n_keys; ++k)
+		{
+			float t = m_times[k];
+			if (step)
+				t = (k + 1 < n_keys) ? 0.5f * (m_times[k] + m_times[k + 1]) : m_times[k] + 1.0f;
+
+			float* key = m_data.data() + k * block;
+			if (type == rotation)
+			{
+				glm::quat q = ch.lerp_rot(t, sp, true, &cursor);
+				key[dense_pose::qx * m_stride + joint] = q.x;
+				key[dense_pose::qy * m_stride + joint] = q.y;
+				key[dense_pose::qz * m_stride + joint] = q.z;
+				key[dense_pose::qw * m_stride + joint] = q.w;
+			}
+			else
+			{
+				glm::vec3 v = ch.lerp_pos(t, sp, &cursor);
+				for (int c = 0; c < 3; ++c)
+					key[(first_comp + c) * m_stride + joint] = v[c];
+			}
+		}
+
+		// Keep consecutive rotation keys in the same hemisphere so nlerp takes the short path
+		if (type == rotation)
+		{
+			for (size_t k = 1; k < n_keys; ++k)
+			{
+				float* q0 = m_data.data() + (k - 1) * block + dense_pose::qx * m_stride + joint;
+				float* q1 = m_data.data() + k * block + dense_pose::qx * m_stride + joint;
+				float dot = 0.0f;
+				for (int c = 0; c < 4; ++c)
+					dot += q0[c * m_stride] * q1[c * m_stride];
+				if (dot < 0.0f)
+				{
+					for (int c = 0; c < 4; ++c)
+						q1[c * m_stride] = -q1[c * m_stride];
+				}
+			}
+		}
+	}
+}
+
+void baked_clip::sample(float t, int* cursor, dense_pose& pose, const bone_mask* mask) const
+{
+	sample(t, cursor, pose, get_simd_level(), mask);
+}
+
+void baked_clip::sample(float t, int* cursor, dense_pose& pose, simd_level level, const bone_mask* mask) const
+{
+	// Find the segment in the shared timeline
+	int start, end;
+	float tn = m_rate > 0.0f ? lerp_fixed(m_rate, m_times.size(), t, &start, &end) :
+		lerp_keys(m_times, t, &start, &end, cursor);
+	if (tn < 0.0f)
+		return;
+
+	// Prepare the pose
+	if (pose.size() != m_n_joints)
+		pose.resize(m_n_joints);
+	for (int i = 0; i < 3; ++i)
+		pose.m_valid[i] = m_valid[i];
+
+	// Get the keys
+	size_t block = dense_pose::n_components * m_stride;
+	const float* k0 = m_data.data() + start * block;
+	const float* k1 = m_data.data() + end * block;
+
+	auto sample_span = [&](unsigned first, unsigned last) {
+		if (level == simd_level::avx2)
+			sample_avx2(k0, k1, tn, first, last, pose);
+		else if (level == simd_level::sse4)
+			sample_sse4(k0, k1, tn, first, last, pose);
+		else
+			sample_scalar(k0, k1, tn, first, last, pose);
+	};
+	if (!mask)
+	{
+		sample_span(0, m_stride);
+		return;
+	}
+
+	// Joints out of the mask are invalid and not computed
+	for (int i = 0; i < 3; ++i)
+	{
+		size_t n_words = glm::min(pose.m_valid[i].size(), mask->m_valid[i].size());
+		for (size_t w = 0; w < pose.m_valid[i].size(); ++w)
+			pose.m_valid[i][w] &= w < n_words ? mask->m_valid[i][w] : 0;
+	}
+	for (const auto& span : mask->m_spans)
+	{
+		if (span.first < m_stride)
+			sample_span(span.first, glm::min(span.second, m_stride));
+	}
+}
+
+size_t baked_clip::memory() const
+{
+	return m_times.size() * sizeof(float) + m_data.size() * sizeof(float) + m_weights.size() * sizeof(float);
+}
+
+void baked_clip::sample_scalar(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const
+{
+	const unsigned stride = m_stride;
+	const float* w = m_weights.data();
+
+	// Translation and scale
+	for (int c : g_lerp_comps)
+	{
+		const float* a = k0 + c * stride;
+		const float* b = k1 + c * stride;
+		const float* wc = w + c * stride;
+		float* out = pose.m_data[c].data();
+		for (unsigned i = begin; i < end; ++i)
+			out[i] = a[i] + (b[i] - a[i]) * (tn * wc[i]);
+	}
+
+	// Rotation (nlerp)
+	const float* wq = w + dense_pose::qx * stride;
+	float* out[4];
+	for (int c = 0; c < 4; ++c)
+		out[c] = pose.m_data[dense_pose::qx + c].data();
+
+	for (unsigned i = begin; i < end; ++i)
+	{
+		float t = tn * wq[i];
+		float q[4];
+		float len2 = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			float a = k0[(dense_pose::qx + c) * stride + i];
+			float b = k1[(dense_pose::qx + c) * stride + i];
+			q[c] = a + (b - a) * t;
+			len2 += q[c] * q[c];
+		}
+
+		float inv_len = 1.0f / glm::sqrt(len2);
+		for (int c = 0; c < 4; ++c)
+			out[c][i] = q[c] * inv_len;
+	}
+}
+
+SIMD_TARGET_SSE4 void baked_clip::sample_sse4(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const
+{
+#if defined(SIMD_X86)
+	const unsigned stride = m_stride;
+	const float* w = m_weights.data();
+	__m128 t = _mm_set1_ps(tn);
+
+	// Translation and scale
+	for (int c : g_lerp_comps)
+	{
+		const float* a = k0 + c * stride;
+		const float* b = k1 + c * stride;
+		const float* wc = w + c * stride;
+		float* out = pose.m_data[c].data();
+		for (unsigned i = begin; i < end; i += 4)
+		{
+			__m128 va = _mm_load_ps(a + i);
+			__m128 vb = _mm_load_ps(b + i);
+			__m128 vt = _mm_mul_ps(t, _mm_load_ps(wc + i));
+			_mm_store_ps(out + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt)));
+		}
+	}
+
+	// Rotation (nlerp)
+	const float* wq = w + dense_pose::qx * stride;
+	for (unsigned i = begin; i < end; i += 4)
+	{
+		__m128 vt = _mm_mul_ps(t, _mm_load_ps(wq + i));
+		__m128 q[4];
+		__m128 len2 = _mm_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			__m128 va = _mm_load_ps(k0 + (dense_pose::qx + c) * stride + i);
+			__m128 vb = _mm_load_ps(k1 + (dense_pose::qx + c) * stride + i);
+			q[c] = _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt));
+			len2 = _mm_add_ps(len2, _mm_mul_ps(q[c], q[c]));
+		}
+
+		__m128 inv_len = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm_store_ps(pose.m_data[dense_pose::qx + c].data() + i, _mm_mul_ps(q[c], inv_len));
+	}
+#else
+	sample_scalar(k0, k1, tn, begin, end, pose);
+#endif
+}
+
+SIMD_TARGET_AVX2 void baked_clip::sample_avx2(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const
+{
+#if defined(SIMD_X86)
+	const unsigned stride = m_stride;
+	const float* w = m_weights.data();
+	__m256 t = _mm256_set1_ps(tn);
+
+	// Translation and scale
+	for (int c : g_lerp_comps)
+	{
+		const float* a = k0 + c * stride;
+		const float* b = k1 + c * stride;
+		const float* wc = w + c * stride;
+		float* out = pose.m_data[c].data();
+		for (unsigned i = begin; i < end; i += 8)
+		{
+			__m256 va = _mm256_load_ps(a + i);
+			__m256 vb = _mm256_load_ps(b + i);
+			__m256 vt = _mm256_mul_ps(t, _mm256_load_ps(wc + i));
+			_mm256_store_ps(out + i, _mm256_fmadd_ps(_mm256_sub_ps(vb, va), vt, va));
+		}
+	}
+
+	// Rotation (nlerp)
+	const float* wq = w + dense_pose::qx * stride;
+	for (unsigned i = begin; i < end; i += 8)
+	{
+		__m256 vt = _mm256_mul_ps(t, _mm256_load_ps(wq + i));
+		__m256 q[4];
+		__m256 len2 = _mm256_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			__m256 va = _mm256_load_ps(k0 + (dense_pose::qx + c) * stride + i);
+			__m256 vb = _mm256_load_ps(k1 + (dense_pose::qx + c) * stride + i);
+			q[c] = _mm256_fmadd_ps(_mm256_sub_ps(vb, va), vt, va);
+			len2 = _mm256_fmadd_ps(q[c], q[c], len2);
+		}
+
+		__m256 inv_len = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm256_store_ps(pose.m_data[dense_pose::qx + c].data() + i, _mm256_mul_ps(q[c], inv_len));
+	}
+#else
+	sample_scalar(k0, k1, tn, begin, end, pose);
+#endif
+}
+}
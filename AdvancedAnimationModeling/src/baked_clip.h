@@ -0,0 +1,59 @@
+/**
+* @file baked_clip.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include "pose.h"
+
+namespace cs460 {
+struct animation;
+
+// Animation clip with all its translation, rotation and scale tracks resampled
+// on a shared timeline. Each key is stored as a block of dense_pose component
+// arrays indexed by joint slot, so sampling is a straight lerp over contiguous
+// memory that writes into a dense pose
+struct baked_clip
+{
+	// Packs the T, R, S channels of the animation (cubic and weights channels are skipped)
+	void bake(const animation& anim, unsigned n_joints);
+
+	// Samples every track at time t using the widest instruction set available. With a
+	// mask only the blocks of 8 joints it includes are sampled, the rest are left invalid
+	void sample(float t, int* cursor, dense_pose& pose, const bone_mask* mask = nullptr) const;
+
+	// Samples every track at time t using the given instruction set
+	void sample(float t, int* cursor, dense_pose& pose, simd_level level, const bone_mask* mask = nullptr) const;
+
+	bool empty() const { return m_times.empty(); }
+
+	// Size of the baked data in bytes
+	size_t memory() const;
+
+	// Shared timeline
+	std::vector<float> m_times;
+
+	// Keys are spaced 1/m_rate apart starting at 0 (0 if the timeline is not uniform)
+	float m_rate = 0.0f;
+
+	// Keys: n_keys blocks of n_components arrays of m_stride floats
+	float_array m_data;
+
+	// Lerp weight of each component array (0 for step tracks)
+	float_array m_weights;
+
+	// Validity bitmasks (translation, rotation, scale)
+	std::vector<uint64_t> m_valid[3];
+
+	unsigned m_n_joints = 0;
+	unsigned m_stride = 0;
+
+	// Widest rotation arc between two keys (wider segments are split at bake time)
+	static constexpr float s_max_arc = 0.35f;
+
+private:
+	void sample_scalar(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const;
+	void sample_sse4(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const;
+	void sample_avx2(const float* k0, const float* k1, float tn, unsigned begin, unsigned end, dense_pose& pose) const;
+};
+}
@@ -0,0 +1,2724 @@
+/**
+* @file benchmark.cpp
+* @date 2026/10/17
+*/
+#include "benchmark.h"
+#include <imgui.h>
+#include <cstdarg>
+#include <cstdio>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include "resources.h"
+#include "compression.h"
+#include "scene_graph.h"
+#include "node.h"
+#include "loader.h"
+#include "anim_comp.h"
+#include "animation_system.h"
+#include "job_system.h"
+#include "pose_cache.h"
+#include "blending.h"
+#include "blend_space.h"
+#include "delaunator.h"
+#include "inertialization.h"
+#include "transform_hierarchy.h"
+#include "mesh_comp.h"
+
+namespace cs460 {
+benchmark& benchmark::get_instance()
+{
+	static benchmark b;
+	return b;
+}
+
+benchmark::benchmark()
+{
+	m_reports.push_back({ "Keyframe Sampling", &benchmark::keyframe_sampling });
+	m_reports.push_back({ "Baked Clip Sampling", &benchmark::baked_sampling });
+	m_reports.push_back({ "Clip Compression", &benchmark::clip_compression });
+	m_reports.push_back({ "Binding Tables", &benchmark::binding_tables });
+	m_reports.push_back({ "Animation System", &benchmark::animation_batching });
+	m_reports.push_back({ "Job System Scaling", &benchmark::job_scaling });
+	m_reports.push_back({ "Animation LOD", &benchmark::animation_lod });
+	m_reports.push_back({ "Pose Cache", &benchmark::pose_caching });
+	m_reports.push_back({ "Blend Tree Poses", &benchmark::blend_tree_poses });
+	m_reports.push_back({ "Pose Blending Kernels", &benchmark::pose_blending });
+	m_reports.push_back({ "Blend Tree Pruning", &benchmark::blend_pruning });
+	m_reports.push_back({ "Blend Tree Program", &benchmark::blend_program_eval });
+	m_reports.push_back({ "Blend Clip Sharing", &benchmark::blend_clip_sharing });
+	m_reports.push_back({ "Blend Space Location", &benchmark::blend_space_location });
+	m_reports.push_back({ "Blend Space Editing", &benchmark::blend_space_editing });
+	m_reports.push_back({ "Bone Mask Layers", &benchmark::bone_mask_layers });
+	m_reports.push_back({ "Transitions", &benchmark::transition_cost });
+	m_reports.push_back({ "Transform Hierarchy", &benchmark::transform_propagation });
+	m_reports.push_back({ "Dirty Transforms", &benchmark::dirty_transforms });
+	m_reports.push_back({ "Component Pools", &benchmark::component_traversal });
+	m_reports.push_back({ "Node Allocation", &benchmark::node_allocation });
+}
+
+void benchmark::imgui()
+{
+	bool open = true;
+	ImGui::Begin("Benchmarks", &open, ImGuiWindowFlags_NoMove);
+
+	size_t n_reports = m_reports.size();
+	for (size_t i = 0; i < n_reports; ++i)
+	{
+		report& r = m_reports[i];
+
+		// Run the benchmark
+		ImGui::PushID((int)i);
+		if (ImGui::Button("Run"))
+		{
+			r.m_lines.clear();
+			(this->*r.m_run)(r);
+		}
+		ImGui::PopID();
+		ImGui::SameLine();
+
+		// Show the results
+		if (ImGui::TreeNode(r.m_name))
+		{
+			size_t n_lines = r.m_lines.size();
+			for (size_t j = 0; j < n_lines; ++j)
+				ImGui::TextUnformatted(r.m_lines[j].c_str());
+			ImGui::TreePop();
+		}
+	}
+
+	ImGui::End();
+}
+
+void benchmark::log(report& r, const char* format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	r.m_lines.push_back(buffer);
+}
+
+// Old sampling method: linear scan from the first frame
+static int linear_scan(const animation::sampler& sp, float t)
+{
+	if (t <= sp.m_input[0])
+		return 0;
+	if (t > sp.m_input.back())
+		return (int)sp.m_input.size() - 1;
+
+	int frame_idx = 1;
+	while (t > sp.m_input[frame_idx])
+		++frame_idx;
+	return frame_idx;
+}
+
+void benchmark::keyframe_sampling(report& r)
+{
+	const int n_channels = 64;
+	const int n_frames = 2000;
+	const float rate = 30.0f;
+	const float dt = 1.0f / 60.0f;
+	const int lengths[] = { 30, 120, 480, 1920, 7680 };
+
+	log(r, "%d channels, %d frames at 60 fps, clip keyed at 30 Hz", n_channels, n_frames);
+	log(r, "%8s %14s %14s %14s %14s", "keys", "linear (us)", "binary (us)", "cursor (us)", "fixed (us)");
+
+	for (int n_keys : lengths)
+	{
+		// Create a synthetic clip
+		animation::sampler sp;
+		sp.m_lerp_mode = animation::sampler::lerp_mode::linear;
+		for (int i = 0; i < n_keys; ++i)
+		{
+			sp.m_input.push_back(i / rate);
+			sp.m_output.push_back((float)(i % 7));
+		}
+		float max_time = sp.m_input.back();
+
+		std::vector<int> cursors(n_channels, 1);
+		volatile float sink = 0.0f;
+		int start, end;
+
+		// Linear scan
+		timer tm;
+		float t = 0.0f;
+		for (int f = 0; f < n_frames; ++f, t += dt)
+		{
+			float ft = t - glm::floor(t / max_time) * max_time;
+			for (int c = 0; c < n_channels; ++c)
+				sink = sink + (float)linear_scan(sp, ft);
+		}
+		double linear = tm.elapsed_ms();
+
+		// Binary search
+		tm.reset();
+		t = 0.0f;
+		for (int f = 0; f < n_frames; ++f, t += dt)
+		{
+			float ft = t - glm::floor(t / max_time) * max_time;
+			for (int c = 0; c < n_channels; ++c)
+				sink = sink + sp.lerp(ft, &start, &end);
+		}
+		double binary = tm.elapsed_ms();
+
+		// Cursor
+		tm.reset();
+		t = 0.0f;
+		for (int f = 0; f < n_frames; ++f, t += dt)
+		{
+			float ft = t - glm::floor(t / max_time) * max_time;
+			for (int c = 0; c < n_channels; ++c)
+				sink = sink + sp.lerp(ft, &start, &end, &cursors[c]);
+		}
+		double cursor = tm.elapsed_ms();
+
+		// Fixed rate (direct index)
+		animation::sampler fixed = sp;
+		fixed.m_rate = rate;
+		tm.reset();
+		t = 0.0f;
+		for (int f = 0; f < n_frames; ++f, t += dt)
+		{
+			float ft = t - glm::floor(t / max_time) * max_time;
+			for (int c = 0; c < n_channels; ++c)
+				sink = sink + fixed.lerp(ft, &start, &end);
+		}
+		double direct = tm.elapsed_ms();
+
+		// Per frame cost in microseconds
+		double to_us = 1000.0 / n_frames;
+		log(r, "%8d %14.2f %14.2f %14.2f %14.2f", n_keys, linear * to_us, binary * to_us, cursor * to_us, direct * to_us);
+	}
+}
+
+void benchmark::baked_sampling(report& r)
+{
+	typedef animation::channel::path_type path_type;
+	const int n_frames = 1000;
+	const float pos_tolerance = 1e-3f;
+	const float rot_tolerance = glm::radians(0.5f);
+	const simd_level levels[] = { simd_level::scalar, simd_level::sse4, simd_level::avx2 };
+	simd_level best = get_simd_level();
+
+	log(r, "cpu: %s, %d frames per clip, error tolerance %.4f / %.2f deg",
+		simd_level_name(best), n_frames, pos_tolerance, glm::degrees(rot_tolerance));
+	log(r, "%-24s %6s %8s %10s %10s %10s %10s %10s %10s", "clip", "keys", "kb",
+		"pos err", "rot err", "ref (us)", "scalar", "sse4", "avx2");
+
+	int n_models = g_resources.model_count();
+	int n_clips = 0;
+	for (int m = 0; m < n_models; ++m)
+	{
+		const model_rsc& model = g_resources.get_model_rsc(m);
+		for (const animation& anim : model.m_anims)
+		{
+			const baked_clip& baked = anim.m_baked;
+			if (baked.empty() || anim.m_max_time <= 0.0f)
+				continue;
+			++n_clips;
+
+			const auto& channels = anim.m_chanels;
+			const auto& samplers = anim.m_samplers;
+			size_t n_channels = channels.size();
+			float dt = anim.m_max_time / n_frames;
+
+			// Accuracy of each instruction set against the reference sampler
+			dense_pose pose;
+			int baked_cursor = 1;
+			float level_pos_err[3] = { 0.0f, 0.0f, 0.0f };
+			float level_rot_err[3] = { 0.0f, 0.0f, 0.0f };
+			for (int l = 0; l < 3; ++l)
+			{
+				if (levels[l] > best)
+					continue;
+				baked_cursor = 1;
+				for (int f = 0; f <= n_frames; ++f)
+				{
+					float t = f * dt;
+					baked.sample(t, &baked_cursor, pose, levels[l]);
+					for (size_t i = 0; i < n_channels; ++i)
+					{
+						const auto& ch = channels[i];
+						const auto& sp = samplers[ch.m_sampler];
+						if (sp.m_lerp_mode == animation::sampler::lerp_mode::cubic || ch.m_path_type == path_type::weights)
+							continue;
+
+						if (ch.m_path_type == path_type::rotation)
+						{
+							glm::quat q0 = ch.lerp_rot(t, sp, true);
+							glm::quat q1 = pose.get_rotation(ch.m_node);
+							level_rot_err[l] = glm::max(level_rot_err[l], quat_angle(q0, q1));
+						}
+						else
+						{
+							glm::vec3 v0 = ch.lerp_pos(t, sp);
+							glm::vec3 v1 = ch.m_path_type == path_type::translation ?
+								pose.get_position(ch.m_node) : pose.get_scale(ch.m_node);
+							level_pos_err[l] = glm::max(level_pos_err[l], glm::length(v1 - v0));
+						}
+					}
+				}
+			}
+
+			// The table shows the worst kernel
+			float pos_err = glm::max(level_pos_err[0], glm::max(level_pos_err[1], level_pos_err[2]));
+			float rot_err = glm::max(level_rot_err[0], glm::max(level_rot_err[1], level_rot_err[2]));
+
+			volatile float sink = 0.0f;
+
+			// Per channel sampling
+			sampling_context context;
+			timer tm;
+			for (int f = 0; f < n_frames; ++f)
+			{
+				float t = f * dt;
+				for (size_t i = 0; i < n_channels; ++i)
+				{
+					const auto& ch = channels[i];
+					const auto& sp = samplers[ch.m_sampler];
+					if (ch.m_path_type == path_type::rotation)
+						sink = sink + ch.lerp_rot(t, sp, true, context.get_cursor(anim, i)).w;
+					else if (ch.m_path_type != path_type::weights)
+						sink = sink + ch.lerp_pos(t, sp, context.get_cursor(anim, i)).x;
+				}
+			}
+			double ref = tm.elapsed_ms();
+
+			// Baked sampling with each instruction set
+			double level_time[3] = { 0.0, 0.0, 0.0 };
+			for (int l = 0; l < 3; ++l)
+			{
+				if (levels[l] > best)
+					continue;
+				baked_cursor = 1;
+				tm.reset();
+				for (int f = 0; f < n_frames; ++f)
+				{
+					baked.sample(f * dt, &baked_cursor, pose, levels[l]);
+					sink = sink + pose.m_data[dense_pose::qw][0];
+				}
+				level_time[l] = tm.elapsed_ms();
+			}
+
+			// Per frame cost in microseconds
+			double to_us = 1000.0 / n_frames;
+			std::string name = anim.m_name.substr(0, 24);
+			log(r, "%-24s %6d %8.1f %10.6f %10.4f %10.2f %10.2f %10.2f %10.2f", name.c_str(),
+				(int)baked.m_times.size(), baked.memory() / 1024.0, pos_err, glm::degrees(rot_err),
+				ref * to_us, level_time[0] * to_us, level_time[1] * to_us, level_time[2] * to_us);
+
+			for (int l = 0; l < 3; ++l)
+			{
+				if (level_pos_err[l] > pos_tolerance || level_rot_err[l] > rot_tolerance)
+					log(r, "  FAILED: %s kernel is outside the error tolerance (%.6f / %.4f deg)",
+						simd_level_name(levels[l]), level_pos_err[l], glm::degrees(level_rot_err[l]));
+			}
+		}
+	}
+
+	if (n_clips == 0)
+		log(r, "no animated models loaded");
+}
+
+// Time to sample every T, R, S channel of a clip at n_frames times
+static double sample_channels(const animation& anim, int n_frames)
+{
+	typedef animation::channel::path_type path_type;
+	volatile float sink = 0.0f;
+	float dt = anim.m_max_time / n_frames;
+	sampling_context context;
+
+	timer tm;
+	for (int f = 0; f < n_frames; ++f)
+	{
+		size_t n_channels = anim.m_chanels.size();
+		for (size_t i = 0; i < n_channels; ++i)
+		{
+			const auto& ch = anim.m_chanels[i];
+			const auto& sp = anim.m_samplers[ch.m_sampler];
+			if (sp.m_lerp_mode == animation::sampler::lerp_mode::cubic)
+				continue;
+			if (ch.m_path_type == path_type::rotation)
+				sink = sink + ch.lerp_rot(f * dt, sp, true, context.get_cursor(anim, i)).w;
+			else if (ch.m_path_type != path_type::weights)
+				sink = sink + ch.lerp_pos(f * dt, sp, context.get_cursor(anim, i)).x;
+		}
+	}
+	return tm.elapsed_ms();
+}
+
+void benchmark::clip_compression(report& r)
+{
+	const int n_frames = 1000;
+
+	log(r, "%-24s %9s %9s %7s %10s %9s %10s %10s %10s", "clip", "raw kb", "packed kb", "ratio",
+		"t err", "r err deg", "bone err", "raw (us)", "packed (us)");
+
+	size_t total_raw = 0;
+	size_t total_packed = 0;
+	int n_models = g_resources.model_count();
+	for (int m = 0; m < n_models; ++m)
+	{
+		const model_rsc& model = g_resources.get_model_rsc(m);
+
+		// Length of each bone, from the rest offsets like the importer
+		int n_nodes = 0;
+		for (const auto& n : model.m_nodes)
+			n_nodes = glm::max(n_nodes, n.first + 1);
+		std::vector<float> offsets(n_nodes, 0.0f);
+		std::vector<std::vector<int>> children(n_nodes);
+		for (const auto& n : model.m_nodes)
+		{
+			offsets[n.first] = glm::length(n.second.m_local.get_position());
+			children[n.first] = n.second.m_childs;
+		}
+		std::vector<float> bone_lengths = compute_bone_lengths(offsets, children);
+
+		for (const animation& anim : model.m_anims)
+		{
+			if (anim.m_max_time <= 0.0f)
+				continue;
+
+			// Compress a copy of the clip (clips compressed at import are reported as is)
+			animation packed = anim;
+			compression_stats stats = compress_animation(packed, bone_lengths);
+			if (stats.m_packed_bytes == 0)
+			{
+				log(r, "%-24s (already compressed or no tracks)", anim.m_name.substr(0, 24).c_str());
+				continue;
+			}
+			total_raw += stats.m_raw_bytes;
+			total_packed += stats.m_packed_bytes;
+
+			// Per frame sampling cost in microseconds
+			double to_us = 1000.0 / n_frames;
+			double raw_time = sample_channels(anim, n_frames) * to_us;
+			double packed_time = sample_channels(packed, n_frames) * to_us;
+
+			log(r, "%-24s %9.1f %9.1f %7.2f %10.6f %9.4f %10.6f %10.2f %10.2f", anim.m_name.substr(0, 24).c_str(),
+				stats.m_raw_bytes / 1024.0, stats.m_packed_bytes / 1024.0, stats.ratio(), stats.m_max_translation,
+				stats.m_max_rotation, stats.m_max_bone, raw_time, packed_time);
+		}
+	}
+
+	if (total_packed == 0)
+		log(r, "no uncompressed animated models loaded");
+	else
+		log(r, "total: %.1f kb -> %.1f kb (%.2f:1)", total_raw / 1024.0, total_packed / 1024.0, (float)total_raw / total_packed);
+}
+
+// Loads the models of the crowd scenes
+static std::vector<int> load_crowd_models()
+{
+	const char* file_names[] = {
+		"data/assets/rigged figure/CesiumMan.gltf",
+		"data/assets/Fox/Fox.gltf",
+		"data/assets/BrainStem/BrainStem.gltf"
+	};
+
+	std::vector<int> models;
+	for (const char* file_name : file_names)
+	{
+		if (!g_resources.model_registered(file_name))
+			import_gltf_file(file_name);
+		if (g_resources.model_registered(file_name))
+			models.push_back(g_resources.get_model_id(file_name));
+	}
+	return models;
+}
+
+// Creates the instances in the scene, the way the editor does, interleaving
+// models and clips like a mixed crowd
+static std::vector<node*> create_crowd(const std::vector<int>& models, int n_instances)
+{
+	std::vector<node*> instances(n_instances);
+	for (int i = 0; i < n_instances; ++i)
+	{
+		int model_idx = models[i % models.size()];
+		instances[i] = g_scene.create_model_instance(model_idx);
+		int n_anims = (int)g_resources.get_model_rsc(model_idx).m_anims.size();
+		if (anim_comp* ac = instances[i]->get_component<anim_comp>())
+			ac->set_animation((i / (int)models.size()) % n_anims);
+	}
+	g_scene.update_node_transforms();
+	return instances;
+}
+
+static void destroy_crowd(const std::vector<node*>& instances)
+{
+	for (node* inst : instances)
+		g_scene.destroy_model_instance(inst);
+
+	// Removes the transform slots of the nodes
+	g_scene.update_node_transforms();
+}
+
+void benchmark::binding_tables(report& r)
+{
+	typedef animation::channel::path_type path_type;
+	const char* file_name = "data/assets/rigged figure/CesiumMan.gltf";
+	const int n_instances = 500;
+	const int n_frames = 100;
+
+	// Load the model
+	if (!g_resources.model_registered(file_name))
+		import_gltf_file(file_name);
+	if (!g_resources.model_registered(file_name))
+	{
+		log(r, "could not load %s", file_name);
+		return;
+	}
+
+	int model_idx = g_resources.get_model_id(file_name);
+	const model_rsc& model = g_resources.get_model_rsc(model_idx);
+	if (model.m_anims.empty())
+	{
+		log(r, "model has no animations");
+		return;
+	}
+	const animation& anim = model.m_anims[0];
+	size_t n_channels = anim.m_chanels.size();
+
+	// Instances of the scene, with their nodes also in the nested hash maps the scene used before
+	std::vector<node*> instances = create_crowd({ model_idx }, n_instances);
+	std::unordered_map<int, std::vector<std::unordered_map<int, node*>>> hashed;
+	auto& hashed_instances = hashed[model_idx];
+	hashed_instances.resize(n_instances);
+	for (int i = 0; i < n_instances; ++i)
+		for (const auto& n : model.m_nodes)
+			hashed_instances[i][n.first] = g_scene.get_instance_node(instances[i]->m_instance, n.first);
+
+	// Binding tables of the animation players
+	std::vector<transform_handle* const*> tables(n_instances);
+	for (int i = 0; i < n_instances; ++i)
+		tables[i] = g_animation_system.get_player(instances[i]->get_component<anim_comp>()->get_player()).m_bindings.data();
+
+	// Sample the clip once per frame so only the writes are measured
+	std::vector<glm::vec3> positions(n_channels);
+	std::vector<glm::quat> rotations(n_channels);
+	float dt = anim.m_max_time / n_frames;
+
+	double hashed_time = 0.0;
+	double lookup_time = 0.0;
+	double table_time = 0.0;
+	for (int f = 0; f < n_frames; ++f)
+	{
+		for (size_t c = 0; c < n_channels; ++c)
+		{
+			const auto& ch = anim.m_chanels[c];
+			const auto& sp = anim.m_samplers[ch.m_sampler];
+			if (ch.m_path_type == path_type::rotation)
+				rotations[c] = ch.lerp_rot(f * dt, sp, true);
+			else if (ch.m_path_type != path_type::weights)
+				positions[c] = ch.lerp_pos(f * dt, sp);
+		}
+
+		// Nested hash map lookups (model -> instance -> node)
+		timer tm;
+		for (int i = 0; i < n_instances; ++i)
+		{
+			for (size_t c = 0; c < n_channels; ++c)
+			{
+				const auto& ch = anim.m_chanels[c];
+				node* n = hashed.at(model_idx).at(i).at(ch.m_node);
+				if (ch.m_path_type == path_type::translation)
+					n->m_local.set_position(positions[c]);
+				else if (ch.m_path_type == path_type::rotation)
+					n->m_local.set_rotation(rotations[c]);
+				else if (ch.m_path_type == path_type::scale)
+					n->m_local.set_scale(positions[c]);
+			}
+		}
+		hashed_time += tm.elapsed_ms();
+
+		// Registry lookups through get_model_node (model -> instance -> node)
+		tm.reset();
+		for (int i = 0; i < n_instances; ++i)
+		{
+			for (size_t c = 0; c < n_channels; ++c)
+			{
+				const auto& ch = anim.m_chanels[c];
+				node* n = g_scene.get_model_node(model_idx, instances[i]->m_model_inst, ch.m_node);
+				if (ch.m_path_type == path_type::translation)
+					n->m_local.set_position(positions[c]);
+				else if (ch.m_path_type == path_type::rotation)
+					n->m_local.set_rotation(rotations[c]);
+				else if (ch.m_path_type == path_type::scale)
+					n->m_local.set_scale(positions[c]);
+			}
+		}
+		lookup_time += tm.elapsed_ms();
+
+		// Binding tables
+		tm.reset();
+		for (int i = 0; i < n_instances; ++i)
+		{
+			transform_handle* const* table = tables[i];
+			for (size_t c = 0; c < n_channels; ++c)
+			{
+				const auto& ch = anim.m_chanels[c];
+				transform_handle* tr = table[ch.m_node];
+				if (ch.m_path_type == path_type::translation)
+					tr->set_position(positions[c]);
+				else if (ch.m_path_type == path_type::rotation)
+					tr->set_rotation(rotations[c]);
+				else if (ch.m_path_type == path_type::scale)
+					tr->set_scale(positions[c]);
+			}
+		}
+		table_time += tm.elapsed_ms();
+	}
+
+	destroy_crowd(instances);
+
+	log(r, "%d instances, %d channels, %d frames", n_instances, (int)n_channels, n_frames);
+	log(r, "hashed lookups:   %8.1f us per frame", hashed_time * 1000.0 / n_frames);
+	log(r, "registry lookups: %8.1f us per frame (%.1fx)", lookup_time * 1000.0 / n_frames,
+		lookup_time > 0.0 ? hashed_time / lookup_time : 0.0);
+	log(r, "binding tables:   %8.1f us per frame (%.1fx)", table_time * 1000.0 / n_frames,
+		table_time > 0.0 ? hashed_time / table_time : 0.0);
+}
+
+// Old update path: walk the nodes and sample each animated instance when it is reached
+static void update_nodes_rec(node* n, float dt)
+{
+	n->update();
+	if (anim_comp* ac = n->get_component<anim_comp>())
+		g_animation_system.update_player(ac->get_player(), dt);
+
+	size_t n_children = n->m_children.size();
+	for (size_t i = 0; i < n_children; ++i)
+		update_nodes_rec(n->m_children[i], dt);
+}
+
+void benchmark::animation_batching(report& r)
+{
+	const int n_instances = 1000;
+	const int n_frames = 100;
+	const float dt = 1.0f / 60.0f;
+
+	// Load the models
+	std::vector<int> models = load_crowd_models();
+	if (models.empty())
+	{
+		log(r, "could not load the models");
+		return;
+	}
+	std::vector<node*> instances = create_crowd(models, n_instances);
+
+	// Both paths at full detail
+	bool prev_enabled = g_animation_system.lod_enabled();
+	g_animation_system.set_lod_enabled(false);
+
+	// Per node updates of the whole scene, the batched update runs every player too
+	timer tm;
+	for (int f = 0; f < n_frames; ++f)
+		update_nodes_rec(g_scene.get_root(), dt);
+	double per_node = tm.elapsed_ms();
+
+	// Batched updates
+	tm.reset();
+	for (int f = 0; f < n_frames; ++f)
+		g_animation_system.update(dt);
+	double batched = tm.elapsed_ms();
+
+	g_animation_system.set_lod_enabled(prev_enabled);
+	destroy_crowd(instances);
+
+	log(r, "%d instances of %d models, %d frames", n_instances, (int)models.size(), n_frames);
+	log(r, "per node update: %8.3f ms per frame", per_node / n_frames);
+	log(r, "batched update:  %8.3f ms per frame (%.2fx)", batched / n_frames, batched > 0.0 ? per_node / batched : 0.0);
+}
+
+// Hashes the bits of the world transforms of a subtree
+static void hash_world_rec(const node* n, uint64_t& hash)
+{
+	glm::vec3 pos = n->m_world.get_position();
+	glm::quat rot = n->m_world.get_rotation();
+	glm::vec3 sca = n->m_world.get_scale();
+	float values[10] = { pos.x, pos.y, pos.z, rot.x, rot.y, rot.z, rot.w, sca.x, sca.y, sca.z };
+
+	// FNV-1a
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+	for (size_t i = 0; i < sizeof(values); ++i)
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+	for (const node* child : n->m_children)
+		hash_world_rec(child, hash);
+}
+
+void benchmark::job_scaling(report& r)
+{
+	const int n_instances = 2000;
+	const int n_frames = 60;
+	const int chunk = 64;
+	const float dt = 1.0f / 60.0f;
+	const unsigned thread_counts[] = { 1, 2, 4, 8, 12, 16 };
+
+	std::vector<int> models = load_crowd_models();
+	if (models.empty())
+	{
+		log(r, "could not load the models");
+		return;
+	}
+	std::vector<node*> instances = create_crowd(models, n_instances);
+
+	// Task graph frame: one task per chunk of instances animates it, and the world
+	// transforms are updated once every chunk is done
+	task_graph graph;
+	std::vector<int> animate_tasks;
+	for (int begin = 0; begin < n_instances; begin += chunk)
+	{
+		int end = glm::min(begin + chunk, n_instances);
+		animate_tasks.push_back(graph.add([&instances, begin, end, dt]() {
+			for (int i = begin; i < end; ++i)
+				g_animation_system.update_player(instances[i]->get_component<anim_comp>()->get_player(), dt);
+		}));
+	}
+	graph.add([]() { g_scene.update_node_transforms(); }, animate_tasks);
+
+	// Restarts the clocks so every run produces the same poses
+	auto rewind = [&instances]() {
+		for (node* inst : instances)
+			g_animation_system.get_player(inst->get_component<anim_comp>()->get_player()).m_time = 0.0f;
+	};
+
+	log(r, "%d instances of %d models, %d frames, %u cores", n_instances, (int)models.size(), n_frames, std::thread::hardware_concurrency());
+	log(r, "threads  parallel_for (ms)  speedup  task graph (ms)  speedup  deterministic");
+
+	// The task graph samples each player at full detail
+	bool prev_enabled = g_animation_system.lod_enabled();
+	g_animation_system.set_lod_enabled(false);
+
+	unsigned prev_threads = g_jobs.thread_count();
+	double base_for = 0.0;
+	double base_graph = 0.0;
+	uint64_t reference = 0;
+	for (unsigned n_threads : thread_counts)
+	{
+		g_jobs.set_thread_count(n_threads);
+
+		// Animation pass and transform pass, one barrier between them
+		rewind();
+		timer tm;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_animation_system.update(dt);
+			g_scene.update_node_transforms();
+		}
+		double time_for = tm.elapsed_ms() / n_frames;
+
+		uint64_t hash = 14695981039346656037ull;
+		for (node* inst : instances)
+			hash_world_rec(inst, hash);
+
+		// Task graph
+		rewind();
+		tm.reset();
+		for (int f = 0; f < n_frames; ++f)
+			graph.run();
+		double time_graph = tm.elapsed_ms() / n_frames;
+
+		uint64_t graph_hash = 14695981039346656037ull;
+		for (node* inst : instances)
+			hash_world_rec(inst, graph_hash);
+
+		if (n_threads == 1)
+		{
+			base_for = time_for;
+			base_graph = time_graph;
+			reference = hash;
+		}
+
+		bool deterministic = hash == reference && graph_hash == reference;
+		log(r, "%7u  %17.3f  %6.2fx  %15.3f  %6.2fx  %s", n_threads,
+			time_for, time_for > 0.0 ? base_for / time_for : 0.0,
+			time_graph, time_graph > 0.0 ? base_graph / time_graph : 0.0,
+			deterministic ? "yes" : "NO");
+	}
+	g_jobs.set_thread_count(prev_threads);
+	g_animation_system.set_lod_enabled(prev_enabled);
+
+	destroy_crowd(instances);
+}
+
+// World position of every node of the instances
+static void gather_joints(const std::vector<node*>& instances, std::vector<glm::vec3>& positions)
+{
+	positions.clear();
+	for (const node* inst : instances)
+	{
+		for (const node* joint : g_scene.get_instance_nodes(inst->m_instance))
+			if (joint)
+				positions.push_back(joint->m_world.get_position());
+	}
+}
+
+void benchmark::animation_lod(report& r)
+{
+	const int n_instances = 1000;
+	const int n_columns = 40;
+	const int n_frames = 120;
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<int> models = load_crowd_models();
+	if (models.empty())
+	{
+		log(r, "could not load the models");
+		return;
+	}
+	std::vector<node*> instances = create_crowd(models, n_instances);
+
+	// Rows of instances receding from the camera
+	for (int i = 0; i < n_instances; ++i)
+	{
+		float x = ((i % n_columns) - 0.5f * n_columns) * 2.0f;
+		float z = -(float)(i / n_columns) * 4.0f;
+		instances[i]->m_local.set_position(glm::vec3(x, 0.0f, z));
+	}
+	g_scene.update_node_transforms();
+
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 4.0f), glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	g_animation_system.set_view(proj * view);
+
+	bool prev_enabled = g_animation_system.lod_enabled();
+	int prev_budget = g_animation_system.budget();
+
+	// Runs the crowd from the start and returns the time per frame
+	anim_lod_stats totals[animation_system::s_n_lods];
+	auto run = [&]() {
+		for (node* inst : instances)
+			g_animation_system.get_player(inst->get_component<anim_comp>()->get_player()).m_time = 0.0f;
+		for (auto& t : totals)
+			t = anim_lod_stats();
+
+		timer tm;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_animation_system.update(dt);
+			for (int l = 0; l < animation_system::s_n_lods; ++l)
+			{
+				const anim_lod_stats& st = g_animation_system.get_stats(l);
+				totals[l].m_players += st.m_players;
+				totals[l].m_sampled += st.m_sampled;
+				totals[l].m_interpolated += st.m_interpolated;
+				totals[l].m_held += st.m_held;
+				totals[l].m_postponed += st.m_postponed;
+				totals[l].m_joints += st.m_joints;
+			}
+		}
+		double ms = tm.elapsed_ms() / n_frames;
+		g_scene.update_node_transforms();
+		return ms;
+	};
+
+	// Mean and max distance of the joints to the full detail crowd
+	std::vector<glm::vec3> reference, positions;
+	auto error = [&](float& mean, float& max) {
+		gather_joints(instances, positions);
+		mean = max = 0.0f;
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			float e = glm::length(positions[i] - reference[i]);
+			mean += e;
+			max = glm::max(max, e);
+		}
+		mean /= glm::max(positions.size(), (size_t)1);
+	};
+
+	auto log_levels = [&]() {
+		log(r, "    lod  players  sampled/frame  interpolated  held  postponed  joints/frame");
+		for (int l = 0; l < animation_system::s_n_lods; ++l)
+		{
+			const anim_lod_stats& t = totals[l];
+			log(r, "    %3d  %7d  %13.1f  %12.1f  %4.1f  %9.1f  %12.1f", l, t.m_players / n_frames,
+				(float)t.m_sampled / n_frames, (float)t.m_interpolated / n_frames, (float)t.m_held / n_frames,
+				(float)t.m_postponed / n_frames, (float)t.m_joints / n_frames);
+		}
+	};
+
+	log(r, "%d instances of %d models in %d rows, %d frames", n_instances, (int)models.size(), n_instances / n_columns, n_frames);
+
+	// Baked clips are cheap to sample, per channel sampling shows the cost of heavier poses
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		bool baked = mode == 0;
+		for (node* inst : instances)
+			g_animation_system.get_player(inst->get_component<anim_comp>()->get_player()).m_baked = baked;
+		log(r, baked ? "baked clips" : "per channel sampling");
+
+		// Full detail
+		g_animation_system.set_lod_enabled(false);
+		g_animation_system.set_budget(0);
+		double full = run();
+		int full_joints = totals[0].m_joints / n_frames;
+		gather_joints(instances, reference);
+		log(r, "  full detail: %8.3f ms per frame, %d joints per frame", full, full_joints);
+
+		// Level of detail
+		float mean, max;
+		g_animation_system.set_lod_enabled(true);
+		double lod = run();
+		error(mean, max);
+		log(r, "  lod:         %8.3f ms per frame (%.2fx), joint error mean %.4f max %.4f", lod, lod > 0.0 ? full / lod : 0.0, mean, max);
+		log_levels();
+
+		// Level of detail under a budget of a tenth of the full detail joints
+		int budget = glm::max(full_joints / 10, 1);
+		g_animation_system.set_budget(budget);
+		double budgeted = run();
+		error(mean, max);
+		log(r, "  budget %5d: %7.3f ms per frame (%.2fx), joint error mean %.4f max %.4f", budget, budgeted, budgeted > 0.0 ? full / budgeted : 0.0, mean, max);
+		log_levels();
+	}
+
+	g_animation_system.set_lod_enabled(prev_enabled);
+	g_animation_system.set_budget(prev_budget);
+
+	destroy_crowd(instances);
+}
+
+void benchmark::pose_caching(report& r)
+{
+	const int n_instances = 1000;
+	const int n_frames = 120;
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<int> models = load_crowd_models();
+	if (models.empty())
+	{
+		log(r, "could not load the models");
+		return;
+	}
+	std::vector<node*> instances = create_crowd(models, n_instances);
+
+	bool prev_enabled = g_pose_cache.enabled();
+	bool prev_lod = g_animation_system.lod_enabled();
+	g_animation_system.set_lod_enabled(false);
+
+	// Runs the crowd with each instance starting at the given phase and returns the time per frame
+	int hits = 0, misses = 0;
+	auto run = [&](int n_phases) {
+		for (size_t i = 0; i < instances.size(); ++i)
+		{
+			anim_player& p = g_animation_system.get_player(instances[i]->get_component<anim_comp>()->get_player());
+			p.m_time = (float)((i * 7) % n_phases) * dt;
+		}
+
+		hits = misses = 0;
+		timer tm;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_animation_system.update(dt);
+			hits += g_pose_cache.hits();
+			misses += g_pose_cache.misses();
+		}
+		double ms = tm.elapsed_ms() / n_frames;
+		g_scene.update_node_transforms();
+		return ms;
+	};
+
+	// Max distance of the joints to the uncached crowd
+	std::vector<glm::vec3> reference, positions;
+	auto error = [&]() {
+		gather_joints(instances, positions);
+		float max = 0.0f;
+		for (size_t i = 0; i < positions.size(); ++i)
+			max = glm::max(max, glm::length(positions[i] - reference[i]));
+		return max;
+	};
+
+	log(r, "%d instances of %d models, %d frames", n_instances, (int)models.size(), n_frames);
+	log(r, "sampling     step (ms)  phases  no cache (ms)  cache (ms)  speedup  hit rate  max joint error");
+
+	// Exact times (the default) and times quantized to half a frame
+	float prev_step = g_pose_cache.get_step();
+	const float steps[] = { 0.0f, 0.5f * dt };
+	const int phase_counts[] = { 1, 8, 60 };
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		bool baked = mode == 0;
+		for (node* inst : instances)
+			g_animation_system.get_player(inst->get_component<anim_comp>()->get_player()).m_baked = baked;
+
+		for (float step : steps)
+		{
+			g_pose_cache.set_step(step);
+			for (int n_phases : phase_counts)
+			{
+				g_pose_cache.set_enabled(false);
+				double uncached = run(n_phases);
+				gather_joints(instances, reference);
+
+				g_pose_cache.set_enabled(true);
+				double cached = run(n_phases);
+				float max_error = error();
+
+				int total = hits + misses;
+				log(r, "%-11s  %9.2f  %6d  %13.3f  %10.3f  %6.2fx  %7.1f%%  %15.5f", baked ? "baked" : "per channel", step * 1000.0f, n_phases,
+					uncached, cached, cached > 0.0 ? uncached / cached : 0.0, total ? 100.0f * hits / total : 0.0f, max_error);
+
+				// Exact times must give the same poses as no cache
+				if (step == 0.0f && max_error > 0.0f)
+					log(r, "  FAILED: the cache changes the poses without a step");
+			}
+		}
+	}
+
+	g_pose_cache.set_step(prev_step);
+	g_pose_cache.set_enabled(prev_enabled);
+	g_animation_system.set_lod_enabled(prev_lod);
+	destroy_crowd(instances);
+}
+
+// Blend poses as they were stored before the dense poses (node index -> transform and T, R, S flags)
+typedef std::unordered_map<unsigned, std::pair<transform, unsigned char>> map_pose;
+
+static void map_produce_pos(const animation& anim, float time, sampling_context& context, map_pose& pose)
+{
+	time = time - glm::floor(time / anim.m_max_time) * anim.m_max_time;
+	pose.clear();
+
+	size_t n_channels = anim.m_chanels.size();
+	for (size_t i = 0; i < n_channels; ++i)
+	{
+		const auto& ch = anim.m_chanels[i];
+		const auto& sp = anim.m_samplers.at(ch.m_sampler);
+		auto& t = pose[ch.m_node];
+
+		if (ch.m_path_type == animation::channel::path_type::translation)
+		{
+			t.second |= translation;
+			t.first.set_position(ch.lerp_pos(time, sp, context.get_cursor(anim, i)));
+		}
+		else if (ch.m_path_type == animation::channel::path_type::rotation)
+		{
+			t.second |= rotation;
+			t.first.set_rotation(ch.lerp_rot(time, sp, true, context.get_cursor(anim, i)));
+		}
+		else if (ch.m_path_type == animation::channel::path_type::scale)
+		{
+			t.second |= scale;
+			t.first.set_scale(ch.lerp_pos(time, sp, context.get_cursor(anim, i)));
+		}
+	}
+}
+
+static void map_blend_barycentric(const map_pose* poses[3], const float weights[3], map_pose& res)
+{
+	res.clear();
+	for (int k = 0; k < 3; ++k)
+	{
+		for (const auto& it : *poses[k])
+			res[it.first];
+	}
+
+	for (auto& it : res)
+	{
+		transform& res_tr = it.second.first;
+		unsigned char& res_flags = it.second.second;
+
+		// Weight of each pose that has the joint and channel
+		const std::pair<transform, unsigned char>* found[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			auto f = poses[k]->find(it.first);
+			found[k] = f != poses[k]->end() ? &poses[k]->at(it.first) : nullptr;
+		}
+		auto weight = [&](int k, unsigned char type) {
+			return found[k] && (found[k]->second & type) != 0 ? weights[k] : 0.0f;
+		};
+
+		glm::vec3 p(0.0f), s(0.0f);
+		glm::quat q(0.0f, 0.0f, 0.0f, 0.0f);
+		unsigned char flags = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (!found[k])
+				continue;
+			p += found[k]->first.get_position() * weight(k, translation);
+			q = q + found[k]->first.get_rotation() * weight(k, rotation);
+			s += found[k]->first.get_scale() * weight(k, scale);
+			flags |= found[k]->second;
+		}
+
+		if ((flags & translation) != 0)
+			res_tr.set_position(p);
+		if ((flags & rotation) != 0)
+			res_tr.set_rotation(glm::normalize(q));
+		if ((flags & scale) != 0)
+			res_tr.set_scale(s);
+		res_flags = flags;
+	}
+}
+
+// Builds the tree of the 2D blending scene, returns the model or -1 if it is not available
+static int create_blend_scene_2d(blend_tree& tree)
+{
+	std::string bot = "data/assets/MIXAMO/xbot.gltf";
+	import_gltf_file(bot.c_str());
+	if (!g_resources.model_registered(bot.c_str()))
+		return -1;
+	int model = g_resources.get_model_id(bot);
+	if (g_resources.get_model_rsc(model).m_anims.size() < 26)
+		return -1;
+
+	tree.create_2d_blend_tree();
+	tree.insert_blend_node(model, 5, glm::vec2(0.0f));
+	tree.insert_blend_node(model, 22, glm::vec2(0.0f, 1.0f));
+	tree.insert_blend_node(model, 23, glm::vec2(-1.0f, 0.0f));
+	tree.insert_blend_node(model, 24, glm::vec2(1.0f, 0.0f));
+	tree.insert_blend_node(model, 25, glm::vec2(0.0f, -1.0f));
+	tree.insert_blend_node(model, 17, glm::vec2(2.0f, 0.0f));
+	tree.insert_blend_node(model, 16, glm::vec2(-2.0f, 0.0f));
+	tree.insert_blend_node(model, 15, glm::vec2(0.0f, 2.0f));
+	return model;
+}
+
+void benchmark::blend_tree_poses(report& r)
+{
+	const int n_evaluations = 2000;
+	const float dt = 1.0f / 60.0f;
+
+	// Same tree as the 2D blending scene
+	blend_tree tree;
+	int model = create_blend_scene_2d(tree);
+	if (model < 0)
+	{
+		log(r, "could not load the 2D blending scene");
+		return;
+	}
+	blend_node* root = tree.get_root();
+
+	// Blend parameter walking inside the triangulated area
+	auto param = [](int i) {
+		float a = (float)i * 0.01f;
+		return glm::vec2(glm::cos(a), 0.3f + 0.6f * glm::sin(1.3f * a));
+	};
+
+	bool prev_cache = g_pose_cache.enabled();
+	g_pose_cache.set_enabled(false);
+	const model_rsc& rsc = g_resources.get_model_rsc(model);
+
+	// Hash map poses
+	map_pose leaf_poses[3], map_result;
+	std::vector<sampling_context> contexts(root->m_children.size());
+	timer tm;
+	for (int i = 0; i < n_evaluations; ++i)
+	{
+		glm::vec2 p = param(i);
+		float time = (float)i * dt;
+
+		blend_node* n[3];
+		float w[3];
+		if (root->child_weights(p, n, w) < 3)
+		{
+			map_result.clear();
+			continue;
+		}
+
+		const map_pose* poses[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			size_t child = std::find(root->m_children.begin(), root->m_children.end(), n[k]) - root->m_children.begin();
+			map_produce_pos(rsc.m_anims[n[k]->m_anim], time, contexts[child], leaf_poses[k]);
+			poses[k] = &leaf_poses[k];
+		}
+		map_blend_barycentric(poses, w, map_result);
+	}
+	double map_ms = tm.elapsed_ms() / n_evaluations;
+
+	// Dense poses, the pool should stop allocating after the first evaluation
+	tree.set_use_program(false);
+	const dense_pose* result = nullptr;
+	int first_allocations = 0;
+	tm.reset();
+	for (int i = 0; i < n_evaluations; ++i)
+	{
+		tree.set_blend_param(param(i));
+		result = tree.produce_pose((float)i * dt);
+		if (i == 0)
+			first_allocations = tree.get_pose_pool().allocations();
+	}
+	double dense_ms = tm.elapsed_ms() / n_evaluations;
+	int steady_allocations = tree.get_pose_pool().allocations() - first_allocations;
+
+	// Both paths end on the same parameter and time
+	float max_pos = 0.0f, max_rot = 0.0f;
+	int n_joints = 0;
+	for (const auto& it : map_result)
+	{
+		if (!result || it.first >= result->size())
+			continue;
+		const transform& tr = it.second.first;
+		if ((it.second.second & translation) != 0)
+			max_pos = glm::max(max_pos, glm::length(tr.get_position() - result->get_position(it.first)));
+		if ((it.second.second & rotation) != 0)
+			max_rot = glm::max(max_rot, glm::degrees(quat_angle(tr.get_rotation(), result->get_rotation(it.first))));
+		++n_joints;
+	}
+
+	// Same evaluations with the pose cache on, one cache frame per evaluation. After
+	// the first frame neither the pool nor the cache should allocate
+	g_pose_cache.set_enabled(true);
+	int cache_start = g_pose_cache.allocations();
+	int pool_start = tree.get_pose_pool().allocations();
+	int first_cache_allocations = 0;
+	int first_pool_allocations = 0;
+	tm.reset();
+	for (int i = 0; i < n_evaluations; ++i)
+	{
+		g_pose_cache.begin_frame();
+		tree.set_blend_param(param(i));
+		tree.produce_pose((float)i * dt);
+		if (i == 0)
+		{
+			first_cache_allocations = g_pose_cache.allocations() - cache_start;
+			first_pool_allocations = tree.get_pose_pool().allocations() - pool_start;
+		}
+	}
+	double cached_ms = tm.elapsed_ms() / n_evaluations;
+	int steady_cache_allocations = g_pose_cache.allocations() - cache_start - first_cache_allocations;
+	int steady_pool_allocations = tree.get_pose_pool().allocations() - pool_start - first_pool_allocations;
+	g_pose_cache.begin_frame();
+	g_pose_cache.set_enabled(false);
+
+	// Blend step alone, on the poses of the last triangle
+	blend_node* n[3];
+	float w[3];
+	glm::vec2 last_param = param(n_evaluations - 1);
+	root->child_weights(last_param, n, w);
+	const map_pose* map_poses[3] = { &leaf_poses[0], &leaf_poses[1], &leaf_poses[2] };
+	dense_pose leaves[3], blended;
+	const dense_pose* dense_poses[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		produce_pos(model, n[k]->m_anim, leaves[k], (float)(n_evaluations - 1) * dt, n[k]->m_context);
+		dense_poses[k] = &leaves[k];
+	}
+
+	tm.reset();
+	for (int i = 0; i < n_evaluations; ++i)
+		map_blend_barycentric(map_poses, w, map_result);
+	double map_blend_ms = tm.elapsed_ms() / n_evaluations;
+
+	tm.reset();
+	for (int i = 0; i < n_evaluations; ++i)
+		blend_poses(dense_poses, w, 3, blended);
+	double dense_blend_ms = tm.elapsed_ms() / n_evaluations;
+
+	log(r, "2D blend scene, %d clips, %d evaluations, %d animated joints", (int)root->m_children.size(), n_evaluations, n_joints);
+	log(r, "                full evaluation (ms)  blend only (ms)");
+	log(r, "hash map poses  %20.4f  %15.4f", map_ms, map_blend_ms);
+	log(r, "dense poses     %20.4f  %15.4f", dense_ms, dense_blend_ms);
+	log(r, "+ pose cache    %20.4f", cached_ms);
+	log(r, "speedup         %19.2fx  %14.2fx", dense_ms > 0.0 ? map_ms / dense_ms : 0.0, dense_blend_ms > 0.0 ? map_blend_ms / dense_blend_ms : 0.0);
+	log(r, "max difference  %.6f position, %.4f deg rotation", max_pos, max_rot);
+	log(r, "pose pool       %d poses, %d allocations in the first evaluation, %d after", tree.get_pose_pool().size(), first_allocations, steady_allocations);
+	log(r, "with the cache  %d pool and %d cache allocations in the first evaluation, %d and %d after",
+		first_pool_allocations, first_cache_allocations, steady_pool_allocations, steady_cache_allocations);
+	if (steady_allocations || steady_pool_allocations || steady_cache_allocations)
+		log(r, "  FAILED: blend tree evaluation allocates in steady state");
+
+	g_pose_cache.set_enabled(prev_cache);
+	tree.destroy();
+}
+
+// Pose with every channel of every joint animated. Rotations stay within 30
+// degrees of a common orientation, like the clips of a blend tree do
+static void synthetic_pose(unsigned n_joints, int seed, dense_pose& pose)
+{
+	pose.resize(n_joints);
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		float a = (float)(j * 7 + seed * 13);
+		glm::vec3 axis = glm::normalize(glm::vec3(glm::sin((float)j), glm::cos(1.7f * j), 0.5f));
+		glm::quat base = glm::angleAxis(0.3f * (float)(j % 11), axis);
+		glm::quat offset = glm::angleAxis(glm::radians(30.0f) * glm::sin(a), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		pose.set_position(j, glm::vec3(glm::sin(a), glm::cos(a), 0.1f * (float)seed));
+		pose.set_rotation(j, offset * base);
+		pose.set_scale(j, glm::vec3(1.0f + 0.1f * glm::sin(a)));
+	}
+}
+
+// Largest position, rotation (radians) and scale difference between the channels valid in both poses
+static void pose_error(const dense_pose& a, const dense_pose& b, float& pos, float& rot, float& sca)
+{
+	for (unsigned j = 0; j < a.size(); ++j)
+	{
+		unsigned char flags = a.get_flags(j) & b.get_flags(j);
+		if ((flags & translation) != 0)
+			pos = glm::max(pos, glm::length(a.get_position(j) - b.get_position(j)));
+		if ((flags & rotation) != 0)
+			rot = glm::max(rot, quat_angle(a.get_rotation(j), b.get_rotation(j)));
+		if ((flags & scale) != 0)
+			sca = glm::max(sca, glm::length(a.get_scale(j) - b.get_scale(j)));
+	}
+}
+
+void benchmark::pose_blending(report& r)
+{
+	const int n_blends = 20000;
+	const unsigned joint_counts[] = { 67, 256 };
+	const float pos_tolerance = 1e-5f;
+	const float rot_tolerance = glm::radians(0.01f);
+	const simd_level levels[] = { simd_level::scalar, simd_level::sse4, simd_level::avx2 };
+	simd_level best = get_simd_level();
+
+	log(r, "cpu: %s, %d blends, simd tolerance %.0e / %.2f deg against the scalar kernel",
+		simd_level_name(best), n_blends, pos_tolerance, glm::degrees(rot_tolerance));
+	log(r, "time per blend in us, glm: per joint blend with glm (slerp for lerp)");
+	log(r, "%-12s %6s %10s %10s %10s %10s %19s %19s", "kernel", "joints", "glm",
+		"scalar", "sse4", "avx2", "simd err", "glm err");
+
+	for (unsigned n_joints : joint_counts)
+	{
+		dense_pose p0, p1, p2, ref, out, simd_out;
+		synthetic_pose(n_joints, 0, p0);
+		synthetic_pose(n_joints, 1, p1);
+		synthetic_pose(n_joints, 2, p2);
+		const dense_pose* poses[3] = { &p0, &p1, &p2 };
+		const float weights[3] = { 0.2f, 0.5f, 0.3f };
+		const float t = 0.3f;
+		volatile float sink = 0.0f;
+		double to_us = 1000.0 / n_blends;
+
+		for (int kernel = 0; kernel < 2; ++kernel)
+		{
+			bool lerp = kernel == 0;
+
+			// Per joint glm blend, as the blend nodes did it before the dense poses
+			ref.resize(n_joints);
+			timer tm;
+			for (int b = 0; b < n_blends; ++b)
+			{
+				for (unsigned j = 0; j < n_joints; ++j)
+				{
+					if (lerp)
+					{
+						ref.set_position(j, p0.get_position(j) + (p1.get_position(j) - p0.get_position(j)) * t);
+						ref.set_rotation(j, glm::normalize(glm::slerp(p0.get_rotation(j), p1.get_rotation(j), t)));
+						ref.set_scale(j, p0.get_scale(j) + (p1.get_scale(j) - p0.get_scale(j)) * t);
+					}
+					else
+					{
+						ref.set_position(j, weights[0] * p0.get_position(j) + weights[1] * p1.get_position(j) + weights[2] * p2.get_position(j));
+						ref.set_rotation(j, glm::normalize(weights[0] * p0.get_rotation(j) + weights[1] * p1.get_rotation(j) + weights[2] * p2.get_rotation(j)));
+						ref.set_scale(j, weights[0] * p0.get_scale(j) + weights[1] * p1.get_scale(j) + weights[2] * p2.get_scale(j));
+					}
+				}
+				sink = sink + ref.m_data[dense_pose::qw][0];
+			}
+			double ref_ms = tm.elapsed_ms();
+
+			// Each instruction set, checked against the scalar kernel
+			double level_time[3] = { 0.0, 0.0, 0.0 };
+			float pos_err = 0.0f, rot_err = 0.0f, sca_err = 0.0f;
+			for (int l = 0; l < 3; ++l)
+			{
+				if (levels[l] > best)
+					continue;
+
+				dense_pose& dst = l == 0 ? out : simd_out;
+				tm.reset();
+				for (int b = 0; b < n_blends; ++b)
+				{
+					if (lerp)
+						lerp_poses(p0, p1, t, dst, levels[l]);
+					else
+						blend_poses(poses, weights, 3, dst, levels[l]);
+					sink = sink + dst.m_data[dense_pose::qw][0];
+				}
+				level_time[l] = tm.elapsed_ms();
+
+				if (l > 0)
+					pose_error(out, simd_out, pos_err, rot_err, sca_err);
+			}
+
+			// Difference to the per joint blend (nlerp against slerp for the lerp kernel)
+			float ref_pos = 0.0f, ref_rot = 0.0f, ref_sca = 0.0f;
+			pose_error(out, ref, ref_pos, ref_rot, ref_sca);
+
+			log(r, "%-12s %6u %10.4f %10.4f %10.4f %10.4f %8.6f %6.4f deg %8.6f %6.4f deg", lerp ? "lerp" : "barycentric", n_joints,
+				ref_ms * to_us, level_time[0] * to_us, level_time[1] * to_us, level_time[2] * to_us,
+				glm::max(pos_err, sca_err), glm::degrees(rot_err), glm::max(ref_pos, ref_sca), glm::degrees(ref_rot));
+
+			if (glm::max(pos_err, sca_err) > pos_tolerance || rot_err > rot_tolerance)
+				log(r, "  FAILED: simd kernel is outside the error tolerance");
+		}
+	}
+}
+
+void benchmark::blend_pruning(report& r)
+{
+	const float dt = 1.0f / 60.0f;
+	const float epsilons[] = { 0.0f, 0.001f, 0.01f, 0.05f };
+
+	blend_tree tree;
+	if (create_blend_scene_2d(tree) < 0)
+	{
+		log(r, "could not load the 2D blending scene");
+		return;
+	}
+
+	// Grid over the triangulated area, the parameter of a stick often rests on an axis
+	// or a clip. Each point is also taken slightly off, where some weights are tiny
+	std::vector<glm::vec2> params;
+	for (int y = -4; y <= 8; ++y)
+	{
+		for (int x = -8; x <= 8; ++x)
+		{
+			glm::vec2 param(0.25f * x, 0.25f * y);
+			glm::vec2 off = param + glm::vec2(0.004f, 0.003f);
+			if (tree.sample_count(param) > 0)
+				params.push_back(param);
+			if (tree.sample_count(off) > 0)
+				params.push_back(off);
+		}
+	}
+	const int n_repeats = 20;
+	int n_evaluations = (int)params.size() * n_repeats;
+
+	bool prev_cache = g_pose_cache.enabled();
+	float prev_epsilon = tree.get_prune_epsilon();
+	g_pose_cache.set_enabled(false);
+
+	// Runs the grid and returns the time per evaluation, keeps the final pose of every parameter
+	int samples = 0, saved = 0;
+	auto run = [&](float epsilon, std::vector<dense_pose>& poses) {
+		tree.set_prune_epsilon(epsilon);
+		poses.resize(params.size());
+		samples = saved = 0;
+		timer tm;
+		for (int rep = 0; rep < n_repeats; ++rep)
+		{
+			for (size_t i = 0; i < params.size(); ++i)
+			{
+				tree.set_blend_param(params[i]);
+				const dense_pose* pose = tree.produce_pose((float)i * dt);
+				samples += tree.samples();
+				saved += tree.saved_samples();
+				if (rep == 0 && pose)
+					poses[i] = *pose;
+			}
+		}
+		return tm.elapsed_ms() / n_evaluations;
+	};
+
+	// Every child evaluated, even at weight 0
+	std::vector<dense_pose> reference, poses;
+	double full_ms = run(-1.0f, reference);
+	int full_samples = samples;
+
+	log(r, "2D blend scene, %d blend parameters on a grid, %d evaluations", (int)params.size(), n_evaluations);
+	log(r, "%10s %14s %14s %10s %10s %16s", "epsilon", "samples/eval", "saved/eval", "ms/eval", "speedup", "max joint error");
+	log(r, "%10s %14.2f %14.2f %10.4f %10s %16s", "off", (float)full_samples / n_evaluations, 0.0f, full_ms, "", "");
+
+	for (float epsilon : epsilons)
+	{
+		double ms = run(epsilon, poses);
+
+		// Largest local translation or rotation (deg) change against the full evaluation
+		float pos_err = 0.0f, rot_err = 0.0f, sca_err = 0.0f;
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			if (poses[i].size() == reference[i].size())
+				pose_error(poses[i], reference[i], pos_err, rot_err, sca_err);
+		}
+
+		log(r, "%10.3f %14.2f %14.2f %10.4f %9.2fx %8.5f %.3f deg", epsilon, (float)samples / n_evaluations,
+			(float)saved / n_evaluations, ms, ms > 0.0 ? full_ms / ms : 0.0, glm::max(pos_err, sca_err), glm::degrees(rot_err));
+	}
+
+	tree.set_prune_epsilon(prev_epsilon);
+	g_pose_cache.set_enabled(prev_cache);
+	tree.destroy();
+}
+
+void benchmark::blend_program_eval(report& r)
+{
+	const float dt = 1.0f / 60.0f;
+	const int n_repeats = 20;
+
+	blend_tree tree_2d;
+	int model = create_blend_scene_2d(tree_2d);
+	if (model < 0)
+	{
+		log(r, "could not load the 2D blending scene");
+		return;
+	}
+
+	// 1D tree with a 2D node in the middle, the editor only builds flat trees
+	blend_tree nested;
+	nested.create_1d_blend_tree();
+	nested.insert_blend_node(model, 5, glm::vec2(0.0f));
+	nested.insert_blend_node(model, 17, glm::vec2(2.0f, 0.0f));
+	blend_node_2d* inner = new blend_node_2d;
+	inner->m_blend_pos = glm::vec2(1.0f, 0.0f);
+	inner->m_model = model;
+	inner->insert_node(model, 22, glm::vec2(0.0f, 0.0f));
+	inner->insert_node(model, 23, glm::vec2(1.0f, 0.0f));
+	inner->insert_node(model, 24, glm::vec2(0.0f, 1.0f));
+	inner->insert_node(model, 25, glm::vec2(1.0f, 1.0f));
+	nested.insert_blend_subtree(inner);
+
+	bool prev_cache = g_pose_cache.enabled();
+	g_pose_cache.set_enabled(false);
+
+	log(r, "%-8s %6s %6s %8s %12s %12s %10s %10s %10s %16s", "tree", "ops", "poses", "params", "nodes ms", "program ms",
+		"speedup", "compile us", "samples", "max joint error");
+
+	struct test { const char* m_name; blend_tree* m_tree; };
+	test tests[] = { { "2D", &tree_2d }, { "nested", &nested } };
+	for (const test& t : tests)
+	{
+		blend_tree& tree = *t.m_tree;
+
+		// Grid over the blend space, on and slightly off the clips
+		std::vector<glm::vec2> params;
+		for (int y = -4; y <= 8; ++y)
+		{
+			for (int x = -8; x <= 8; ++x)
+			{
+				glm::vec2 param(0.25f * x, 0.25f * y);
+				if (tree.sample_count(param) > 0)
+					params.push_back(param);
+				if (tree.sample_count(param + glm::vec2(0.004f, 0.003f)) > 0)
+					params.push_back(param + glm::vec2(0.004f, 0.003f));
+			}
+		}
+		int n_evaluations = (int)params.size() * n_repeats;
+
+		// Runs the grid and returns the time per evaluation, keeps the final pose of every parameter
+		int samples = 0;
+		auto run = [&](bool use_program, std::vector<dense_pose>& poses) {
+			tree.set_use_program(use_program);
+			poses.resize(params.size());
+			samples = 0;
+			timer tm;
+			for (int rep = 0; rep < n_repeats; ++rep)
+			{
+				for (size_t i = 0; i < params.size(); ++i)
+				{
+					tree.set_blend_param(params[i]);
+					const dense_pose* pose = tree.produce_pose((float)i * dt);
+					samples += tree.samples();
+					if (rep == 0 && pose)
+						poses[i] = *pose;
+				}
+			}
+			return tm.elapsed_ms() / n_evaluations;
+		};
+
+		// Compile time
+		const int n_compiles = 100;
+		timer tm;
+		for (int i = 0; i < n_compiles; ++i)
+			tree.compile();
+		double compile_us = tm.elapsed_ms() * 1000.0 / n_compiles;
+
+		std::vector<dense_pose> reference, poses;
+		double nodes_ms = run(false, reference);
+		int node_samples = samples;
+		double program_ms = run(true, poses);
+
+		// Same kernels and the same weights, the poses should match exactly
+		float pos_err = 0.0f, rot_err = 0.0f, sca_err = 0.0f;
+		int flag_mismatches = 0;
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			if (poses[i].size() != reference[i].size())
+			{
+				++flag_mismatches;
+				continue;
+			}
+			pose_error(poses[i], reference[i], pos_err, rot_err, sca_err);
+			for (unsigned j = 0; j < poses[i].size(); ++j)
+			{
+				if (poses[i].get_flags(j) != reference[i].get_flags(j))
+					++flag_mismatches;
+			}
+		}
+
+		log(r, "%-8s %6d %6d %8d %12.4f %12.4f %9.2fx %10.2f %4.2f/%4.2f %8.5f %.3f deg", t.m_name, tree.get_program().op_count(),
+			tree.get_program().slot_count(), (int)params.size(), nodes_ms, program_ms, program_ms > 0.0 ? nodes_ms / program_ms : 0.0,
+			compile_us, (float)node_samples / n_evaluations, (float)samples / n_evaluations, glm::max(pos_err, sca_err), glm::degrees(rot_err));
+
+		if (node_samples != samples || flag_mismatches > 0 || glm::max(pos_err, sca_err) > 0.0f || rot_err > 0.0f)
+			log(r, "  FAILED: the program does not match the recursive evaluation (%d joint flags differ)", flag_mismatches);
+	}
+
+	g_pose_cache.set_enabled(prev_cache);
+	tree_2d.destroy();
+	nested.destroy();
+}
+
+void benchmark::blend_clip_sharing(report& r)
+{
+	const float dt = 1.0f / 60.0f;
+	const int n_repeats = 20;
+
+	blend_tree scene;
+	int model = create_blend_scene_2d(scene);
+	if (model < 0)
+	{
+		log(r, "could not load the 2D blending scene");
+		return;
+	}
+
+	// Two locomotion spaces that share the idle, forward and right clips
+	blend_tree nested;
+	nested.create_1d_blend_tree();
+	auto add_diamond = [&](float x, const int* anims) {
+		blend_node_2d* node = new blend_node_2d;
+		node->m_blend_pos = glm::vec2(x, 0.0f);
+		node->m_model = model;
+		node->insert_node(model, anims[0], glm::vec2(0.0f, 0.0f));
+		node->insert_node(model, anims[1], glm::vec2(0.0f, 1.0f));
+		node->insert_node(model, anims[2], glm::vec2(-1.0f, 0.0f));
+		node->insert_node(model, anims[3], glm::vec2(1.0f, 0.0f));
+		nested.insert_blend_subtree(node);
+	};
+	const int walk[] = { 5, 22, 23, 24 };
+	const int run[] = { 5, 22, 16, 24 };
+	add_diamond(0.0f, walk);
+	add_diamond(1.0f, run);
+
+	std::vector<glm::vec2> params;
+	for (int y = 0; y <= 4; ++y)
+	{
+		for (int x = -4; x <= 8; ++x)
+			params.push_back(glm::vec2(0.125f * x + 0.004f, 0.25f * y + 0.003f));
+	}
+	int n_evaluations = (int)params.size() * n_repeats;
+
+	bool prev_cache = g_pose_cache.enabled();
+	float prev_step = g_pose_cache.get_step();
+	g_pose_cache.set_enabled(false);
+
+	// Leaves of the same tree, the recursive evaluation samples every leaf
+	log(r, "Nested 1D tree of two 2D spaces sharing 3 of their 4 clips, %d blend parameters", (int)params.size());
+	log(r, "%-10s %14s %14s %10s %16s", "", "samples/eval", "shared/eval", "ms/eval", "max joint error");
+	std::vector<dense_pose> reference(params.size()), poses(params.size());
+	double ms[2];
+	int samples[2], shared[2];
+	for (int k = 0; k < 2; ++k)
+	{
+		nested.set_use_program(k == 1);
+		std::vector<dense_pose>& out = k == 0 ? reference : poses;
+		samples[k] = shared[k] = 0;
+		timer tm;
+		for (int rep = 0; rep < n_repeats; ++rep)
+		{
+			for (size_t i = 0; i < params.size(); ++i)
+			{
+				nested.set_blend_param(params[i]);
+				const dense_pose* pose = nested.produce_pose((float)i * dt);
+				samples[k] += nested.samples();
+				shared[k] += nested.shared_samples();
+				if (rep == 0 && pose)
+					out[i] = *pose;
+			}
+		}
+		ms[k] = tm.elapsed_ms() / n_evaluations;
+	}
+	float pos_err = 0.0f, rot_err = 0.0f, sca_err = 0.0f;
+	for (size_t i = 0; i < params.size(); ++i)
+	{
+		if (poses[i].size() == reference[i].size())
+			pose_error(poses[i], reference[i], pos_err, rot_err, sca_err);
+	}
+	log(r, "%-10s %14.2f %14.2f %10.4f", "nodes", (float)samples[0] / n_evaluations, 0.0f, ms[0]);
+	log(r, "%-10s %14.2f %14.2f %10.4f %8.5f %.3f deg", "program", (float)samples[1] / n_evaluations,
+		(float)shared[1] / n_evaluations, ms[1], glm::max(pos_err, sca_err), glm::degrees(rot_err));
+
+	// Several instances of the 2D scene on the same clock, with different blend parameters
+	const int n_trees = 16;
+	const int n_frames = 200;
+	std::vector<blend_tree> trees(n_trees);
+	for (auto& t : trees)
+		create_blend_scene_2d(t);
+
+	log(r, "");
+	log(r, "%d instances of the 2D scene on the same clock, %d frames", n_trees, n_frames);
+	log(r, "%-10s %14s %14s %10s", "", "samples/frame", "cache hits", "ms/frame");
+	for (int k = 0; k < 2; ++k)
+	{
+		// No quantization, only equal times share a pose
+		g_pose_cache.set_enabled(k == 1);
+		g_pose_cache.set_step(0.0f);
+
+		int n_samples = 0, n_hits = 0;
+		timer tm;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_pose_cache.begin_frame();
+			for (int i = 0; i < n_trees; ++i)
+			{
+				float a = (float)(f + 7 * i) * 0.05f;
+				trees[i].set_blend_param(glm::vec2(0.9f * glm::cos(a), 0.3f + 0.6f * glm::sin(a)));
+				trees[i].produce_pose((float)f * dt);
+				n_samples += trees[i].samples();
+			}
+			n_hits += g_pose_cache.hits();
+		}
+		log(r, "%-10s %14.2f %14.2f %10.4f", k == 0 ? "no cache" : "pose cache", (float)(n_samples - n_hits) / n_frames,
+			(float)n_hits / n_frames, tm.elapsed_ms() / n_frames);
+	}
+
+	g_pose_cache.begin_frame();
+	g_pose_cache.set_step(prev_step);
+	g_pose_cache.set_enabled(prev_cache);
+	for (auto& t : trees)
+		t.destroy();
+	scene.destroy();
+	nested.destroy();
+}
+
+void benchmark::blend_space_location(report& r)
+{
+	const int n_queries = 20000;
+	const int sizes[] = { 8, 64, 256, 1024 };
+
+	log(r, "Queries along a path (scan, walk from the last triangle, grid only, 64x64 table) and random jumps");
+	log(r, "%8s %10s %10s %10s %10s %10s %10s %12s", "samples", "triangles", "scan ns", "walk ns", "grid ns", "table ns",
+		"jump ns", "max w error");
+	for (int n_points : sizes)
+	{
+		// Jittered lattice over [-1, 1], like a captured locomotion set
+		std::vector<glm::vec2> points;
+		int side = glm::max(2, (int)glm::ceil(glm::sqrt((float)n_points)));
+		unsigned seed = 12345u;
+		auto random = [&seed]() {
+			seed = seed * 1664525u + 1013904223u;
+			return (float)(seed >> 8) / (float)(1u << 24);
+		};
+		for (int i = 0; i < n_points; ++i)
+		{
+			glm::vec2 cell((float)(i % side), (float)(i / side));
+			glm::vec2 jitter(random() - 0.5f, random() - 0.5f);
+			points.push_back((cell + 0.5f + 0.6f * jitter) / (float)side * 2.0f - 1.0f);
+		}
+
+		std::vector<double> coords;
+		for (const auto& p : points)
+		{
+			coords.push_back(p.x);
+			coords.push_back(p.y);
+		}
+		delaunator::Delaunator del(coords);
+		std::vector<std::array<unsigned int, 3>> triangles(del.triangles.size() / 3);
+		for (size_t i = 0; i < triangles.size(); ++i)
+			triangles[i] = { (unsigned)del.triangles[3 * i], (unsigned)del.triangles[3 * i + 1], (unsigned)del.triangles[3 * i + 2] };
+
+		glm::vec2 min = points[0], max = points[0];
+		for (const auto& p : points)
+		{
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		triangle_locator locator;
+		locator.build(points, triangles, min, max);
+
+		// Stick-like path through the space, and random jumps
+		std::vector<glm::vec2> path(n_queries), jumps(n_queries);
+		for (int i = 0; i < n_queries; ++i)
+		{
+			float a = (float)i * 0.002f;
+			path[i] = glm::vec2(0.8f * glm::cos(a), 0.8f * glm::sin(1.7f * a));
+			jumps[i] = glm::vec2(random(), random()) * 1.8f - 0.9f;
+		}
+
+		// Every triangle in turn, as the nodes did before
+		std::vector<glm::vec4> scan_out(n_queries);
+		timer tm;
+		for (int i = 0; i < n_queries; ++i)
+		{
+			const glm::vec2& p = path[i];
+			scan_out[i] = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			for (size_t t = 0; t < triangles.size(); ++t)
+			{
+				const glm::vec2& p0 = points[triangles[t][0]];
+				const glm::vec2& p1 = points[triangles[t][1]];
+				const glm::vec2& p2 = points[triangles[t][2]];
+				glm::vec2 e0 = p2 - p0, e1 = p1 - p0;
+				float area = glm::abs(e0.x * e1.y - e0.y * e1.x);
+				glm::vec2 pp0 = p0 - p, pp1 = p1 - p, pp2 = p2 - p;
+				float a0 = (pp2.x * pp1.y - pp2.y * pp1.x) / area;
+				float a1 = (pp0.x * pp2.y - pp0.y * pp2.x) / area;
+				float a2 = (pp1.x * pp0.y - pp1.y * pp0.x) / area;
+				if (a0 >= 0.0f && a1 >= 0.0f && a2 >= 0.0f)
+				{
+					scan_out[i] = glm::vec4(a0, a1, a2, (float)t);
+					break;
+				}
+			}
+		}
+		double scan_ns = tm.elapsed_ms() * 1e6 / n_queries;
+
+		// Runs the queries and keeps the weights of each one
+		auto run = [&](const std::vector<glm::vec2>& queries, bool use_hint, std::vector<glm::vec4>& out) {
+			out.resize(queries.size());
+			int hint = -1;
+			timer tm;
+			for (size_t i = 0; i < queries.size(); ++i)
+			{
+				float w[3];
+				int t = locator.locate(queries[i], use_hint ? hint : -1, w);
+				hint = t;
+				out[i] = glm::vec4(w[0], w[1], w[2], (float)t);
+			}
+			return tm.elapsed_ms() * 1e6 / queries.size();
+		};
+
+		std::vector<glm::vec4> walk_out, grid_out, table_out, jump_out;
+		double walk_ns = run(path, true, walk_out);
+		double grid_ns = run(path, false, grid_out);
+		double jump_ns = run(jumps, true, jump_out);
+		locator.bake(64);
+		double table_ns = run(path, true, table_out);
+
+		// Weight of a sample in a query result (0 if it is not in the triangle)
+		auto sample_weight = [&](const glm::vec4& q, unsigned sample) {
+			if (q.w < 0.0f)
+				return 0.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (triangles[(int)q.w][k] == sample)
+					return q[k];
+			}
+			return 0.0f;
+		};
+
+		// On an edge the triangle may differ from the scan, the weights of the samples do not
+		float max_error = 0.0f;
+		for (int i = 0; i < n_queries; ++i)
+		{
+			const glm::vec4& ref = scan_out[i];
+			for (const glm::vec4* q : { &walk_out[i], &grid_out[i], &table_out[i] })
+			{
+				if ((q->w < 0.0f) != (ref.w < 0.0f))
+				{
+					max_error = 1.0f;
+					continue;
+				}
+				for (const glm::vec4* a : { q, &ref })
+				{
+					if (a->w < 0.0f)
+						continue;
+					for (int k = 0; k < 3; ++k)
+					{
+						unsigned sample = triangles[(int)a->w][k];
+						max_error = glm::max(max_error, glm::abs(sample_weight(*q, sample) - sample_weight(ref, sample)));
+					}
+				}
+			}
+		}
+
+		log(r, "%8d %10d %10.1f %10.1f %10.1f %10.1f %10.1f %12.2e", n_points, (int)triangles.size(), scan_ns, walk_ns, grid_ns,
+			table_ns, jump_ns, max_error);
+	}
+}
+
+// Delaunator triangles of the points, each one starting at its smallest index, sorted
+static std::vector<std::array<unsigned int, 3>> full_triangulation(const std::vector<glm::vec2>& points)
+{
+	std::vector<double> coords;
+	for (const auto& p : points)
+	{
+		coords.push_back(p.x);
+		coords.push_back(p.y);
+	}
+	delaunator::Delaunator del(coords);
+	std::vector<std::array<unsigned int, 3>> triangles(del.triangles.size() / 3);
+	for (size_t i = 0; i < triangles.size(); ++i)
+		triangles[i] = { (unsigned)del.triangles[3 * i], (unsigned)del.triangles[3 * i + 1], (unsigned)del.triangles[3 * i + 2] };
+	return triangles;
+}
+
+// Same winding, each triangle rotated to start at its smallest index, sorted
+static void sort_triangles(std::vector<std::array<unsigned int, 3>>& triangles)
+{
+	for (auto& t : triangles)
+	{
+		while (t[0] > t[1] || t[0] > t[2])
+			t = { t[1], t[2], t[0] };
+	}
+	std::sort(triangles.begin(), triangles.end());
+}
+
+void benchmark::blend_space_editing(report& r)
+{
+	unsigned seed = 777u;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) / (float)(1u << 24);
+	};
+
+	// Random edits on points in general position, compared with a full rebuild after each one
+	{
+		const int n_points = 200;
+		const int n_edits = 600;
+		std::vector<glm::vec2> points;
+		delaunay_triangulation del;
+		int mismatches = 0;
+		int n_inserts = 0, n_moves = 0, n_removes = 0;
+		std::vector<std::array<unsigned int, 3>> a, b;
+		auto check = [&]() {
+			del.get_triangles(a);
+			b = points.size() >= 3 ? full_triangulation(points) : std::vector<std::array<unsigned int, 3>>();
+			sort_triangles(a);
+			sort_triangles(b);
+			if (a != b)
+				++mismatches;
+		};
+
+		for (int i = 0; i < n_points; ++i)
+		{
+			points.push_back(glm::vec2(random(), random()) * 2.0f - 1.0f);
+			del.insert(points.back());
+			++n_inserts;
+			check();
+		}
+		for (int i = 0; i < n_edits; ++i)
+		{
+			int op = (int)(random() * 3.0f);
+			int point = glm::min((int)(random() * points.size()), (int)points.size() - 1);
+			glm::vec2 p = glm::vec2(random(), random()) * 2.4f - 1.2f;
+			if (op == 0)
+			{
+				points.push_back(p);
+				del.insert(p);
+				++n_inserts;
+			}
+			else if (op == 1)
+			{
+				points[point] = p;
+				del.move(point, p);
+				++n_moves;
+			}
+			else if (points.size() > 3)
+			{
+				points.erase(points.begin() + point);
+				del.remove(point);
+				++n_removes;
+			}
+			check();
+		}
+		log(r, "Random points: %d inserts, %d moves, %d removes, %d results differ from delaunator, %d full rebuilds",
+			n_inserts, n_moves, n_removes, mismatches, del.full_rebuilds());
+		if (mismatches > 0)
+			log(r, "  FAILED: the incremental triangulation does not match a full rebuild");
+	}
+
+	// Lattice with cocircular points, the triangulation is not unique so compare the triangle
+	// count and the empty circle property
+	{
+		const int side = 12;
+		std::vector<glm::vec2> points;
+		delaunay_triangulation del;
+		for (int i = 0; i < side * side; ++i)
+		{
+			points.push_back(glm::vec2((float)(i % side), (float)(i / side)));
+			del.insert(points.back());
+		}
+		for (int i = 0; i < 40; ++i)
+		{
+			int point = glm::min((int)(random() * points.size()), (int)points.size() - 1);
+			points.erase(points.begin() + point);
+			del.remove(point);
+		}
+
+		std::vector<std::array<unsigned int, 3>> a;
+		del.get_triangles(a);
+		size_t expected = full_triangulation(points).size();
+		int violations = 0;
+		for (const auto& t : a)
+		{
+			// Clockwise triangle, a point inside the circle gives a negative determinant
+			const glm::vec2& p0 = points[t[0]];
+			const glm::vec2& p1 = points[t[1]];
+			const glm::vec2& p2 = points[t[2]];
+			for (const auto& p : points)
+			{
+				glm::dvec2 d0 = glm::dvec2(p0 - p), d1 = glm::dvec2(p1 - p), d2 = glm::dvec2(p2 - p);
+				double det = glm::dot(d0, d0) * (d1.x * d2.y - d2.x * d1.y) - glm::dot(d1, d1) * (d0.x * d2.y - d2.x * d0.y) +
+					glm::dot(d2, d2) * (d0.x * d1.y - d1.x * d0.y);
+				if (det < -1e-9)
+					++violations;
+			}
+		}
+		log(r, "Lattice %dx%d with 40 removes: %d triangles (delaunator %d), %d points inside a circle, %d full rebuilds",
+			side, side, (int)a.size(), (int)expected, violations, del.full_rebuilds());
+		if (a.size() != expected || violations > 0)
+			log(r, "  FAILED: the lattice triangulation is not Delaunay");
+	}
+
+	// Building a blend space one sample at a time, and moving samples
+	log(r, "");
+	log(r, "%8s %16s %16s %14s %14s", "samples", "build full (ms)", "build incr (ms)", "move full us", "move incr us");
+	const int sizes[] = { 64, 256, 1024 };
+	for (int n_points : sizes)
+	{
+		std::vector<glm::vec2> points;
+		for (int i = 0; i < n_points; ++i)
+			points.push_back(glm::vec2(random(), random()) * 2.0f - 1.0f);
+
+		// Every insertion triangulates all the points, as the nodes did before
+		timer tm;
+		size_t n_triangles = 0;
+		for (int i = 3; i <= n_points; ++i)
+			n_triangles += full_triangulation(std::vector<glm::vec2>(points.begin(), points.begin() + i)).size();
+		double full_ms = tm.elapsed_ms();
+
+		tm.reset();
+		delaunay_triangulation del;
+		for (const auto& p : points)
+			del.insert(p);
+		double incr_ms = tm.elapsed_ms();
+
+		// Small moves, like dragging a sample in the editor
+		const int n_moves = 200;
+		tm.reset();
+		for (int i = 0; i < n_moves; ++i)
+		{
+			int point = i * 7 % n_points;
+			points[point] += glm::vec2(random() - 0.5f, random() - 0.5f) * 0.01f;
+			n_triangles += full_triangulation(points).size();
+		}
+		double move_full_us = tm.elapsed_ms() * 1000.0 / n_moves;
+
+		tm.reset();
+		for (int i = 0; i < n_moves; ++i)
+		{
+			int point = i * 7 % n_points;
+			del.move(point, points[point]);
+		}
+		double move_incr_us = tm.elapsed_ms() * 1000.0 / n_moves;
+
+		log(r, "%8d %16.3f %16.3f %14.2f %14.2f", n_points, full_ms, incr_ms, move_full_us, move_incr_us);
+		if (n_triangles == 0)
+			log(r, "  no triangles");
+	}
+}
+
+// Largest difference between the channels of two poses valid in the mask, -1 if
+// their validity differs (outside of the mask nothing can be valid)
+static float masked_pose_error(const dense_pose& full, const dense_pose& masked, const bone_mask& mask)
+{
+	float error = 0.0f;
+	for (unsigned j = 0; j < full.size(); ++j)
+	{
+		unsigned char flags = full.get_flags(j) & mask.get_flags(j);
+		if (masked.get_flags(j) != flags)
+			return -1.0f;
+		if ((flags & translation) != 0)
+			error = glm::max(error, glm::length(full.get_position(j) - masked.get_position(j)));
+		if ((flags & rotation) != 0)
+			error = glm::max(error, quat_angle(full.get_rotation(j), masked.get_rotation(j)));
+		if ((flags & scale) != 0)
+			error = glm::max(error, glm::length(full.get_scale(j) - masked.get_scale(j)));
+	}
+	return error;
+}
+
+void benchmark::bone_mask_layers(report& r)
+{
+	std::string bot = "data/assets/MIXAMO/xbot.gltf";
+	import_gltf_file(bot.c_str());
+	if (!g_resources.model_registered(bot.c_str()))
+	{
+		log(r, "%s not available", bot.c_str());
+		return;
+	}
+	int model_idx = g_resources.get_model_id(bot);
+	const model_rsc& model = g_resources.get_model_rsc(model_idx);
+	if (model.m_anims.size() < 23)
+	{
+		log(r, "not enough clips in %s", bot.c_str());
+		return;
+	}
+
+	// Upper body, the subtree of the first spine joint
+	int spine = -1;
+	int arm = -1;
+	unsigned n_joints = 0;
+	auto ends_with = [](const std::string& name, const std::string& end) {
+		return name.size() >= end.size() && name.compare(name.size() - end.size(), end.size(), end) == 0;
+	};
+	for (const auto& n : model.m_nodes)
+	{
+		n_joints = glm::max(n_joints, (unsigned)n.first + 1);
+		if (ends_with(n.second.m_name, "Spine"))
+			spine = n.first;
+		if (ends_with(n.second.m_name, "LeftArm"))
+			arm = n.first;
+	}
+	if (spine < 0 || arm < 0)
+	{
+		log(r, "no spine or arm joint in %s", bot.c_str());
+		return;
+	}
+	bone_mask upper, rotations, left_arm;
+	build_bone_mask(model, spine, translation | rotation | scale, n_joints, upper);
+	build_bone_mask(model, spine, rotation, n_joints, rotations);
+	build_bone_mask(model, arm, translation | rotation | scale, n_joints, left_arm);
+	auto block_count = [](const bone_mask& mask) {
+		unsigned n_blocks = 0;
+		for (const auto& span : mask.m_spans)
+			n_blocks += (span.second - span.first) / 8;
+		return n_blocks;
+	};
+	log(r, "xbot: %u joints in %u blocks of 8, upper body %u joints (%u blocks), left arm %u joints (%u blocks)",
+		n_joints, (n_joints + 7) / 8, upper.joint_count(), block_count(upper), left_arm.joint_count(), block_count(left_arm));
+
+	const animation& base_clip = model.m_anims[5];
+	const animation& layer_clip = model.m_anims[22];
+	const int n_frames = 1000;
+
+	// Masked sampling gives the full pose on the joints of the mask, on both paths
+	{
+		float error = 0.0f;
+		bool valid = true;
+		for (int baked = 0; baked < 2; ++baked)
+		{
+			for (const bone_mask* mask : { &upper, &rotations, &left_arm })
+			{
+				dense_pose full, masked;
+				sampling_context c0, c1;
+				int cursor0 = 1, cursor1 = 1;
+				for (int f = 0; f < 100; ++f)
+				{
+					float t = f * layer_clip.m_max_time / 100.0f;
+					sample_clip(layer_clip, t, baked != 0, true, c0, &cursor0, n_joints, full);
+					sample_clip(layer_clip, t, baked != 0, true, c1, &cursor1, n_joints, masked, nullptr, -1, mask);
+					float e = masked_pose_error(full, masked, *mask);
+					valid = valid && e >= 0.0f;
+					error = glm::max(error, e);
+				}
+			}
+		}
+		log(r, "Masked sampling: largest difference from the full pose %.2e, validity %s", error, valid ? "matches" : "differs");
+		if (!valid || error > 1e-5f)
+			log(r, "  FAILED: masked sampling does not match the full pose");
+	}
+
+	// Layers: an override at full weight replaces the masked joints, an additive
+	// layer with its own reference changes nothing
+	{
+		dense_pose base, layer, reference, result;
+		sampling_context c0, c1;
+		int cursor0 = 1, cursor1 = 1;
+		sample_clip(base_clip, 0.3f, true, true, c0, &cursor0, n_joints, base);
+		sample_clip(layer_clip, 0.6f, true, true, c1, &cursor1, n_joints, layer, nullptr, -1, &upper);
+
+		result = base;
+		apply_layer(result, layer, nullptr, upper, 1.0f);
+		float override_error = 0.0f;
+		for (unsigned j = 0; j < n_joints; ++j)
+		{
+			const dense_pose& expected = upper.get_flags(j) != 0 && layer.get_flags(j) != 0 ? layer : base;
+			if (result.get_flags(j) != (base.get_flags(j) | layer.get_flags(j)))
+				override_error = 1.0f;
+			if (expected.is_valid(j, rotation))
+				override_error = glm::max(override_error, quat_angle(expected.get_rotation(j), result.get_rotation(j)));
+			if (expected.is_valid(j, translation))
+				override_error = glm::max(override_error, glm::length(expected.get_position(j) - result.get_position(j)));
+		}
+
+		result = base;
+		apply_layer(result, layer, &layer, upper, 0.7f);
+		float additive_error = 0.0f;
+		for (unsigned j = 0; j < n_joints; ++j)
+		{
+			if (base.is_valid(j, rotation))
+				additive_error = glm::max(additive_error, quat_angle(base.get_rotation(j), result.get_rotation(j)));
+			if (base.is_valid(j, translation))
+				additive_error = glm::max(additive_error, glm::length(base.get_position(j) - result.get_position(j)));
+		}
+		log(r, "Override at weight 1: error %.2e, additive of the reference: error %.2e", override_error, additive_error);
+		if (override_error > 1e-4f || additive_error > 1e-4f)
+			log(r, "  FAILED: layers do not blend as expected");
+	}
+
+	// Cost of sampling the layer clip
+	log(r, "");
+	log(r, "%-12s %12s %12s %12s %12s", "us/sample", "full", "upper body", "upper rot", "left arm");
+	for (int baked = 1; baked >= 0; --baked)
+	{
+		double times[4];
+		const bone_mask* masks[] = { nullptr, &upper, &rotations, &left_arm };
+		volatile float sink = 0.0f;
+		for (int m = 0; m < 4; ++m)
+		{
+			dense_pose pose;
+			sampling_context context;
+			int cursor = 1;
+			timer tm;
+			for (int f = 0; f < n_frames; ++f)
+			{
+				float t = f * layer_clip.m_max_time / n_frames;
+				sample_clip(layer_clip, t, baked != 0, true, context, &cursor, n_joints, pose, nullptr, -1, masks[m]);
+				sink = sink + pose.m_data[dense_pose::qw][spine];
+			}
+			times[m] = tm.elapsed_ms() * 1000.0 / n_frames;
+		}
+		log(r, "%-12s %12.3f %12.3f %12.3f %12.3f", baked ? "baked" : "curves", times[0], times[1], times[2], times[3]);
+	}
+
+	// Whole layer, sampling the full clip and overriding the upper body against
+	// sampling the upper body only
+	{
+		dense_pose base, layer, result;
+		sampling_context c0, c1;
+		int cursor0 = 1, cursor1 = 1;
+		sample_clip(base_clip, 0.0f, true, true, c0, &cursor0, n_joints, base);
+		double times[2];
+		for (int m = 0; m < 2; ++m)
+		{
+			timer tm;
+			for (int f = 0; f < n_frames; ++f)
+			{
+				float t = f * layer_clip.m_max_time / n_frames;
+				sample_clip(layer_clip, t, false, true, c1, &cursor1, n_joints, layer, nullptr, -1, m ? &upper : nullptr);
+				result = base;
+				apply_layer(result, layer, nullptr, upper, 0.8f);
+			}
+			times[m] = tm.elapsed_ms() * 1000.0 / n_frames;
+		}
+		log(r, "Upper body override layer (curves): %.3f us with full sampling, %.3f us masked", times[0], times[1]);
+	}
+}
+
+// Largest rotation between the joints of two poses, in degrees
+static float largest_joint_angle(const dense_pose& a, const dense_pose& b)
+{
+	float angle = 0.0f;
+	unsigned n_joints = glm::min(a.size(), b.size());
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		if (a.is_valid(j, rotation) && b.is_valid(j, rotation))
+			angle = glm::max(angle, quat_angle(a.get_rotation(j), b.get_rotation(j)));
+	}
+	return glm::degrees(angle);
+}
+
+void benchmark::transition_cost(report& r)
+{
+	std::string bot = "data/assets/MIXAMO/xbot.gltf";
+	import_gltf_file(bot.c_str());
+	if (!g_resources.model_registered(bot.c_str()))
+	{
+		log(r, "%s not available", bot.c_str());
+		return;
+	}
+	int model_idx = g_resources.get_model_id(bot);
+	const model_rsc& model = g_resources.get_model_rsc(model_idx);
+	if (model.m_anims.size() < 23)
+	{
+		log(r, "not enough clips in %s", bot.c_str());
+		return;
+	}
+	unsigned n_joints = 0;
+	for (const auto& n : model.m_nodes)
+		n_joints = glm::max(n_joints, (unsigned)n.first + 1);
+
+	// Walk to run at 60 frames per second
+	const animation& from = model.m_anims[22];
+	const animation& to = model.m_anims[15];
+	const float dt = 1.0f / 60.0f;
+	const float blend_time = 0.3f;
+	const int n_frames = (int)glm::ceil(blend_time / dt);
+	auto wrap = [](const animation& anim, float t) { return t - glm::floor(t / anim.m_max_time) * anim.m_max_time; };
+
+	// Pose continuity at the switch and after the blend time
+	{
+		const float switch_time = 0.5f;
+		dense_pose prev, current, target, shown;
+		sampling_context context;
+		int cursor = 1;
+		sample_clip(from, switch_time - dt, true, true, context, &cursor, n_joints, prev);
+		sample_clip(from, switch_time, true, true, context, &cursor, n_joints, current);
+
+		// The source one frame later, where the first shown pose should be close to
+		dense_pose next;
+		sample_clip(from, switch_time + dt, true, true, context, &cursor, n_joints, next);
+
+		inertializer in;
+		in.begin(prev, current, dt, blend_time);
+		float first_jump = 0.0f;
+		float largest_step = 0.0f;
+		float end_error = 0.0f;
+		dense_pose last = current;
+		for (int f = 1; f <= n_frames + 2; ++f)
+		{
+			sample_clip(to, f * dt, true, true, context, &cursor, n_joints, target);
+			shown = target;
+			in.apply(shown, dt);
+			if (f == 1)
+				first_jump = largest_joint_angle(next, shown);
+			largest_step = glm::max(largest_step, largest_joint_angle(last, shown));
+			if (f * dt >= blend_time)
+				end_error = glm::max(end_error, largest_joint_angle(target, shown));
+			last = shown;
+		}
+
+		sample_clip(to, dt, true, true, context, &cursor, n_joints, target);
+		float snap = largest_joint_angle(current, target);
+		log(r, "Walk to run, %.2f s: snap jump %.2f deg, inertialized first frame %.2f deg from the walk, "
+			"largest step %.2f deg, %.4f deg from the run after the blend", blend_time, snap, first_jump, largest_step, end_error);
+		if (first_jump >= snap || largest_step >= snap || end_error > 1e-3f || in.active())
+			log(r, "  FAILED: the transition is not continuous");
+	}
+
+	// Cost per transitioning character and frame
+	log(r, "");
+	log(r, "Cost per character and frame of a %d frame transition, and of recording the switch", n_frames);
+	log(r, "%-8s %16s %16s %16s", "", "crossfade us", "inertial us", "record us");
+	const int n_characters = 200;
+	for (int baked = 1; baked >= 0; --baked)
+	{
+		volatile float sink = 0.0f;
+		std::vector<dense_pose> sources(n_characters), targets(n_characters), shown(n_characters);
+		std::vector<sampling_context> contexts(2 * n_characters);
+		std::vector<int> cursors(2 * n_characters, 1);
+
+		// Crossfade, both clips are sampled and lerped
+		timer tm;
+		for (int f = 1; f <= n_frames; ++f)
+		{
+			float alpha = glm::min(f * dt / blend_time, 1.0f);
+			for (int c = 0; c < n_characters; ++c)
+			{
+				float t = 0.01f * c + f * dt;
+				sample_clip(from, wrap(from, t), baked != 0, true, contexts[2 * c], &cursors[2 * c], n_joints, sources[c]);
+				sample_clip(to, wrap(to, t), baked != 0, true, contexts[2 * c + 1], &cursors[2 * c + 1], n_joints, targets[c]);
+				lerp_poses(sources[c], targets[c], alpha, shown[c]);
+				sink = sink + shown[c].m_data[dense_pose::qw][0];
+			}
+		}
+		double crossfade = tm.elapsed_ms() * 1000.0 / (n_frames * n_characters);
+
+		// Inertialization, the offsets are recorded once and only the run is sampled
+		std::vector<inertializer> inertializers(n_characters);
+		for (int c = 0; c < n_characters; ++c)
+		{
+			sample_clip(from, 0.01f * c, baked != 0, true, contexts[2 * c], &cursors[2 * c], n_joints, targets[c]);
+			sample_clip(from, 0.01f * c + dt, baked != 0, true, contexts[2 * c], &cursors[2 * c], n_joints, sources[c]);
+		}
+		tm.reset();
+		for (int c = 0; c < n_characters; ++c)
+			inertializers[c].begin(targets[c], sources[c], dt, blend_time);
+		double start = tm.elapsed_ms() * 1000.0 / n_characters;
+
+		tm.reset();
+		for (int f = 1; f <= n_frames; ++f)
+		{
+			for (int c = 0; c < n_characters; ++c)
+			{
+				float t = 0.01f * c + f * dt;
+				sample_clip(to, wrap(to, t), baked != 0, true, contexts[2 * c + 1], &cursors[2 * c + 1], n_joints, shown[c]);
+				inertializers[c].apply(shown[c], dt);
+				sink = sink + shown[c].m_data[dense_pose::qw][0];
+			}
+		}
+		double inertial = (tm.elapsed_ms() * 1000.0 + start * n_characters) / (n_frames * n_characters);
+		log(r, "%-8s %16.3f %16.3f %16.3f", baked ? "baked" : "curves", crossfade, inertial, start);
+	}
+}
+
+// Node as it was before the transform hierarchy, transforms stored in each node
+struct tree_node
+{
+	std::string m_name;
+	tree_node* m_parent = nullptr;
+	std::vector<tree_node*> m_children;
+	transform m_local;
+	transform m_world;
+};
+
+static void propagate_rec(tree_node* n, const transform& parent_world)
+{
+	n->m_world = parent_world.concatenate(n->m_local);
+	for (tree_node* child : n->m_children)
+		propagate_rec(child, n->m_world);
+}
+
+void benchmark::transform_propagation(report& r)
+{
+	// Instances of a skeleton with chains and branches under one root
+	const int n_instances = 1000;
+	const int n_joints = 100;
+	const int n_nodes = 1 + n_instances * n_joints;
+	auto joint_parent = [](int j) { return j % 4 != 0 ? j - 1 : j / 2; };
+
+	std::vector<tree_node*> tree(n_nodes);
+	for (int i = 0; i < n_nodes; ++i)
+	{
+		tree[i] = new tree_node;
+		tree[i]->m_name = "node" + std::to_string(i);
+		float a = 0.37f * i;
+		tree[i]->m_local.set_position(glm::vec3(glm::sin(a), 0.5f + 0.25f * glm::cos(1.3f * a), 0.1f * glm::sin(2.1f * a)));
+		tree[i]->m_local.set_rotation(glm::angleAxis(0.2f * glm::sin(0.7f * a), glm::normalize(glm::vec3(glm::cos(a), 1.0f, glm::sin(a)))));
+		tree[i]->m_local.set_scale(glm::vec3(1.0f + 0.01f * glm::sin(1.7f * a)));
+	}
+	std::vector<int> parents(n_nodes, -1);
+	for (int k = 0; k < n_instances; ++k)
+	{
+		int base = 1 + k * n_joints;
+		for (int j = 0; j < n_joints; ++j)
+			parents[base + j] = j == 0 ? 0 : base + joint_parent(j);
+	}
+	for (int i = 1; i < n_nodes; ++i)
+	{
+		tree[i]->m_parent = tree[parents[i]];
+		tree[parents[i]]->m_children.push_back(tree[i]);
+	}
+
+	// The same hierarchy in its own store, created in the same order
+	transform_hierarchy flat;
+	std::vector<int> handles(n_nodes);
+	for (int i = 0; i < n_nodes; ++i)
+	{
+		handles[i] = flat.create();
+		flat.position(handles[i], transform_hierarchy::local) = tree[i]->m_local.get_position();
+		flat.rotation(handles[i], transform_hierarchy::local) = tree[i]->m_local.get_rotation();
+		flat.scale(handles[i], transform_hierarchy::local) = tree[i]->m_local.get_scale();
+	}
+	for (int i = 1; i < n_nodes; ++i)
+		flat.set_parent(handles[i], handles[parents[i]]);
+
+	// Both give the same world transforms
+	propagate_rec(tree[0], transform());
+	flat.update_world();
+	float max_error = 0.0f;
+	for (int i = 0; i < n_nodes; ++i)
+	{
+		const transform& w = tree[i]->m_world;
+		glm::vec3 dp = flat.position(handles[i], transform_hierarchy::world) - w.get_position();
+		glm::quat dq = flat.rotation(handles[i], transform_hierarchy::world) - w.get_rotation();
+		glm::vec3 ds = flat.scale(handles[i], transform_hierarchy::world) - w.get_scale();
+		max_error = glm::max(max_error, glm::max(glm::length(dp), glm::max(glm::length(dq), glm::length(ds))));
+	}
+	log(r, "%d nodes, %d instances of %d joints", n_nodes, n_instances, n_joints);
+	log(r, "Largest difference between the recursive and linear world transforms %g", max_error);
+	if (max_error > 1e-4f)
+		log(r, "  FAILED: the world transforms do not match");
+
+	// Propagation time
+	const int n_runs = 20;
+	timer tm;
+	for (int k = 0; k < n_runs; ++k)
+		propagate_rec(tree[0], transform());
+	double recursive = tm.elapsed_ms() / n_runs;
+
+	tm.reset();
+	for (int k = 0; k < n_runs; ++k)
+	{
+		flat.set_dirty(handles[0]);
+		flat.update_world();
+	}
+	double linear = tm.elapsed_ms() / n_runs;
+
+	log(r, "");
+	log(r, "%-12s %12s", "", "update ms");
+	log(r, "%-12s %12.3f", "recursive", recursive);
+	log(r, "%-12s %12.3f  (x%.1f)", "linear", linear, recursive / linear);
+
+	// Reparenting every instance to the last one breaks the order, the next update sorts the slots
+	int last = handles[1 + (n_instances - 1) * n_joints];
+	for (int k = 0; k < n_instances - 1; ++k)
+		flat.set_parent(handles[1 + k * n_joints], last);
+	tm.reset();
+	flat.update_world();
+	double sorted = tm.elapsed_ms();
+	flat.set_dirty(handles[0]);
+	tm.reset();
+	flat.update_world();
+	log(r, "%-12s %12.3f  (%.3f ms once sorted)", "reparented", sorted, tm.elapsed_ms());
+
+	// The reparented instances are offset by the world transform of the last root
+	const transform last_world = transform().concatenate(tree[0]->m_local).concatenate(tree[1 + (n_instances - 1) * n_joints]->m_local);
+	glm::vec3 expected = last_world.concatenate(tree[0]->m_world.inv_concatenate(tree[n_joints]->m_world)).get_position();
+	if (flat.get_parent(handles[1]) != last || glm::length(flat.position(handles[n_joints], transform_hierarchy::world) - expected) > 1e-3f)
+		log(r, "  FAILED: the reparented instances are wrong");
+
+	for (tree_node* n : tree)
+		delete n;
+}
+
+// Counts the nodes of the subtree whose world transform was recomputed by the last update
+static void count_changed_rec(const node* n, int& changed, int& total)
+{
+	total++;
+	if (n->m_world.changed())
+		changed++;
+	for (const node* child : n->m_children)
+		count_changed_rec(child, changed, total);
+}
+
+void benchmark::dirty_transforms(report& r)
+{
+	const int n_frames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	// Updates the world transforms of the scene for some frames and logs how many
+	// nodes of the instances changed
+	auto run = [&](const char* name, const std::vector<node*>& instances, bool animated, bool moving) {
+		int first = 0, total = 0;
+		for (node* inst : instances)
+			g_transforms.set_dirty(inst->m_local.get_handle());
+		g_transforms.update_world();
+		for (node* inst : instances)
+			count_changed_rec(inst, first, total);
+
+		int changed = 0;
+		double dirty_time = 0.0;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			if (animated)
+				g_animation_system.update(dt);
+			timer tm;
+			g_transforms.update_world();
+			dirty_time += tm.elapsed_ms();
+			int n = 0;
+			for (node* inst : instances)
+				count_changed_rec(inst, changed, n);
+		}
+
+		// Every node of the scene recomputed, as before the dirty tracking
+		double full_time = 0.0;
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_transforms.set_dirty(g_scene.get_root()->m_local.get_handle());
+			timer tm;
+			g_transforms.update_world();
+			full_time += tm.elapsed_ms();
+		}
+
+		log(r, "%-16s %8d %12d %12.1f %12.3f %12.3f", name, total, first, (double)changed / n_frames,
+			dirty_time / n_frames, full_time / n_frames);
+		if (first != total || (!moving && changed != 0) || (moving && changed == 0))
+			log(r, "  FAILED: wrong nodes recomputed");
+	};
+
+	log(r, "World transforms recomputed per frame over %d frames", n_frames);
+	log(r, "%-16s %8s %12s %12s %12s %12s", "", "nodes", "first frame", "per frame", "update ms", "full ms");
+
+	// Static scene, nothing changes after the first frame
+	std::string sponza = "data/assets/sponza/Sponza.gltf";
+	import_gltf_file(sponza.c_str());
+	if (g_resources.model_registered(sponza.c_str()))
+	{
+		std::vector<node*> instances = create_crowd({ g_resources.get_model_id(sponza) }, 1);
+		run("static sponza", instances, false, false);
+		destroy_crowd(instances);
+	}
+	else
+		log(r, "%s not available", sponza.c_str());
+
+	// Animated crowd, only the joints written by the animations change
+	std::string bot = "data/assets/MIXAMO/xbot.gltf";
+	import_gltf_file(bot.c_str());
+	if (g_resources.model_registered(bot.c_str()))
+	{
+		bool prev_enabled = g_animation_system.lod_enabled();
+		g_animation_system.set_lod_enabled(false);
+		std::vector<node*> instances = create_crowd({ g_resources.get_model_id(bot) }, 100);
+		run("animated crowd", instances, true, true);
+
+		// Paused players write the pose they already have, which does not dirty the joints
+		for (node* inst : instances)
+			g_animation_system.get_player(inst->get_component<anim_comp>()->get_player()).m_play = false;
+		run("paused crowd", instances, true, false);
+		destroy_crowd(instances);
+		g_animation_system.set_lod_enabled(prev_enabled);
+	}
+	else
+		log(r, "%s not available", bot.c_str());
+}
+
+// Component lookup as it was before the pools
+template <typename T>
+static T* find_component_rtti(node* n)
+{
+	for (component* c : n->m_comps)
+		if (T* comp = dynamic_cast<T*>(c))
+			return comp;
+	return nullptr;
+}
+
+// Update and render traversal as it was before the pools: every node is visited,
+// every component gets a virtual update and the meshes are found with dynamic_cast
+static void traverse_tree_rec(node* n, float& sink)
+{
+	for (component* c : n->m_comps)
+		c->update();
+	if (find_component_rtti<mesh_comp>(n))
+		sink += n->m_world.compute_matrix()[3][0];
+	for (node* child : n->m_children)
+		traverse_tree_rec(child, sink);
+}
+
+void benchmark::component_traversal(report& r)
+{
+	const int n_frames = 100;
+
+	// Runs the old and new traversals over the nodes of the scene, with the instances in it
+	auto run = [&](const char* name, const std::vector<node*>& instances) {
+		node* root = g_scene.get_root();
+		int n_nodes = 0, n_comps = 0;
+		std::vector<node*> stack(1, root);
+		while (!stack.empty())
+		{
+			node* n = stack.back();
+			stack.pop_back();
+			n_nodes++;
+			n_comps += (int)n->m_comps.size();
+			stack.insert(stack.end(), n->m_children.begin(), n->m_children.end());
+		}
+
+		volatile float sink = 0.0f;
+		float s = 0.0f;
+		timer tm;
+		for (int f = 0; f < n_frames; ++f)
+			traverse_tree_rec(root, s);
+		double tree = tm.elapsed_ms() / n_frames;
+
+		tm.reset();
+		for (int f = 0; f < n_frames; ++f)
+		{
+			g_component_pools.update_all();
+			component_pool<mesh_comp>::get_instance().for_each([&](mesh_comp& m) {
+				s += m.get_owner()->m_world.compute_matrix()[3][0];
+			});
+		}
+		double pools = tm.elapsed_ms() / n_frames;
+
+		// Lookups of the animation component of every instance
+		int found = 0;
+		tm.reset();
+		for (int f = 0; f < n_frames; ++f)
+			for (node* inst : instances)
+				found += find_component_rtti<anim_comp>(inst) ? 1 : 0;
+		double rtti = tm.elapsed_ms() * 1000.0 / n_frames;
+
+		tm.reset();
+		for (int f = 0; f < n_frames; ++f)
+			for (node* inst : instances)
+				found -= inst->get_component<anim_comp>() ? 1 : 0;
+		double typed = tm.elapsed_ms() * 1000.0 / n_frames;
+		sink = sink + s;
+
+		// The pools skip the components of nodes out of the scene
+		auto count_meshes = [] {
+			int count = 0;
+			component_pool<mesh_comp>::get_instance().for_each([&](mesh_comp&) { ++count; });
+			return count;
+		};
+		int n_meshes = 0;
+		for (node* inst : instances)
+			for (node* n : g_scene.get_instance_nodes(inst->m_instance))
+				n_meshes += n && n->get_component<mesh_comp>() ? 1 : 0;
+		int attached = count_meshes();
+		for (node* inst : instances)
+			inst->set_in_scene(false);
+		int detached = count_meshes();
+		for (node* inst : instances)
+			inst->set_in_scene(true);
+
+		log(r, "%-16s %8d %8d %10.3f %10.3f %12.2f %12.2f", name, n_nodes, n_comps, tree, pools, rtti, typed);
+		if (found != 0)
+			log(r, "  FAILED: the lookups do not agree");
+		if (attached - detached != n_meshes)
+			log(r, "  FAILED: %d meshes out of the scene visited by the pool", n_meshes - (attached - detached));
+	};
+
+	log(r, "Component updates and mesh traversal of the scene per frame, and anim_comp lookups of every instance");
+	log(r, "%-16s %8s %8s %10s %10s %12s %12s", "", "nodes", "comps", "tree ms", "pools ms", "rtti us", "typed us");
+
+	// Static scene
+	std::string sponza = "data/assets/sponza/Sponza.gltf";
+	import_gltf_file(sponza.c_str());
+	if (g_resources.model_registered(sponza.c_str()))
+	{
+		std::vector<node*> instances = create_crowd({ g_resources.get_model_id(sponza) }, 1);
+		run("sponza", instances);
+		destroy_crowd(instances);
+	}
+	else
+		log(r, "%s not available", sponza.c_str());
+
+	// Crowd with an animation component per instance and the meshes of the model
+	std::string bot = "data/assets/MIXAMO/xbot.gltf";
+	import_gltf_file(bot.c_str());
+	if (g_resources.model_registered(bot.c_str()))
+	{
+		std::vector<node*> instances = create_crowd({ g_resources.get_model_id(bot) }, 1000);
+		run("crowd of 1000", instances);
+		destroy_crowd(instances);
+	}
+	else
+		log(r, "%s not available", bot.c_str());
+}
+
+void benchmark::node_allocation(report& r)
+{
+	const char* file_name = "data/assets/rigged figure/CesiumMan.gltf";
+	const int n_instances = 1000;
+	if (!g_resources.model_registered(file_name))
+		import_gltf_file(file_name);
+	if (!g_resources.model_registered(file_name))
+	{
+		log(r, "could not load %s", file_name);
+		return;
+	}
+	int model_idx = g_resources.get_model_id(file_name);
+	const model_rsc& model = g_resources.get_model_rsc(model_idx);
+
+	log(r, "%d instances of %s, %d nodes each", n_instances, file_name, (int)model.m_nodes.size());
+	log(r, "%-16s %14s %14s %14s", "", "instance ms", "teardown ms", "compaction ms");
+
+	// Instances of the scene with the nodes from the global heap, then from the
+	// node slab. The last round takes the node, component and registry slots the
+	// round before it freed
+	int scene_instances = g_scene.model_instance_count(model_idx);
+	size_t capacity = 0;
+	int max_index[3] = { 0, 0, 0 };
+	const char* names[] = { "heap", "slab", "slab recycled" };
+	for (int round = 0; round < 3; ++round)
+	{
+		node::set_heap_allocation(round == 0);
+		std::vector<node*> roots(n_instances);
+		timer tm;
+		for (int i = 0; i < n_instances; ++i)
+			roots[i] = g_scene.create_model_instance(model_idx);
+		double create = tm.elapsed_ms();
+		if (round == 1)
+			capacity = node::pool_capacity();
+		for (node* root : roots)
+			max_index[round] = glm::max(max_index[round], root->m_model_inst);
+
+		tm.reset();
+		for (node* root : roots)
+			g_scene.destroy_model_instance(root);
+		double teardown = tm.elapsed_ms();
+		node::set_heap_allocation(false);
+
+		// The transform slots of the nodes are removed by the next update
+		tm.reset();
+		g_transforms.update_world();
+		log(r, "%-16s %14.3f %14.3f %14.3f", names[round], create, teardown, tm.elapsed_ms());
+	}
+
+	if (node::pool_capacity() != capacity)
+		log(r, "  FAILED: the slots of the freed nodes were not reused");
+	if (max_index[1] > max_index[0] || max_index[2] > max_index[1] || g_scene.model_instance_count(model_idx) != scene_instances)
+		log(r, "  FAILED: the registry did not reuse the instance indices");
+	log(r, "node slab: %d slots in use, %d allocated", (int)node::pool_size(), (int)node::pool_capacity());
+	log(r, "largest instance index: %d, %d and %d, %d instances of the model left in the scene", max_index[0], max_index[1], max_index[2], g_scene.model_instance_count(model_idx));
+}
+}
\ No newline at end of file
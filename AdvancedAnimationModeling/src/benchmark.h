@@ -0,0 +1,116 @@
+/**
+* @file benchmark.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+
+namespace cs460 {
+// Measures elapsed time in milliseconds
+class timer
+{
+public:
+	timer() { reset(); }
+	void reset() { m_start = std::chrono::high_resolution_clock::now(); }
+	double elapsed_ms() const {
+		auto now = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(now - m_start).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point m_start;
+};
+
+class benchmark
+{
+public:
+	static benchmark& get_instance();
+
+	// Benchmarks gui window
+	void imgui();
+
+private:
+	benchmark();
+
+	struct report
+	{
+		report(const char* name, void (benchmark::*run)(report& r)) : m_name(name), m_run(run) {}
+
+		const char* m_name;
+		void (benchmark::*m_run)(report& r);
+		std::vector<std::string> m_lines;
+	};
+
+	// Adds a line to the given report
+	void log(report& r, const char* format, ...);
+
+	// Keyframe sampling cost for growing clip lengths
+	void keyframe_sampling(report& r);
+
+	// Baked clip accuracy and throughput against per channel sampling
+	void baked_sampling(report& r);
+
+	// Compression ratio, error and decode speed of quantized clips
+	void clip_compression(report& r);
+
+	// Node lookups through nested hash maps, the dense scene registry and per instance binding tables
+	void binding_tables(report& r);
+
+	// Per node animation updates against the batched animation system
+	void animation_batching(report& r);
+
+	// Crowd update time for 1 to 16 threads, with parallel_for and with a task graph
+	void job_scaling(report& r);
+
+	// Crowd update time, sample counts and pose error with and without animation LOD
+	void animation_lod(report& r);
+
+	// Crowd update time and hit rate with and without the shared pose cache
+	void pose_caching(report& r);
+
+	// 2D blend tree evaluation with hash map poses against dense poses
+	void blend_tree_poses(report& r);
+
+	// Accuracy and throughput of the pose lerp and barycentric kernels
+	void pose_blending(report& r);
+
+	// Clip samples skipped and pose error of the blend tree for several prune weights
+	void blend_pruning(report& r);
+
+	// Blend trees evaluated by the compiled program against the recursive nodes
+	void blend_program_eval(report& r);
+
+	// Clip samples shared by the leaves of a tree and by several trees through the pose cache
+	void blend_clip_sharing(report& r);
+
+	// Blend space point location by scanning the triangles, walking, the grid and the baked table
+	void blend_space_location(report& r);
+
+	// Incremental blend space triangulation against delaunator, results and edit times
+	void blend_space_editing(report& r);
+
+	// Masked layer sampling against full skeleton sampling, results and sampling times
+	void bone_mask_layers(report& r);
+
+	// Transitions between two clips, crossfade against inertialization
+	void transition_cost(report& r);
+
+	// World transform propagation over the flat transform hierarchy against the recursive nodes
+	void transform_propagation(report& r);
+
+	// World transforms recomputed per frame with dirty tracking, static scene and animated crowd
+	void dirty_transforms(report& r);
+
+	// Component updates and render traversal through the typed pools against the node tree
+	void component_traversal(report& r);
+
+	// Instantiation and teardown of model instances with heap nodes against the node slab
+	void node_allocation(report& r);
+
+	std::vector<report> m_reports;
+};
+
+#define g_benchmark benchmark::get_instance()
+}
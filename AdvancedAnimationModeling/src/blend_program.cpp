@@ -0,0 +1,328 @@
+/**
+* @file blend_program.cpp
+* @date 2026/10/17
+*/
+#include "blend_program.h"
+#include "blending.h"
+#include <algorithm>
+
+namespace cs460 {
+void blend_program::clear()
+{
+	m_ops.clear();
+	m_children.clear();
+	m_positions.clear();
+	m_triangles.clear();
+	m_states.clear();
+	m_clip_poses.clear();
+	m_n_slots = 0;
+}
+
+void blend_program::compile(blend_node* root, unsigned n_joints)
+{
+	clear();
+	if (!root || !root->enough_blend_nodes())
+	{
+		m_slots.clear();
+		return;
+	}
+
+	// Children first, the root last
+	std::vector<int> free_slots;
+	int root_op = compile_rec(root, free_slots);
+
+	// Output, the pose of the root
+	op out;
+	out.m_type = output_op;
+	out.m_slot = m_ops[root_op].m_slot;
+	out.m_first_child = (int)m_children.size();
+	out.m_n_children = 1;
+	m_children.push_back(root_op);
+	m_positions.push_back(root->m_blend_pos);
+	m_ops.push_back(out);
+
+	// Poses are sized once, evaluating the program does not allocate
+	m_slots.resize(m_n_slots);
+	for (auto& slot : m_slots)
+	{
+		if (slot.size() != n_joints)
+			slot.resize(n_joints);
+	}
+	m_states.assign(m_ops.size(), op_state());
+}
+
+int blend_program::new_slot(std::vector<int>& free_slots)
+{
+	if (free_slots.empty())
+		return m_n_slots++;
+
+	int slot = free_slots.back();
+	free_slots.pop_back();
+	return slot;
+}
+
+int blend_program::compile_rec(blend_node* node, std::vector<int>& free_slots)
+{
+	op o;
+
+	// Leaf, sample the clip
+	if (node->m_children.empty())
+	{
+		o.m_type = sample_op;
+		o.m_model = node->m_model;
+		o.m_anim = node->m_anim;
+		o.m_context = &node->m_context;
+
+		// Leaves of the same clip share a slot that is never reused
+		for (const op& other : m_ops)
+		{
+			if (other.m_type == sample_op && other.m_model == o.m_model && other.m_anim == o.m_anim)
+			{
+				o.m_clip = other.m_clip;
+				o.m_slot = other.m_slot;
+				break;
+			}
+		}
+		if (o.m_clip < 0)
+		{
+			o.m_clip = (int)m_clip_poses.size();
+			o.m_slot = m_n_slots++;
+			m_clip_poses.push_back(nullptr);
+		}
+
+		m_ops.push_back(o);
+		return (int)m_ops.size() - 1;
+	}
+
+	// The poses of the children stay alive until this op has blended them
+	std::vector<int> children;
+	for (blend_node* child : node->m_children)
+		children.push_back(compile_rec(child, free_slots));
+
+	o.m_first_child = (int)m_children.size();
+	o.m_n_children = (int)children.size();
+	for (size_t i = 0; i < children.size(); ++i)
+	{
+		m_children.push_back(children[i]);
+		m_positions.push_back(node->m_children[i]->m_blend_pos);
+	}
+
+	// Incomplete nodes select no children, their pose is cleared
+	if (blend_node_2d* node_2d = dynamic_cast<blend_node_2d*>(node))
+	{
+		o.m_type = barycentric_op;
+		o.m_first_triangle = (int)m_triangles.size();
+		if (node_2d->enough_blend_nodes())
+		{
+			for (const auto& t : node_2d->get_triangles())
+				m_triangles.push_back({ (int)t[0], (int)t[1], (int)t[2] });
+		}
+		o.m_n_triangles = (int)m_triangles.size() - o.m_first_triangle;
+		o.m_locator = &node_2d->get_locator();
+	}
+	else
+	{
+		o.m_type = lerp_op;
+		if (!node->enough_blend_nodes())
+			o.m_n_children = 0;
+	}
+	node->get_min_max_blend_param(o.m_min, o.m_max);
+
+	o.m_slot = new_slot(free_slots);
+	for (int child : children)
+	{
+		if (m_ops[child].m_type != sample_op)
+			free_slots.push_back(m_ops[child].m_slot);
+	}
+
+	m_ops.push_back(o);
+	return (int)m_ops.size() - 1;
+}
+
+int blend_program::select_children(const op& o, op_state& s, int* children, float* weights) const
+{
+	glm::vec2& param = s.m_param;
+	if (o.m_n_children == 0)
+		return 0;
+	const glm::vec2* positions = &m_positions[o.m_first_child];
+
+	if (o.m_type == lerp_op)
+	{
+		param.x = glm::clamp(param.x, o.m_min.x, o.m_max.x);
+
+		// Binary search of the segment, same as blend_node_1d::find_segment
+		int left = 0;
+		int right = o.m_n_children - 1;
+		while (left != right - 1)
+		{
+			int mid = left + (right - left) / 2;
+			float mid_param = positions[mid].x;
+			if (param.x == mid_param)
+			{
+				left = right = mid;
+				break;
+			}
+			if (param.x < mid_param)
+				right = mid;
+			else
+				left = mid;
+		}
+
+		float local_diff = param.x - positions[left].x;
+		float total_diff = positions[right].x - positions[left].x;
+		float norm_param = (total_diff != 0) ? local_diff / total_diff : 0.0f;
+
+		children[0] = m_children[o.m_first_child + left];
+		children[1] = m_children[o.m_first_child + right];
+		weights[0] = 1.0f - norm_param;
+		weights[1] = norm_param;
+		return 2;
+	}
+
+	// Barycentric, walk from the triangle of the last run
+	param = glm::clamp(param, o.m_min, o.m_max);
+	if (o.m_n_triangles == 0)
+		return 0;
+	s.m_triangle = o.m_locator->locate(param, s.m_triangle, weights);
+	if (s.m_triangle < 0)
+		return 0;
+
+	const auto& t = m_triangles[o.m_first_triangle + s.m_triangle];
+	for (int k = 0; k < 3; ++k)
+		children[k] = m_children[o.m_first_child + t[k]];
+	return 3;
+}
+
+const dense_pose* blend_program::run(glm::vec2& blend_param, float time, blend_eval& eval)
+{
+	if (m_ops.empty())
+		return nullptr;
+
+	int n_ops = (int)m_ops.size();
+	for (auto& s : m_states)
+	{
+		s.m_reached = false;
+		s.m_active = false;
+		s.m_n_used = 0;
+	}
+	std::fill(m_clip_poses.begin(), m_clip_poses.end(), nullptr);
+
+	// Top-down, the output goes first
+	op_state& out = m_states[n_ops - 1];
+	out.m_param = blend_param;
+	out.m_reached = true;
+	out.m_active = true;
+	for (int i = n_ops - 1; i >= 0; --i)
+	{
+		const op& o = m_ops[i];
+		op_state& s = m_states[i];
+		if (!s.m_reached || o.m_type == sample_op)
+			continue;
+
+		if (o.m_type == output_op)
+		{
+			op_state& root = m_states[m_children[o.m_first_child]];
+			root.m_param = s.m_param;
+			root.m_target = o.m_slot;
+			root.m_reached = true;
+			root.m_active = true;
+			continue;
+		}
+
+		int children[3];
+		float weights[3];
+		int n_children = select_children(o, s, children, weights);
+
+		// Children that barely contribute are not evaluated, the rest are renormalized
+		float total = 0.0f;
+		for (int c = 0; c < n_children; ++c)
+		{
+			op_state& child = m_states[children[c]];
+			child.m_param = s.m_param;
+			child.m_reached = true;
+			if (!s.m_active || weights[c] <= eval.m_epsilon)
+				continue;
+
+			child.m_active = true;
+			s.m_used[s.m_n_used] = children[c];
+			s.m_weights[s.m_n_used] = weights[c];
+			total += weights[c];
+			++s.m_n_used;
+		}
+		for (int c = 0; c < s.m_n_used; ++c)
+			s.m_weights[c] /= total;
+
+		// A single child writes the pose of this op
+		for (int c = 0; c < s.m_n_used; ++c)
+			m_states[s.m_used[c]].m_target = s.m_n_used == 1 ? s.m_target : m_ops[s.m_used[c]].m_slot;
+	}
+
+	// Bottom-up, sample and blend what is used
+	for (int i = 0; i < n_ops; ++i)
+	{
+		const op& o = m_ops[i];
+		op_state& s = m_states[i];
+		if (o.m_type == sample_op)
+		{
+			if (!s.m_active)
+			{
+				if (s.m_reached)
+					++eval.m_saved;
+				continue;
+			}
+
+			// Sampled by another leaf, or by another tree through the pose cache
+			const dense_pose*& clip_pose = m_clip_poses[o.m_clip];
+			if (clip_pose)
+				++eval.m_shared;
+			else
+			{
+				clip_pose = produce_pos_shared(o.m_model, o.m_anim, m_slots[o.m_slot], time, *o.m_context);
+				++eval.m_samples;
+			}
+			s.m_pose = clip_pose;
+			continue;
+		}
+
+		if (!s.m_active)
+			continue;
+
+		// Forwarded from the child
+		if (o.m_type == output_op || s.m_n_used == 1)
+		{
+			s.m_pose = m_states[o.m_type == output_op ? m_children[o.m_first_child] : s.m_used[0]].m_pose;
+			continue;
+		}
+
+		dense_pose& target = m_slots[s.m_target];
+		s.m_pose = &target;
+		if (s.m_n_used == 0)
+		{
+			target.clear();
+			continue;
+		}
+
+		// Blend straight into the target unless a child pose lives there
+		dense_pose* dst = &target;
+		const dense_pose* poses[3];
+		for (int c = 0; c < s.m_n_used; ++c)
+		{
+			poses[c] = m_states[s.m_used[c]].m_pose;
+			if (poses[c] == dst)
+				dst = &m_slots[o.m_slot];
+		}
+
+		if (s.m_n_used == 2)
+			lerp_poses(*poses[0], *poses[1], s.m_weights[1], *dst);
+		else
+			blend_poses(poses, s.m_weights, s.m_n_used, *dst);
+
+		if (dst != &target)
+			target = *dst;
+	}
+
+	// The parameter clamped by the root, as the recursive evaluation leaves it
+	blend_param = m_states[m_children[m_ops[n_ops - 1].m_first_child]].m_param;
+	return m_states[n_ops - 1].m_pose;
+}
+}
@@ -0,0 +1,90 @@
+/**
+* @file blend_program.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <array>
+#include <glm/glm.hpp>
+#include "pose.h"
+#include "resources.h"
+#include "blend_space.h"
+
+namespace cs460 {
+struct blend_node;
+struct blend_eval;
+
+// Blend tree flattened into a list of ops where children go before their
+// parents. Every op writes a pose slot chosen when the tree is compiled, and
+// slots are reused once their pose has been consumed. Running the program
+// walks the list twice: top-down to select the children and their weights,
+// and bottom-up to sample and blend the ones that are used. Leaves that play
+// the same clip share one slot, the clip is sampled once per run
+class blend_program
+{
+public:
+	// Rebuilds the program for the tree under root (null empties it)
+	void compile(blend_node* root, unsigned n_joints);
+	void clear();
+	bool empty() const { return m_ops.empty(); }
+
+	// Evaluates the tree, the pose is valid until the next run
+	const dense_pose* run(glm::vec2& blend_param, float time, blend_eval& eval);
+
+	int op_count() const { return (int)m_ops.size(); }
+	int slot_count() const { return m_n_slots; }
+
+private:
+	enum op_type { sample_op, lerp_op, barycentric_op, output_op };
+
+	struct op
+	{
+		op_type m_type = sample_op;
+		int m_slot = -1;			// Pose slot written by the op
+		int m_first_child = 0;		// Children ops, in m_children
+		int m_n_children = 0;
+		int m_first_triangle = 0;	// Triangles of a barycentric op, in m_triangles
+		int m_n_triangles = 0;
+		const triangle_locator* m_locator = nullptr;	// Owned by the 2D node
+		glm::vec2 m_min = glm::vec2(0.0f);	// Range of the blend parameter
+		glm::vec2 m_max = glm::vec2(0.0f);
+
+		// Clip of a sample op
+		int m_model = 0;
+		int m_anim = 0;
+		int m_clip = -1;			// Distinct clip, in m_clip_poses
+		sampling_context* m_context = nullptr;
+	};
+
+	// Selection of the current run
+	struct op_state
+	{
+		glm::vec2 m_param;			// Blend parameter clamped by the op and its parents
+		int m_target = -1;			// Slot where the parent wants the pose
+		const dense_pose* m_pose = nullptr;	// Pose of the op once evaluated
+		bool m_reached = false;		// Selected by a full evaluation
+		bool m_active = false;		// Evaluated (not skipped because of its weight)
+		int m_n_used = 0;			// Children evaluated, with their weights
+		int m_used[3];
+		float m_weights[3];
+		int m_triangle = -1;		// Triangle of the last run, where the next one starts looking
+	};
+
+	int compile_rec(blend_node* node, std::vector<int>& free_slots);
+	int new_slot(std::vector<int>& free_slots);
+
+	// Children selected by a lerp or barycentric op and their weights, returns the count
+	int select_children(const op& o, op_state& s, int* children, float* weights) const;
+
+	std::vector<op> m_ops;
+	std::vector<int> m_children;
+	std::vector<glm::vec2> m_positions;	// Blend position of each entry of m_children
+	std::vector<std::array<int, 3>> m_triangles;
+	std::vector<dense_pose> m_slots;
+	int m_n_slots = 0;
+
+	// Pose of each distinct clip in the current run (null until it is sampled)
+	std::vector<const dense_pose*> m_clip_poses;
+	std::vector<op_state> m_states;
+};
+}
@@ -0,0 +1,710 @@
+/**
+* @file blend_space.cpp
+* @date 2026/10/17
+*/
+#include "blend_space.h"
+#include <unordered_map>
+#include <algorithm>
+
+namespace cs460 {
+// Cross product for the z-axis
+static float locator_cross(const glm::vec2& v0, const glm::vec2& v1)
+{
+	return (v0.x * v1.y - v0.y * v1.x);
+}
+
+void triangle_locator::clear()
+{
+	m_points.clear();
+	m_triangles.clear();
+	m_areas.clear();
+	m_centers.clear();
+	m_neighbors.clear();
+	m_cell_start.clear();
+	m_cell_triangles.clear();
+	m_grid_size = 0;
+	m_baked.clear();
+}
+
+void triangle_locator::build(const std::vector<glm::vec2>& points, const std::vector<std::array<unsigned int, 3>>& triangles,
+	const glm::vec2& min, const glm::vec2& max)
+{
+	clear();
+	m_points = points;
+	m_triangles = triangles;
+	m_min = min;
+	m_max = max;
+
+	int n_triangles = (int)m_triangles.size();
+	m_areas.resize(n_triangles);
+	m_centers.resize(n_triangles);
+	for (int t = 0; t < n_triangles; ++t)
+	{
+		const auto& tri = m_triangles[t];
+		const glm::vec2& p0 = m_points[tri[0]];
+		m_areas[t] = glm::abs(locator_cross(m_points[tri[2]] - p0, m_points[tri[1]] - p0));
+		m_centers[t] = (p0 + m_points[tri[1]] + m_points[tri[2]]) / 3.0f;
+	}
+
+	// Triangles that share an edge, keyed by the vertices of the edge
+	std::unordered_map<uint64_t, int> edges;
+	auto edge_key = [](unsigned a, unsigned b) {
+		return ((uint64_t)glm::min(a, b) << 32) | glm::max(a, b);
+	};
+	m_neighbors.assign(n_triangles, { -1, -1, -1 });
+	for (int t = 0; t < n_triangles; ++t)
+	{
+		for (int v = 0; v < 3; ++v)
+		{
+			uint64_t key = edge_key(m_triangles[t][(v + 1) % 3], m_triangles[t][(v + 2) % 3]);
+			auto it = edges.find(key);
+			if (it == edges.end())
+			{
+				edges[key] = t * 3 + v;
+				continue;
+			}
+
+			int other = it->second / 3;
+			m_neighbors[t][v] = other;
+			m_neighbors[other][it->second % 3] = t;
+		}
+	}
+
+	// Grid with about one triangle per cell
+	if (n_triangles == 0)
+		return;
+	m_grid_size = glm::max(1, (int)glm::ceil(glm::sqrt((float)n_triangles)));
+	m_cell_size = glm::max((m_max - m_min) / (float)m_grid_size, glm::vec2(1e-6f));
+
+	// Count the triangles of each cell, then fill them
+	int n_cells = m_grid_size * m_grid_size;
+	std::vector<int> counts(n_cells + 1, 0);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1)
+		{
+			m_cell_start.assign(n_cells + 1, 0);
+			for (int c = 0; c < n_cells; ++c)
+				m_cell_start[c + 1] = m_cell_start[c] + counts[c];
+			m_cell_triangles.resize(m_cell_start[n_cells]);
+			std::fill(counts.begin(), counts.end(), 0);
+		}
+
+		for (int t = 0; t < n_triangles; ++t)
+		{
+			const auto& tri = m_triangles[t];
+			glm::vec2 lo = glm::min(m_points[tri[0]], glm::min(m_points[tri[1]], m_points[tri[2]]));
+			glm::vec2 hi = glm::max(m_points[tri[0]], glm::max(m_points[tri[1]], m_points[tri[2]]));
+			glm::ivec2 c0 = glm::clamp(glm::ivec2(glm::floor((lo - m_min) / m_cell_size)), 0, m_grid_size - 1);
+			glm::ivec2 c1 = glm::clamp(glm::ivec2(glm::floor((hi - m_min) / m_cell_size)), 0, m_grid_size - 1);
+			for (int y = c0.y; y <= c1.y; ++y)
+			{
+				for (int x = c0.x; x <= c1.x; ++x)
+				{
+					int c = y * m_grid_size + x;
+					if (pass == 1)
+						m_cell_triangles[m_cell_start[c] + counts[c]] = t;
+					++counts[c];
+				}
+			}
+		}
+	}
+
+	bake(m_resolution);
+}
+
+bool triangle_locator::barycentric(int triangle, const glm::vec2& p, float* weights) const
+{
+	const auto& tri = m_triangles[triangle];
+	const glm::vec2 pp0 = m_points[tri[0]] - p;
+	const glm::vec2 pp1 = m_points[tri[1]] - p;
+	const glm::vec2 pp2 = m_points[tri[2]] - p;
+	float area = m_areas[triangle];
+
+	weights[0] = locator_cross(pp2, pp1) / area;
+	weights[1] = locator_cross(pp0, pp2) / area;
+	weights[2] = locator_cross(pp1, pp0) / area;
+
+	return (weights[0] >= 0.0f && weights[1] >= 0.0f && weights[2] >= 0.0f);
+}
+
+int triangle_locator::walk(const glm::vec2& p, int start, float* weights) const
+{
+	// A walk on a Delaunay triangulation does not cycle, the limit is for degenerate input
+	int n_steps = (int)m_triangles.size();
+	int t = start;
+	for (int step = 0; step < n_steps; ++step)
+	{
+		if (barycentric(t, p, weights))
+			return t;
+
+		// Cross the edge of the most negative coordinate, p is behind it
+		int v = 0;
+		if (weights[1] < weights[v]) v = 1;
+		if (weights[2] < weights[v]) v = 2;
+
+		// Behind a hull edge, the hull is convex so p is outside
+		t = m_neighbors[t][v];
+		if (t < 0)
+			return -1;
+	}
+	return -2;
+}
+
+int triangle_locator::grid_locate(const glm::vec2& p, float* weights) const
+{
+	if (m_grid_size == 0)
+		return -1;
+
+	glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor((p - m_min) / m_cell_size)), 0, m_grid_size - 1);
+	int c = cell.y * m_grid_size + cell.x;
+	for (int i = m_cell_start[c]; i < m_cell_start[c + 1]; ++i)
+	{
+		if (barycentric(m_cell_triangles[i], p, weights))
+			return m_cell_triangles[i];
+	}
+	return -1;
+}
+
+int triangle_locator::locate(const glm::vec2& p, int hint, float* weights) const
+{
+	int n_triangles = (int)m_triangles.size();
+	if (n_triangles == 0)
+		return -1;
+
+	// Lattice cell of p
+	if (m_resolution > 0)
+	{
+		glm::vec2 f = (p - m_min) / (m_max - m_min) * (float)m_resolution;
+		glm::ivec2 cell = glm::clamp(glm::ivec2(glm::floor(f)), 0, m_resolution - 1);
+		glm::vec2 s = glm::clamp(f - glm::vec2(cell), 0.0f, 1.0f);
+
+		int row = m_resolution + 1;
+		const baked_point& b00 = m_baked[cell.y * row + cell.x];
+		const baked_point& b10 = m_baked[cell.y * row + cell.x + 1];
+		const baked_point& b01 = m_baked[(cell.y + 1) * row + cell.x];
+		const baked_point& b11 = m_baked[(cell.y + 1) * row + cell.x + 1];
+
+		// Whole cell inside one triangle
+		int t = b00.m_triangle;
+		if (t >= 0 && b10.m_triangle == t && b01.m_triangle == t && b11.m_triangle == t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				float w0 = b00.m_weights[k] + (b10.m_weights[k] - b00.m_weights[k]) * s.x;
+				float w1 = b01.m_weights[k] + (b11.m_weights[k] - b01.m_weights[k]) * s.x;
+				weights[k] = w0 + (w1 - w0) * s.y;
+			}
+			return t;
+		}
+
+		// Walk from a corner of the cell
+		const baked_point* corners[] = { &b00, &b10, &b01, &b11 };
+		for (const baked_point* b : corners)
+		{
+			if (b->m_triangle >= 0)
+			{
+				hint = b->m_triangle;
+				break;
+			}
+		}
+	}
+
+	// Walk if the hint is a couple of grid cells away at most
+	if (hint >= 0 && hint < n_triangles)
+	{
+		glm::vec2 d = glm::abs(p - m_centers[hint]) / m_cell_size;
+		if (d.x <= 2.0f && d.y <= 2.0f)
+		{
+			int t = walk(p, hint, weights);
+			if (t != -2)
+				return t;
+		}
+	}
+	return grid_locate(p, weights);
+}
+
+void triangle_locator::bake(int resolution)
+{
+	m_resolution = 0;
+	m_baked.clear();
+	if (resolution <= 0 || m_triangles.empty())
+	{
+		m_resolution = glm::max(resolution, 0);
+		return;
+	}
+
+	// Lattice points row by row, each walk starts at the triangle of the previous point
+	int row = resolution + 1;
+	m_baked.resize(row * row);
+	glm::vec2 step = (m_max - m_min) / (float)resolution;
+	int hint = -1;
+	for (int y = 0; y < row; ++y)
+	{
+		for (int x = 0; x < row; ++x)
+		{
+			baked_point& b = m_baked[y * row + x];
+			glm::vec2 p = m_min + step * glm::vec2((float)x, (float)y);
+			b.m_triangle = locate(p, hint, b.m_weights);
+			if (b.m_triangle >= 0)
+				hint = b.m_triangle;
+		}
+	}
+	m_resolution = resolution;
+}
+
+// Twice the signed area of a, b, c (positive if counter-clockwise)
+static double delaunay_orient(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+{
+	return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+}
+
+static uint64_t delaunay_edge(int a, int b)
+{
+	return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+void delaunay_triangulation::clear()
+{
+	m_points.clear();
+	m_ids.clear();
+	m_free_vertices.clear();
+	m_triangles.clear();
+	m_free_triangles.clear();
+	m_edges.clear();
+	m_vertex_triangle.clear();
+	m_stamp.clear();
+	m_last = -1;
+	m_n_real = 0;
+	m_n_isolated = 0;
+}
+
+int delaunay_triangulation::new_vertex(const glm::vec2& p)
+{
+	if (m_free_vertices.empty())
+	{
+		m_points.push_back(p);
+		m_vertex_triangle.push_back(-1);
+		return (int)m_points.size() - 1;
+	}
+
+	int v = m_free_vertices.back();
+	m_free_vertices.pop_back();
+	m_points[v] = p;
+	m_vertex_triangle[v] = -1;
+	return v;
+}
+
+int delaunay_triangulation::add_triangle(int a, int b, int c)
+{
+	// The infinite vertex goes last
+	if (a == infinite)
+	{
+		a = b; b = c; c = infinite;
+	}
+	else if (b == infinite)
+	{
+		b = a; a = c; c = infinite;
+	}
+
+	int t;
+	if (m_free_triangles.empty())
+	{
+		t = (int)m_triangles.size();
+		m_triangles.push_back({});
+		m_stamp.push_back(0);
+	}
+	else
+	{
+		t = m_free_triangles.back();
+		m_free_triangles.pop_back();
+	}
+
+	triangle& tri = m_triangles[t];
+	tri.m_v[0] = a;
+	tri.m_v[1] = b;
+	tri.m_v[2] = c;
+	for (int k = 0; k < 3; ++k)
+	{
+		m_edges[delaunay_edge(tri.m_v[k], tri.m_v[(k + 1) % 3])] = t;
+		if (tri.m_v[k] != infinite)
+			m_vertex_triangle[tri.m_v[k]] = t;
+	}
+
+	if (c != infinite)
+	{
+		++m_n_real;
+		m_last = t;
+	}
+	return t;
+}
+
+void delaunay_triangulation::remove_triangle(int t)
+{
+	triangle& tri = m_triangles[t];
+	for (int k = 0; k < 3; ++k)
+		m_edges.erase(delaunay_edge(tri.m_v[k], tri.m_v[(k + 1) % 3]));
+	if (tri.m_v[2] != infinite)
+		--m_n_real;
+
+	tri.m_v[0] = dead;
+	m_free_triangles.push_back(t);
+}
+
+int delaunay_triangulation::edge_owner(int a, int b) const
+{
+	auto it = m_edges.find(delaunay_edge(a, b));
+	return it != m_edges.end() ? it->second : -1;
+}
+
+bool delaunay_triangulation::in_circle(int t, const glm::vec2& p) const
+{
+	const triangle& tri = m_triangles[t];
+	const glm::vec2& a = m_points[tri.m_v[0]];
+	const glm::vec2& b = m_points[tri.m_v[1]];
+
+	// Ghost, the open half plane outside of the hull edge and the edge itself
+	if (tri.m_v[2] == infinite)
+	{
+		double o = delaunay_orient(a, b, p);
+		if (o != 0.0)
+			return o > 0.0;
+		return glm::dot(p - a, b - a) > 0.0f && glm::dot(p - b, a - b) > 0.0f;
+	}
+
+	const glm::vec2& c = m_points[tri.m_v[2]];
+	double adx = (double)a.x - p.x, ady = (double)a.y - p.y;
+	double bdx = (double)b.x - p.x, bdy = (double)b.y - p.y;
+	double cdx = (double)c.x - p.x, cdy = (double)c.y - p.y;
+	double ad = adx * adx + ady * ady;
+	double bd = bdx * bdx + bdy * bdy;
+	double cd = cdx * cdx + cdy * cdy;
+	return adx * (bdy * cd - bd * cdy) - ady * (bdx * cd - bd * cdx) + ad * (bdx * cdy - bdy * cdx) > 0.0;
+}
+
+int delaunay_triangulation::locate(const glm::vec2& p) const
+{
+	int t = m_last;
+	if (t < 0 || m_triangles[t].m_v[0] == dead || m_triangles[t].m_v[2] == infinite)
+		return -1;
+
+	// Walk towards p, leaving the hull lands on the ghost of the edge
+	int n_steps = (int)m_triangles.size();
+	for (int step = 0; step < n_steps; ++step)
+	{
+		const triangle& tri = m_triangles[t];
+		int next = -1;
+		for (int k = 0; k < 3 && next < 0; ++k)
+		{
+			int a = tri.m_v[k], b = tri.m_v[(k + 1) % 3];
+			if (delaunay_orient(m_points[a], m_points[b], p) < 0.0)
+				next = edge_owner(b, a);
+		}
+
+		if (next < 0)
+			return t;
+		if (m_triangles[next].m_v[2] == infinite)
+			return next;
+		t = next;
+	}
+	return -1;
+}
+
+int delaunay_triangulation::insert_vertex(int v)
+{
+	const glm::vec2& p = m_points[v];
+
+	// Triangle whose circle contains p, a duplicate point is in none
+	int seed = locate(p);
+	if (seed < 0 || !in_circle(seed, p))
+	{
+		seed = -1;
+		for (int t = 0; t < (int)m_triangles.size() && seed < 0; ++t)
+		{
+			if (m_triangles[t].m_v[0] != dead && in_circle(t, p))
+				seed = t;
+		}
+		if (seed < 0)
+			return 0;
+	}
+
+	// Cavity, the triangles whose circle contains p
+	int stamp = ++m_stamp_id;
+	std::vector<int> cavity;
+	std::vector<int> stack(1, seed);
+	m_stamp[seed] = stamp;
+	while (!stack.empty())
+	{
+		int t = stack.back();
+		stack.pop_back();
+		cavity.push_back(t);
+		for (int k = 0; k < 3; ++k)
+		{
+			const triangle& tri = m_triangles[t];
+			int n = edge_owner(tri.m_v[(k + 1) % 3], tri.m_v[k]);
+			if (n < 0 || m_stamp[n] == stamp || !in_circle(n, p))
+				continue;
+			m_stamp[n] = stamp;
+			stack.push_back(n);
+		}
+	}
+
+	// Boundary of the cavity, each edge makes a triangle with p
+	std::vector<std::pair<int, int>> boundary;
+	for (int t : cavity)
+	{
+		const triangle& tri = m_triangles[t];
+		for (int k = 0; k < 3; ++k)
+		{
+			int a = tri.m_v[k], b = tri.m_v[(k + 1) % 3];
+			int n = edge_owner(b, a);
+			if (n < 0 || m_stamp[n] != stamp)
+				boundary.push_back({ a, b });
+		}
+	}
+
+	for (int t : cavity)
+		remove_triangle(t);
+
+	bool valid = true;
+	for (const auto& e : boundary)
+	{
+		int t = add_triangle(e.first, e.second, v);
+		const triangle& tri = m_triangles[t];
+		if (tri.m_v[2] != infinite && delaunay_orient(m_points[tri.m_v[0]], m_points[tri.m_v[1]], m_points[tri.m_v[2]]) <= 0.0)
+			valid = false;
+	}
+	return valid ? 1 : -1;
+}
+
+bool delaunay_triangulation::remove_vertex(int v)
+{
+	// Not connected
+	int start = m_vertex_triangle[v];
+	auto has_v = [&](int t) {
+		const triangle& tri = m_triangles[t];
+		return tri.m_v[0] == v || tri.m_v[1] == v || tri.m_v[2] == v;
+	};
+	if (start < 0 || m_triangles[start].m_v[0] == dead || !has_v(start))
+		return true;
+
+	// Star of the vertex
+	int stamp = ++m_stamp_id;
+	std::vector<int> star;
+	std::vector<int> stack(1, start);
+	m_stamp[start] = stamp;
+	while (!stack.empty())
+	{
+		int t = stack.back();
+		stack.pop_back();
+		star.push_back(t);
+		for (int k = 0; k < 3; ++k)
+		{
+			const triangle& tri = m_triangles[t];
+			int n = edge_owner(tri.m_v[(k + 1) % 3], tri.m_v[k]);
+			if (n < 0 || m_stamp[n] == stamp || !has_v(n))
+				continue;
+			m_stamp[n] = stamp;
+			stack.push_back(n);
+		}
+	}
+
+	// Link vertices, the region of the star and the edges around it
+	std::vector<int> link;
+	std::vector<std::array<glm::vec2, 3>> region;
+	std::vector<std::pair<int, int>> edges;
+	for (int t : star)
+	{
+		const triangle& tri = m_triangles[t];
+		if (tri.m_v[2] != infinite)
+			region.push_back({ m_points[tri.m_v[0]], m_points[tri.m_v[1]], m_points[tri.m_v[2]] });
+		for (int k = 0; k < 3; ++k)
+		{
+			int a = tri.m_v[k], b = tri.m_v[(k + 1) % 3];
+			if (a != v && a != infinite && std::find(link.begin(), link.end(), a) == link.end())
+				link.push_back(a);
+			if (a != v && b != v)
+				edges.push_back({ a, b });
+		}
+	}
+	for (int t : star)
+		remove_triangle(t);
+
+	// Delaunay triangles of the link that fill the hole
+	std::vector<glm::vec2> link_points(link.size());
+	for (size_t i = 0; i < link.size(); ++i)
+		link_points[i] = m_points[link[i]];
+	delaunay_triangulation local;
+	local.rebuild(link_points);
+
+	std::vector<int> added;
+	for (const triangle& tri : local.m_triangles)
+	{
+		if (tri.m_v[0] == dead || tri.m_v[2] == infinite)
+			continue;
+
+		glm::vec2 center = (local.m_points[tri.m_v[0]] + local.m_points[tri.m_v[1]] + local.m_points[tri.m_v[2]]) / 3.0f;
+		bool inside = false;
+		for (const auto& r : region)
+		{
+			if (delaunay_orient(r[0], r[1], center) >= 0.0 && delaunay_orient(r[1], r[2], center) >= 0.0 &&
+				delaunay_orient(r[2], r[0], center) >= 0.0)
+			{
+				inside = true;
+				break;
+			}
+		}
+		if (inside)
+			added.push_back(add_triangle(link[tri.m_v[0]], link[tri.m_v[1]], link[tri.m_v[2]]));
+	}
+
+	// Edges left without a neighbor are on the new hull
+	for (int t : added)
+	{
+		for (int k = 0; k < 3; ++k)
+			edges.push_back({ m_triangles[t].m_v[k], m_triangles[t].m_v[(k + 1) % 3] });
+	}
+	for (const auto& e : edges)
+	{
+		for (int side = 0; side < 2; ++side)
+		{
+			int a = side ? e.second : e.first;
+			int b = side ? e.first : e.second;
+			if (a != infinite && b != infinite && edge_owner(a, b) >= 0 && edge_owner(b, a) < 0)
+				add_triangle(b, a, infinite);
+		}
+	}
+
+	// Every edge around the hole has its twin
+	for (const auto& e : edges)
+	{
+		if ((edge_owner(e.first, e.second) < 0) != (edge_owner(e.second, e.first) < 0))
+			return false;
+	}
+	return m_n_real > 0;
+}
+
+void delaunay_triangulation::retriangulate()
+{
+	++m_rebuilds;
+	m_triangles.clear();
+	m_free_triangles.clear();
+	m_edges.clear();
+	m_stamp.clear();
+	m_last = -1;
+	m_n_real = 0;
+	m_n_isolated = 0;
+	for (int v : m_ids)
+		m_vertex_triangle[v] = -1;
+
+	// First triangle, from the first points that are not collinear
+	int n_points = (int)m_ids.size();
+	int a = -1, b = -1, c = -1;
+	if (n_points >= 3)
+	{
+		a = m_ids[0];
+		for (int i = 1; i < n_points && b < 0; ++i)
+		{
+			if (m_points[m_ids[i]] != m_points[a])
+				b = m_ids[i];
+		}
+		for (int i = 1; i < n_points && b >= 0 && c < 0; ++i)
+		{
+			if (delaunay_orient(m_points[a], m_points[b], m_points[m_ids[i]]) != 0.0)
+				c = m_ids[i];
+		}
+	}
+	if (c < 0)
+		return;
+
+	if (delaunay_orient(m_points[a], m_points[b], m_points[c]) < 0.0)
+		std::swap(b, c);
+	add_triangle(a, b, c);
+	add_triangle(b, a, infinite);
+	add_triangle(c, b, infinite);
+	add_triangle(a, c, infinite);
+
+	// Bowyer-Watson for the rest
+	for (int v : m_ids)
+	{
+		if (v == a || v == b || v == c)
+			continue;
+
+		// Left out, the next edit triangulates everything again
+		if (insert_vertex(v) <= 0)
+			++m_n_isolated;
+	}
+}
+
+void delaunay_triangulation::connect(int v)
+{
+	if (m_n_real == 0)
+	{
+		retriangulate();
+		return;
+	}
+
+	int result = insert_vertex(v);
+	if (result == 0)
+		++m_n_isolated;
+	else if (result < 0)
+		retriangulate();
+}
+
+void delaunay_triangulation::rebuild(const std::vector<glm::vec2>& points)
+{
+	clear();
+	for (const auto& p : points)
+		m_ids.push_back(new_vertex(p));
+	retriangulate();
+	m_rebuilds = 0;
+}
+
+void delaunay_triangulation::insert(const glm::vec2& p)
+{
+	int v = new_vertex(p);
+	m_ids.push_back(v);
+	connect(v);
+}
+
+void delaunay_triangulation::remove(int point)
+{
+	int v = m_ids[point];
+	m_ids.erase(m_ids.begin() + point);
+
+	// Duplicates left out may have to come back
+	bool local = m_n_isolated == 0 && m_n_real > 0 && remove_vertex(v);
+	m_free_vertices.push_back(v);
+	if (!local)
+		retriangulate();
+}
+
+void delaunay_triangulation::move(int point, const glm::vec2& p)
+{
+	int v = m_ids[point];
+	if (m_n_isolated > 0 || m_n_real == 0 || !remove_vertex(v))
+	{
+		m_points[v] = p;
+		retriangulate();
+		return;
+	}
+
+	m_points[v] = p;
+	connect(v);
+}
+
+void delaunay_triangulation::get_triangles(std::vector<std::array<unsigned int, 3>>& triangles) const
+{
+	std::vector<int> index(m_points.size(), -1);
+	for (size_t i = 0; i < m_ids.size(); ++i)
+		index[m_ids[i]] = (int)i;
+
+	triangles.clear();
+	for (const triangle& tri : m_triangles)
+	{
+		if (tri.m_v[0] == dead || tri.m_v[2] == infinite)
+			continue;
+		triangles.push_back({ (unsigned)index[tri.m_v[0]], (unsigned)index[tri.m_v[2]], (unsigned)index[tri.m_v[1]] });
+	}
+}
+}
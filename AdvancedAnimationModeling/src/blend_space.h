@@ -0,0 +1,139 @@
+/**
+* @file blend_space.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace cs460 {
+// Finds the triangle of a 2D blend space that contains a blend parameter. A
+// query walks from the triangle of the previous one towards the parameter, and
+// uses a uniform grid over the blend space when there is no previous triangle
+// or the parameter jumped far from it. An optional table baked on a lattice
+// answers most queries without walking: inside a cell whose corners share a
+// triangle, the weights are the bilinear interpolation of the corner weights
+// (exact, since they are linear)
+class triangle_locator
+{
+public:
+	// Builds the adjacency and the grid, and bakes the table again if there is one
+	void build(const std::vector<glm::vec2>& points, const std::vector<std::array<unsigned int, 3>>& triangles,
+		const glm::vec2& min, const glm::vec2& max);
+	void clear();
+
+	// Index of the triangle that contains p and its barycentric coordinates, -1 if p
+	// is outside of every triangle. hint is a triangle close to p (-1 if unknown)
+	int locate(const glm::vec2& p, int hint, float* weights) const;
+
+	// Bakes the table with resolution x resolution cells (0 removes it)
+	void bake(int resolution);
+	int baked_resolution() const { return m_resolution; }
+
+	int triangle_count() const { return (int)m_triangles.size(); }
+
+private:
+	// Barycentric coordinates of p in the triangle, true if p is inside
+	bool barycentric(int triangle, const glm::vec2& p, float* weights) const;
+
+	// Walks from the start triangle across the edge p is behind, -2 if it takes too long
+	int walk(const glm::vec2& p, int start, float* weights) const;
+
+	// Tests the triangles that overlap the grid cell of p
+	int grid_locate(const glm::vec2& p, float* weights) const;
+
+	std::vector<glm::vec2> m_points;
+	std::vector<std::array<unsigned int, 3>> m_triangles;
+	std::vector<float> m_areas;
+	std::vector<glm::vec2> m_centers;
+
+	// Triangle across the edge opposite to each vertex (-1 on the hull)
+	std::vector<std::array<int, 3>> m_neighbors;
+
+	// Uniform grid, triangles of cell c are m_cell_triangles[m_cell_start[c], m_cell_start[c + 1])
+	glm::vec2 m_min = glm::vec2(0.0f);
+	glm::vec2 m_max = glm::vec2(0.0f);
+	glm::vec2 m_cell_size = glm::vec2(1.0f);
+	int m_grid_size = 0;
+	std::vector<int> m_cell_start;
+	std::vector<int> m_cell_triangles;
+
+	// Triangle and weights of each lattice point, (resolution + 1)^2 points
+	struct baked_point
+	{
+		int m_triangle = -1;
+		float m_weights[3] = {};
+	};
+	int m_resolution = 0;
+	std::vector<baked_point> m_baked;
+};
+
+// Delaunay triangulation of the samples of a 2D blend space, updated in place
+// when a sample is added, removed or moved (Bowyer-Watson). Hull edges carry
+// ghost triangles that share a vertex at infinity, so samples outside of the
+// hull are inserted like the ones inside. Anything the local update cannot
+// handle (duplicate or collinear samples) triangulates everything again
+class delaunay_triangulation
+{
+public:
+	// Adds a point after the last one
+	void insert(const glm::vec2& p);
+
+	// Removes a point, the ones after it move down one index
+	void remove(int point);
+	void move(int point, const glm::vec2& p);
+
+	// Triangulates the points from scratch
+	void rebuild(const std::vector<glm::vec2>& points);
+	void clear();
+
+	// Triangles indexed by point, with the winding of delaunator (clockwise)
+	void get_triangles(std::vector<std::array<unsigned int, 3>>& triangles) const;
+
+	int point_count() const { return (int)m_ids.size(); }
+
+	// Times the local update gave up and triangulated everything
+	int full_rebuilds() const { return m_rebuilds; }
+
+private:
+	static const int infinite = -1;
+	static const int dead = -2;
+
+	// Counter-clockwise, ghosts have the infinite vertex last
+	struct triangle
+	{
+		int m_v[3];
+	};
+
+	// Connects a vertex: 1 done, 0 duplicate (left out), -1 inconsistent
+	int insert_vertex(int v);
+	bool remove_vertex(int v);
+	void connect(int v);
+	void retriangulate();
+
+	int add_triangle(int a, int b, int c);
+	void remove_triangle(int t);
+	int edge_owner(int a, int b) const;
+	bool in_circle(int t, const glm::vec2& p) const;
+	int locate(const glm::vec2& p) const;
+	int new_vertex(const glm::vec2& p);
+
+	std::vector<glm::vec2> m_points;	// By vertex
+	std::vector<int> m_ids;				// Vertex of each point
+	std::vector<int> m_free_vertices;
+
+	std::vector<triangle> m_triangles;
+	std::vector<int> m_free_triangles;
+	std::unordered_map<uint64_t, int> m_edges;	// Triangle of each half-edge
+	std::vector<int> m_vertex_triangle;			// A triangle of each vertex
+	std::vector<int> m_stamp;
+	int m_stamp_id = 0;
+
+	int m_last = -1;		// Last triangle added, where walks start
+	int m_n_real = 0;		// Triangles without the infinite vertex
+	int m_n_isolated = 0;	// Duplicate points left out
+	int m_rebuilds = 0;
+};
+}
@@ -2,342 +2,142 @@
 #include "resources.h"
 #include <imgui.h>
 #include <algorithm>
+#include <cassert>
 #include "input.h"
-#include "delaunator.h"
+#include "pose_cache.h"
+#include "animation_system.h"
 
 namespace cs460 {
-// Produce an animation pose using the given animation and animation time
-void produce_pos(const int model_idx, const int anim_idx, anim_pose& pose, float time)
+// One joint slot per node of the model
+static unsigned get_joint_count(const model_rsc& model)
 {
-	const animation* anim = &g_resources.get_model_rsc(model_idx).m_anims.at(anim_idx);
-
-	// Get channel and samplers of the animation
-	const auto& channels = anim->m_chanels;
-	const auto& samplers = anim->m_samplers;
-
-	// Infinite time
-	time = time - glm::floor(time / anim->m_max_time) * anim->m_max_time;
-	pose.clear();
-
-	// Go through each channel
-	size_t n_channels = channels.size();
-	for (size_t i = 0; i < n_channels; ++i)
-	{
-		const auto& ch = channels[i];
-		const auto& sp = samplers.at(ch.m_sampler);
-
-		// Get the transform
-		auto& t = pose[ch.m_node];
-
-		// Set transform data
-		if (ch.m_path_type == animation::channel::path_type::translation)
-		{
-			t.second |= target_type::translation;
-			t.first.set_position(ch.lerp_pos(time, sp));
-		}
-		else if (ch.m_path_type == animation::channel::path_type::rotation)
-		{
-			t.second |= target_type::rotation;
-			t.first.set_rotation(ch.lerp_rot(time, sp, true));
-		}
-		else if (ch.m_path_type == animation::channel::path_type::scale)
-		{
-			t.second |= target_type::scale;
-			t.first.set_scale(ch.lerp_pos(time, sp));
-		}
-	}
+	int n_joints = 0;
+	for (const auto& n : model.m_nodes)
+		n_joints = glm::max(n_joints, n.first + 1);
+	return (unsigned)n_joints;
 }
 
-// Blend the two animation poses using lerp
-void blend_pose_lerp(const anim_pose& to, const anim_pose& from, anim_pose& res, float blend_param)
+// Produce an animation pose using the given animation and animation time
+void produce_pos(const int model_idx, const int anim_idx, dense_pose& pose, float time, sampling_context& context)
 {
-	// Prepare the result pose
-	res.clear();
-
-	// Get iterators to the end of each pose
-	auto from_end = from.end();
-	auto to_end = to.end();
-
-	for (auto it = from.begin(); it != from_end; ++it)
-		res[it->first];
-	for (auto it = to.begin(); it != to_end; ++it)
-		res[it->first];
-
-	// Lerp poses
-	auto res_end = res.end();
-	for (auto it = res.begin(); it != res_end; ++it)
-	{
-		// Get the node index
-		unsigned int node_idx = it->first;
-
-		// Check if the transform data is not in from pose
-		if (from.find(node_idx) == from_end)
-			it->second = to.at(node_idx);
-
-		// Check if the transform data is not in to pose
-		else if (to.find(node_idx) == to_end)
-			it->second = from.at(node_idx);
-
-		// Otherwise, lerp from and to pose
-		else
-		{
-			// Get info
-			transform& res_tr = it->second.first;
-			auto& res_flags = it->second.second;
-
-			const transform& from_tr = from.at(node_idx).first;
-			const auto& from_flags = from.at(node_idx).second;
-
-			const transform& to_tr = to.at(node_idx).first;
-			const auto& to_flags = to.at(node_idx).second;
-
-			// Lerp translation:
-
-			// Case 0: Lerp translation
-			if ((from_flags & translation) != 0 && (to_flags & translation) != 0)
-			{
-				const glm::vec3& p0 = from_tr.get_position();
-				const glm::vec3& p1 = to_tr.get_position();
-				res_tr.set_position(p0 + (p1 - p0) * blend_param);
-				res_flags |= target_type::translation;
-			}
-
-			// Case 1: Translation data only on from pose
-			else if ((from_flags & translation) != 0)
-			{
-				res_tr.set_position(from_tr.get_position());
-				res_flags |= translation;
-			}
-
-			// Case 2: Translation data only on to pose
-			else if ((to_flags & translation) != 0)
-			{
-				res_tr.set_position(to_tr.get_position());
-				res_flags |= translation;
-			}
-
-			// Lerp rotation:
-
-			// Case 0: Lerp rotation
-			if ((from_flags & rotation) != 0 && (to_flags & rotation) != 0)
-			{
-				const glm::quat& q0 = from_tr.get_rotation();
-				const glm::quat& q1 = to_tr.get_rotation();
-				res_tr.set_rotation(glm::normalize(glm::slerp(q0, q1, blend_param)));
-				res_flags |= target_type::rotation;
-			}
-
-			// Case 1: Rotation data only on from pose
-			else if ((from_flags & rotation) != 0)
-			{
-				res_tr.set_rotation(from_tr.get_rotation());
-				res_flags |= rotation;
-			}
-
-			// Case 2: Rotation data only on to pose
-			else if ((to_flags & rotation) != 0)
-			{
-				res_tr.set_rotation(to_tr.get_rotation());
-				res_flags |= rotation;
-			}
+	const dense_pose* sampled = produce_pos_shared(model_idx, anim_idx, pose, time, context);
+	if (sampled != &pose)
+		pose = *sampled;
+}
 
-			// Lerp scale:
+const dense_pose* produce_pos_shared(const int model_idx, const int anim_idx, dense_pose& scratch, float time, sampling_context& context)
+{
+	const model_rsc& model = g_resources.get_model_rsc(model_idx);
+	const animation& anim = model.m_anims.at(anim_idx);
 
-			// Case 0: Scale rotation
-			if ((from_flags & scale) != 0 && (to_flags & scale) != 0)
-			{
-				const glm::vec3& s0 = from_tr.get_scale();
-				const glm::vec3& s1 = to_tr.get_scale();
-				res_tr.set_scale(s0 + (s1 - s0) * blend_param);
-				res_flags |= target_type::scale;
-			}
+	// Infinite time
+	time = time - glm::floor(time / anim.m_max_time) * anim.m_max_time;
 
-			// Case 1: Scale data only on from pose
-			else if ((from_flags & scale) != 0)
-			{
-				res_tr.set_scale(from_tr.get_scale());
-				res_flags |= scale;
-			}
+	// Reuse the pose of another instance at the same time
+	if (g_pose_cache.enabled())
+		return g_pose_cache.sample(model_idx, anim_idx, time, false, true, scratch);
 
-			// Case 2: Scale data only on to pose
-			else if ((to_flags & scale) != 0)
-			{
-				res_tr.set_scale(to_tr.get_scale());
-				res_flags |= scale;
-			}
-		}
-	}
+	// The pose keeps its size once the first frame is sampled
+	unsigned n_joints = scratch.size() ? scratch.size() : get_joint_count(model);
+	int cursor = 1;
+	sample_clip(anim, time, false, true, context, &cursor, n_joints, scratch);
+	return &scratch;
 }
 
-void barycentric_2_points_blend(anim_pose::const_iterator p0, anim_pose::const_iterator p1, float a0, float a1, anim_pose::iterator res)
+// Blend between the current poses of the children nodes to obtain the current pose of the node
+dense_pose* blend_node::produce_pose(glm::vec2& blend_param, float time, blend_eval& eval)
 {
-	// Get info
-	transform& res_tr = res->second.first;
-	auto& res_flags = res->second.second;
-
-	const transform& p0_tr = p0->second.first;
-	const auto& p0_flags = p0->second.second;
-
-	const transform& p1_tr = p1->second.first;
-	const auto& p1_flags = p1->second.second;
-
-	// Lerp translation:
-	float tmp_a0 = ((p0_flags & translation) != 0) ? a0 : 0.0f;
-	float tmp_a1 = ((p1_flags & translation) != 0) ? a1 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0)
+	pose_pool& pool = *eval.m_pool;
+	if (m_children.empty())
 	{
-		const glm::vec3& t0 = p0_tr.get_position();
-		const glm::vec3& t1 = p1_tr.get_position();
-		res_tr.set_position(tmp_a0 * t0 + tmp_a1 * t1);
-		res_flags |= target_type::translation;
+		dense_pose* pose = pool.acquire();
+		produce_pos(m_model, m_anim, *pose, time, m_context);
+		++eval.m_samples;
+		return pose;
 	}
 
-	// Lerp Rotation:
-	tmp_a0 = ((p0_flags & rotation) != 0) ? a0 : 0.0f;
-	tmp_a1 = ((p1_flags & rotation) != 0) ? a1 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0)
+	// Weights first, children that barely contribute are not evaluated
+	blend_node* children[3];
+	float weights[3];
+	int n_children = child_weights(blend_param, children, weights);
+	int n_kept = 0;
+	float total = 0.0f;
+	for (int i = 0; i < n_children; ++i)
 	{
-		const glm::quat& q0 = p0_tr.get_rotation();
-		const glm::quat& q1 = p1_tr.get_rotation();
-		res_tr.set_rotation(glm::normalize(tmp_a0 * q0 + tmp_a1 * q1));
-		res_flags |= target_type::rotation;
+		if (weights[i] <= eval.m_epsilon)
+		{
+			eval.m_saved += children[i]->sample_count(blend_param);
+			continue;
+		}
+		children[n_kept] = children[i];
+		weights[n_kept] = weights[i];
+		total += weights[i];
+		++n_kept;
 	}
 
-	// Lerp Scale:
-	tmp_a0 = ((p0_flags & scale) != 0) ? a0 : 0.0f;
-	tmp_a1 = ((p1_flags & scale) != 0) ? a1 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0)
+	// Nothing to blend
+	if (n_kept == 0)
 	{
-		const glm::vec3& s0 = p0_tr.get_scale();
-		const glm::vec3& s1 = p1_tr.get_scale();
-		res_tr.set_scale(tmp_a0 * s0 + tmp_a1 * s1);
-		res_flags |= target_type::scale;
+		dense_pose* pose = pool.acquire();
+		pose->clear();
+		return pose;
 	}
-}
 
-void barycentric_3_points_blend(anim_pose::const_iterator p0, anim_pose::const_iterator p1, anim_pose::const_iterator p2, float a0, float a1, float a2, anim_pose::iterator res)
-{
-	// Get info
-	transform& res_tr = res->second.first;
-	auto& res_flags = res->second.second;
-
-	const transform& p0_tr = p0->second.first;
-	const auto& p0_flags = p0->second.second;
-
-	const transform& p1_tr = p1->second.first;
-	const auto& p1_flags = p1->second.second;
+	// A single child is the pose of this node
+	if (n_kept == 1)
+		return children[0]->produce_pose(blend_param, time, eval);
 
-	const transform& p2_tr = p2->second.first;
-	const auto& p2_flags = p2->second.second;
-
-	// Lerp translation:
-	float tmp_a0 = ((p0_flags & translation) != 0) ? a0 : 0.0f;
-	float tmp_a1 = ((p1_flags & translation) != 0) ? a1 : 0.0f;
-	float tmp_a2 = ((p2_flags & translation) != 0) ? a2 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0 || tmp_a2 != 0)
+	// Produce the pose of each child and blend them with the renormalized weights
+	dense_pose* child_poses[3];
+	for (int i = 0; i < n_kept; ++i)
 	{
-		const glm::vec3& t0 = p0_tr.get_position();
-		const glm::vec3& t1 = p1_tr.get_position();
-		const glm::vec3& t2 = p2_tr.get_position();
-		res_tr.set_position(tmp_a0 * t0 + tmp_a1 * t1 + tmp_a2 * t2);
-		res_flags |= target_type::translation;
+		child_poses[i] = children[i]->produce_pose(blend_param, time, eval);
+		weights[i] /= total;
 	}
 
-	// Lerp Rotation:
-	tmp_a0 = ((p0_flags & rotation) != 0) ? a0 : 0.0f;
-	tmp_a1 = ((p1_flags & rotation) != 0) ? a1 : 0.0f;
-	tmp_a2 = ((p2_flags & rotation) != 0) ? a2 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0 || tmp_a2 != 0)
-	{
-		const glm::quat& q0 = p0_tr.get_rotation();
-		const glm::quat& q1 = p1_tr.get_rotation();
-		const glm::quat& q2 = p2_tr.get_rotation();
-		res_tr.set_rotation(glm::normalize(tmp_a0 * q0 + tmp_a1 * q1 + tmp_a2 * q2));
-		res_flags |= target_type::rotation;
-	}
+	dense_pose* pose = pool.acquire();
+	if (n_kept == 2)
+		lerp_poses(*child_poses[0], *child_poses[1], weights[1], *pose);
+	else
+		blend_poses(child_poses, weights, n_kept, *pose);
 
-	// Lerp Scale:
-	tmp_a0 = ((p0_flags & scale) != 0) ? a0 : 0.0f;
-	tmp_a1 = ((p1_flags & scale) != 0) ? a1 : 0.0f;
-	tmp_a2 = ((p2_flags & scale) != 0) ? a2 : 0.0f;
-	if (tmp_a0 != 0 || tmp_a1 != 0 || tmp_a2 != 0)
-	{
-		const glm::vec3& s0 = p0_tr.get_scale();
-		const glm::vec3& s1 = p1_tr.get_scale();
-		const glm::vec3& s2 = p2_tr.get_scale();
-		res_tr.set_scale(tmp_a0 * s0 + tmp_a1 * s1 + tmp_a2 * s2);
-		res_flags |= target_type::scale;
-	}
+	for (int i = 0; i < n_kept; ++i)
+		pool.release(child_poses[i]);
+	return pose;
 }
 
-// Blend the two animation poses using barycentric coordinates
-void blend_pose_barycentric(const anim_pose& p0, const anim_pose& p1, const anim_pose& p2, float a0, float a1, float a2, anim_pose& res)
+int blend_node::sample_count(glm::vec2 blend_param)
 {
-	// Prepare the result pose
-	res.clear();
-
-	// Get iterators to the end of each pose
-	auto p0_end = p0.end();
-	auto p1_end = p1.end();
-	auto p2_end = p2.end();
-
-	// Initialize the result pose
-	for (auto it = p0.begin(); it != p0_end; ++it)
-		res[it->first];
-	for (auto it = p1.begin(); it != p1_end; ++it)
-		res[it->first];
-	for (auto it = p2.begin(); it != p2_end; ++it)
-		res[it->first];
-
-	// Barycentric blend
-	auto end = res.end();
-	for (auto it = res.begin(); it != end; ++it)
-	{
-		unsigned int node_idx = it->first;
-
-		// Find the poses
-		auto pose_0 = p0.find(node_idx);
-		auto pose_1 = p1.find(node_idx);
-		auto pose_2 = p2.find(node_idx);
-
-		// Case 0: Transform data only in pose 0
-		if (pose_1 == p1_end && pose_2 == p2_end)
-			it->second = pose_0->second;
-
-		// Case 1: Transform data only in pose 1
-		else if (pose_0 == p0_end && pose_2 == p2_end)
-			it->second = pose_1->second;
-
-		// Case 2: Transform data only in pose 2
-		else if (pose_0 == p0_end && pose_1 == p1_end)
-			it->second = pose_1->second;
-
-		// Case 3: Transform data only in pose 0 and 1
-		else if (pose_2 == p2_end)
-			barycentric_2_points_blend(pose_0, pose_1, a0, a1, it);
-
-		// Case 4: Transform data only in pose 1 and 2
-		else if (pose_0 == p0_end)
-			barycentric_2_points_blend(pose_1, pose_2, a1, a2, it);
+	if (m_children.empty())
+		return 1;
 
-		// Case 5: Transform data only in pose 2 and 0
-		else if (pose_1 == p1_end)
-			barycentric_2_points_blend(pose_2, pose_0, a2, a0, it);
+	blend_node* children[3];
+	float weights[3];
+	int n_children = child_weights(blend_param, children, weights);
 
-		// Case 2: Blend Transform data
-		else
-			barycentric_3_points_blend(pose_0, pose_1, pose_2, a0, a1, a2, it);
-	}
+	int count = 0;
+	for (int i = 0; i < n_children; ++i)
+		count += children[i]->sample_count(blend_param);
+	return count;
 }
 
-// Blend between the current poses of the children nodes to obtain the current pose of the node
-void blend_node::produce_pose(glm::vec2& blend_param, float time)
+blend_node* blend_node::dominant_child(glm::vec2 blend_param)
 {
-	if (m_children.empty())
-		produce_pos(m_model, m_anim, m_current_pose, time);
+	blend_node* children[3];
+	float weights[3];
+	int n_children = child_weights(blend_param, children, weights);
 
-	else
-		blend_children(blend_param, time);
+	blend_node* dominant = nullptr;
+	float max_weight = -1.0f;
+	for (int i = 0; i < n_children; ++i)
+	{
+		if (weights[i] > max_weight)
+		{
+			dominant = children[i];
+			max_weight = weights[i];
+		}
+	}
+	return dominant;
 }
 
 // Finds the two child blend nodes that encapsulate the given parameter
@@ -478,8 +278,11 @@ bool blend_node_1d::find_segment_rec(float param, int* left, int* right)
 	return false;
 }
 
-void blend_node_1d::blend_children(glm::vec2& blend_param, float time)
+int blend_node_1d::child_weights(glm::vec2& blend_param, blend_node** children, float* weights)
 {
+	if (!enough_blend_nodes())
+		return 0;
+
 	// Clamp the blend parameter
 	float min = m_children[0]->m_blend_pos.x;
 	float max = m_children.back()->m_blend_pos.x;
@@ -489,18 +292,17 @@ void blend_node_1d::blend_children(glm::vec2& blend_param, float time)
 	blend_node *to, *from;
 	find_segment(blend_param.x, to, from);
 
-	// Produce the current pose of the child blend nodes
-	to->produce_pose(blend_param, time);
-	from->produce_pose(blend_param, time);
-
 	// Compute the normalized blend parameter
 	float local_diff = blend_param.x - from->m_blend_pos.x;
 	float total_diff = to->m_blend_pos.x - from->m_blend_pos.x;
 
 	float norm_param = (total_diff != 0) ? local_diff / total_diff : 0.0f;
 
-	// Lerp the poses to produce the pose of this node
-	blend_pose_lerp(to->m_current_pose, from->m_current_pose, m_current_pose, norm_param);
+	children[0] = from;
+	children[1] = to;
+	weights[0] = 1.0f - norm_param;
+	weights[1] = norm_param;
+	return 2;
 }
 
 void blend_node_1d::insert_node(int model_idx, int anim_idx, const glm::vec2& blend_pos)
@@ -519,9 +321,10 @@ void blend_node_1d::insert_node(int model_idx, int anim_idx, const glm::vec2& bl
 	sort_childs();
 }
 
-void blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
+bool blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
 {
 	size_t n_childs = m_children.size();
+	bool edited = false;
 
 	// Set the tree node flags
 	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanAvailWidth;
@@ -554,6 +357,7 @@ void blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
 					if (ImGui::Selectable(anims[i].m_name.c_str()))
 					{
 						m_anim = (int)i;
+						edited = true;
 						break;
 					}
 				}
@@ -563,7 +367,10 @@ void blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
 			// Show the blend position
 			ImGui::Text("Node Blend Position:");
 			if (ImGui::InputFloat("blend pos", &m_blend_pos.x, 0.0f, 0.0f, "%.3f", ImGuiInputTextFlags_EnterReturnsTrue))
+			{
 				m_parent->sort_childs();
+				edited = true;
+			}
 		}
 
 		// Root node
@@ -572,6 +379,7 @@ void blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
 			// Add a blend node child
 			if (ImGui::Button("Add Blend Node"))
 			{
+				edited = true;
 				if (n_childs == 0)
 					insert_node(m_model, 0, glm::vec2(0.0f, 0.0f));
 				else
@@ -582,108 +390,84 @@ void blend_node_1d::imgui(int tree_level, int child_id, blend_node*& selected)
 			else
 			{
 				for (size_t i = 0; i < n_childs; ++i)
-					m_children[i]->imgui(tree_level + 1, (int)i, selected);
+					edited = m_children[i]->imgui(tree_level + 1, (int)i, selected) || edited;
 			}
 		}
 
 		ImGui::TreePop();
 	}
+
+	return edited;
 }
 
-void blend_node_2d::generate_triangles()
+void blend_node_2d::update_triangles()
 {
-	if (!enough_blend_nodes())
+	if (!m_triangles_dirty)
 		return;
+	m_triangles_dirty = false;
+	m_inside_triangle = -1;
 
-	// Set the input vector for triangulation
-	size_t n_nodes = m_children.size();
-	size_t n_coords = n_nodes * 2;
-	std::vector<double> coords(n_coords);
-	for (size_t node = 0; node < n_nodes; ++node)
+	if (!enough_blend_nodes())
 	{
-		// Get the blend position
-		const glm::vec2& coord = m_children[node]->m_blend_pos;
-
-		// Set the blend position in the input vector
-		size_t coord_idx = node * 2;
-		coords[coord_idx] = coord.x;
-		coords[coord_idx + 1] = coord.y;
+		m_triangles.clear();
+		m_locator.clear();
+		return;
 	}
 
-	// Triangulation with Delaunay
-	delaunator::Delaunator del(coords);
-
 	// Save the triangle indices
-	size_t size = del.triangles.size();
-	size_t n_triangles = size / 3;
-	m_triangles.resize(n_triangles);
-	for (size_t i = 0; i < n_triangles; ++i)
-	{
-		size_t idx = 3 * i;
-		m_triangles[i][0] = (unsigned int)del.triangles[idx];
-		m_triangles[i][1] = (unsigned int)del.triangles[idx + 1];
-		m_triangles[i][2] = (unsigned int)del.triangles[idx + 2];
-	}
+	m_delaunay.get_triangles(m_triangles);
+
+	// Point location over the new triangles
+	size_t n_nodes = m_children.size();
+	std::vector<glm::vec2> points(n_nodes);
+	for (size_t node = 0; node < n_nodes; ++node)
+		points[node] = m_children[node]->m_blend_pos;
+	m_locator.build(points, m_triangles, m_min, m_max);
 }
 
-void blend_node_2d::find_nodes_barycentric(const glm::vec2& blend_param, blend_node*& n0, blend_node*& n1, blend_node*& n2, float& a0, float& a1, float& a2)
+void blend_node_2d::move_child(blend_node* node)
 {
-	// Number of triangles
-	size_t n_triangles = m_triangles.size();
-
-	// Check with each triangle
-	for (size_t i = 0; i < n_triangles; ++i)
-	{
-		const auto& t_idx = m_triangles[i];
+	auto it = std::find(m_children.begin(), m_children.end(), node);
+	if (it == m_children.end())
+		return;
 
-		// Get the blend nodes that form the triangle
-		blend_node* bn0 = m_children[t_idx[0]];
-		blend_node* bn1 = m_children[t_idx[1]];
-		blend_node* bn2 = m_children[t_idx[2]];
+	// Update min max values
+	update_min_max_blend_param();
+	m_delaunay.move((int)(it - m_children.begin()), node->m_blend_pos);
+	m_triangles_dirty = true;
+}
 
-		// Get the positions of each node
-		const glm::vec2& p0 = bn0->m_blend_pos;
-		const glm::vec2& p1 = bn1->m_blend_pos;
-		const glm::vec2& p2 = bn2->m_blend_pos;
+void blend_node_2d::find_nodes_barycentric(const glm::vec2& blend_param, blend_node*& n0, blend_node*& n1, blend_node*& n2, float& a0, float& a1, float& a2)
+{
+	update_triangles();
 
-		// Check if parameter is inside the triangle
-		if (compute_barycentric(blend_param, p0, p1, p2, a0, a1, a2))
-		{
-			// Set blend node pointers
-			n0 = bn0; n1 = bn1; n2 = bn2;
-			m_inside_triangle = (int)i;
-			return;
-		}
-	}
+	// Walk from the triangle of the last parameter
+	float weights[3];
+	m_inside_triangle = m_locator.locate(blend_param, m_inside_triangle, weights);
+	if (m_inside_triangle < 0)
+		return;
 
-	// Blend parameter is not inside of any triangle
-	m_inside_triangle = -1;
+	// Set blend node pointers
+	const auto& t_idx = m_triangles[m_inside_triangle];
+	n0 = m_children[t_idx[0]];
+	n1 = m_children[t_idx[1]];
+	n2 = m_children[t_idx[2]];
+	a0 = weights[0];
+	a1 = weights[1];
+	a2 = weights[2];
 }
 
-void blend_node_2d::blend_children(glm::vec2& blend_param, float time)
+int blend_node_2d::child_weights(glm::vec2& blend_param, blend_node** children, float* weights)
 {
+	if (!enough_blend_nodes())
+		return 0;
+
 	// Clamp the blend parameter
 	blend_param.x = glm::clamp(blend_param.x, m_min.x, m_max.x);
 	blend_param.y = glm::clamp(blend_param.y, m_min.y, m_max.y);
 
-	blend_node* n0, * n1, * n2;
-	float a0, a1, a2;
-	find_nodes_barycentric(blend_param, n0, n1, n2, a0, a1, a2);
-
-	// Produce the pose of each node
-	if (m_inside_triangle >= 0)
-	{
-		n0->produce_pose(blend_param, time);
-		n1->produce_pose(blend_param, time);
-		n2->produce_pose(blend_param, time);
-
-		// Lerp the poses to produce the pose of this node
-		blend_pose_barycentric(
-			n0->m_current_pose, n1->m_current_pose, n2->m_current_pose,
-			a0, a1, a2, m_current_pose);
-	}
-	else
-		m_current_pose.clear();
+	find_nodes_barycentric(blend_param, children[0], children[1], children[2], weights[0], weights[1], weights[2]);
+	return m_inside_triangle >= 0 ? 3 : 0;
 }
 
 void blend_node_2d::insert_node(int model_idx, int anim_idx, const glm::vec2& blend_pos)
@@ -704,13 +488,15 @@ void blend_node_2d::insert_node(int model_idx, int anim_idx, const glm::vec2& bl
 	// Add the node
 	m_children.push_back(node);
 
-	// Sort the children
-	generate_triangles();
+	// Add it to the triangulation
+	m_delaunay.insert(blend_pos);
+	m_triangles_dirty = true;
 }
 
-void blend_node_2d::imgui(int tree_level, int child_id, blend_node*& selected)
+bool blend_node_2d::imgui(int tree_level, int child_id, blend_node*& selected)
 {
 	size_t n_childs = m_children.size();
+	bool edited = false;
 
 	// Set the tree node flags
 	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanAvailWidth;
@@ -743,6 +529,7 @@ void blend_node_2d::imgui(int tree_level, int child_id, blend_node*& selected)
 					if (ImGui::Selectable(anims[i].m_name.c_str()))
 					{
 						m_anim = (int)i;
+						edited = true;
 						break;
 					}
 				}
@@ -753,18 +540,24 @@ void blend_node_2d::imgui(int tree_level, int child_id, blend_node*& selected)
 			ImGui::Text("Node Blend Position:");
 			if (ImGui::InputFloat2("blend pos", &m_blend_pos.x, "%.3f", ImGuiInputTextFlags_EnterReturnsTrue))
 			{
-				// Update min max values
-				m_parent->update_min_max_blend_param();
-				static_cast<blend_node_2d*>(m_parent)->generate_triangles();
+				// Update min max values and the triangles around the node
+				static_cast<blend_node_2d*>(m_parent)->move_child(this);
+				edited = true;
 			}
 		}
 
 		// Root node
 		else
 		{
+			// Cells of the baked weight table per axis
+			int resolution = m_locator.baked_resolution();
+			if (ImGui::SliderInt("lookup table", &resolution, 0, 128))
+				set_lookup_resolution(resolution);
+
 			// Add a blend node child
 			if (ImGui::Button("Add Blend Node"))
 			{
+				edited = true;
 				if (n_childs == 0)
 					insert_node(m_model, 0, glm::vec2(0.0f, 0.0f));
 				else
@@ -775,12 +568,14 @@ void blend_node_2d::imgui(int tree_level, int child_id, blend_node*& selected)
 			else
 			{
 				for (size_t i = 0; i < n_childs; ++i)
-					m_children[i]->imgui(tree_level + 1, (int)i, selected);
+					edited = m_children[i]->imgui(tree_level + 1, (int)i, selected) || edited;
 			}
 		}
 
 		ImGui::TreePop();
 	}
+
+	return edited;
 }
 
 void blend_node_2d::erase_child(blend_node* node)
@@ -789,11 +584,13 @@ void blend_node_2d::erase_child(blend_node* node)
 		return;
 
 	auto it = std::find(m_children.begin(), m_children.end(), node);
-	if (it != m_children.end())
-		m_children.erase(it);
+	if (it == m_children.end())
+		return;
+	m_delaunay.remove((int)(it - m_children.begin()));
+	m_children.erase(it);
 	
 	update_min_max_blend_param();
-	generate_triangles();
+	m_triangles_dirty = true;
 }
 
 void blend_node_2d::blend_graph(const glm::vec2& blend_param)
@@ -803,6 +600,12 @@ void blend_node_2d::blend_graph(const glm::vec2& blend_param)
 	// Draw List
 	if (n_childs >= 3)
 	{
+		// Triangle of the parameter, compiled trees do not go through the nodes
+		glm::vec2 param = blend_param;
+		blend_node* children[3];
+		float weights[3];
+		child_weights(param, children, weights);
+
 		// Child contains the draw list
 		ImGui::BeginChild("draw list", ImVec2(ImGui::GetWindowWidth() - 50.0f, 180.0f), true);
 		ImGui::EndChild();
@@ -898,28 +701,6 @@ void blend_node_2d::update_min_max_blend_param()
 	}
 }
 
-// Performs just the cross product for the z-axis
-float blend_node_2d::cross_product(const glm::vec2& v0, const glm::vec2& v1)
-{
-	return (v0.x * v1.y - v0.y * v1.x);
-}
-
-bool blend_node_2d::compute_barycentric(const glm::vec2& point, const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, float& a0, float& a1, float& a2)
-{
-	// Compute the area of the triangle
-	float total_area = glm::abs(cross_product(p2 - p0, p1 - p0));
-
-	const glm::vec2& pp0 = p0 - point;
-	const glm::vec2& pp1 = p1 - point;
-	const glm::vec2& pp2 = p2 - point;
-
-	a0 = cross_product(pp2, pp1) / total_area;
-	a1 = cross_product(pp0, pp2) / total_area;
-	a2 = cross_product(pp1, pp0) / total_area;
-
-	return (a0 >= 0.0f && a1 >= 0.0f && a2 >= 0.0f);
-}
-
 // Free the memory of the entire blend tree
 void blend_tree::destroy()
 {
@@ -927,6 +708,10 @@ void blend_tree::destroy()
 		destroy_rec(m_root);
 
 	m_root = nullptr;
+	m_final_pose = nullptr;
+	m_pool.clear();
+	m_program.clear();
+	m_dirty = true;
 }
 
 void blend_tree::imgui()
@@ -939,6 +724,7 @@ void blend_tree::imgui()
 	{
 		m_root->erase_child(m_selected);
 		m_selected = nullptr;
+		m_dirty = true;
 	}
 
 	ImGui::Begin("Blend Editor");
@@ -961,34 +747,88 @@ void blend_tree::imgui()
 	// Blend Tree
 	if (ImGui::TreeNode("Blend Tree"))
 	{
-		m_root->imgui(0, 0, m_selected);
+		if (m_root->imgui(0, 0, m_selected))
+			m_dirty = true;
 		ImGui::TreePop();
 	}
+
+	// Intermediate poses
+	ImGui::Separator();
+	ImGui::Text("Pose pool: %d poses, %d allocations", m_pool.size(), m_pool.allocations());
+
+	// Skipped children
+	ImGui::SliderFloat("Prune weight", &m_epsilon, 0.0f, 0.1f);
+	ImGui::Text("Clip samples: %d (%d saved, %d shared)", m_samples, m_saved, m_shared);
+
+	// Flat evaluation
+	ImGui::Checkbox("Compiled", &m_use_program);
+	ImGui::SameLine();
+	ImGui::Text("%d ops, %d poses", m_program.op_count(), m_program.slot_count());
 	ImGui::End();
 }
 
-const anim_pose* blend_tree::produce_pose(float time)
+const dense_pose* blend_tree::produce_pose(float time)
 {
 	if (!m_root || !m_root->enough_blend_nodes())
 	{
 		return nullptr;
 	}
 
-	// Produce the final pose
-	m_root->produce_pose(m_blend_param, time);
-	return &m_root->m_current_pose;
+	// The final pose of the last evaluation goes back to the pool
+	if (m_final_pose)
+		m_pool.release(m_final_pose);
+	m_final_pose = nullptr;
+
+	blend_eval eval;
+	eval.m_pool = &m_pool;
+	eval.m_epsilon = m_epsilon;
+
+	// Run the program, compiled again if the tree changed
+	const dense_pose* pose = nullptr;
+	if (m_use_program)
+	{
+		if (m_dirty)
+			compile();
+		pose = m_program.run(m_blend_param, time, eval);
+	}
+
+	// Produce the final pose through the nodes
+	else
+	{
+		m_final_pose = m_root->produce_pose(m_blend_param, time, eval);
+		pose = m_final_pose;
+	}
+
+	m_samples = eval.m_samples;
+	m_saved = eval.m_saved;
+	m_shared = eval.m_shared;
+	return pose;
+}
+
+blend_node* blend_tree::dominant_leaf()
+{
+	if (!m_root || !m_root->enough_blend_nodes())
+		return nullptr;
+
+	// Follow the heaviest child down to a clip
+	blend_node* node = m_root;
+	while (node && !node->m_children.empty())
+		node = node->dominant_child(m_blend_param);
+	return node;
 }
 
 void blend_tree::create_1d_blend_tree()
 {
 	destroy();
 	m_root = new blend_node_1d;
+	m_dirty = true;
 }
 
 void blend_tree::create_2d_blend_tree()
 {
 	destroy();
 	m_root = new blend_node_2d;
+	m_dirty = true;
 }
 
 void blend_tree::insert_blend_node(int model_idx, int anim_idx, const glm::vec2& blend_pos)
@@ -996,6 +836,25 @@ void blend_tree::insert_blend_node(int model_idx, int anim_idx, const glm::vec2&
 	// Insert the node
 	m_root->m_model = model_idx;
 	m_root->insert_node(model_idx, anim_idx, blend_pos);
+	m_pool.set_joint_count(get_joint_count(g_resources.get_model_rsc(model_idx)));
+	m_dirty = true;
+}
+
+void blend_tree::insert_blend_subtree(blend_node* node)
+{
+	// 2D roots only take the clips of insert_blend_node, they triangulate them
+	assert(dynamic_cast<blend_node_1d*>(m_root));
+	node->m_parent = m_root;
+	m_root->m_children.push_back(node);
+	m_root->sort_childs();
+	m_pool.set_joint_count(get_joint_count(g_resources.get_model_rsc(node->m_model)));
+	m_dirty = true;
+}
+
+void blend_tree::compile()
+{
+	m_program.compile(m_root, m_pool.joint_count());
+	m_dirty = false;
 }
 
 void blend_tree::destroy_rec(blend_node* node)
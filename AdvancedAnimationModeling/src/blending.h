@@ -3,15 +3,32 @@
 #include <glm/glm.hpp>
 #include <unordered_map>
 #include "transform.h"
+#include "resources.h"
+#include "pose.h"
+#include "blend_program.h"
+#include "blend_space.h"
 #include <string>
 #include <array>
 
 namespace cs460 {
-struct animation;
 
-typedef std::unordered_map<unsigned int, std::pair<transform, unsigned char>> anim_pose;
+// Produce an animation pose using the given animation and animation time
+void produce_pos(const int model_idx, const int anim_idx, dense_pose& pose, float time, sampling_context& context);
 
-enum target_type { translation = 1, rotation = 2, scale = 4 };
+// Same as produce_pos, but returns the pose of the pose cache when there is one
+// instead of copying it (valid until the cache starts a new frame). Otherwise
+// the clip is sampled into scratch
+const dense_pose* produce_pos_shared(const int model_idx, const int anim_idx, dense_pose& scratch, float time, sampling_context& context);
+
+// State shared by the nodes while a tree is evaluated
+struct blend_eval
+{
+	pose_pool* m_pool = nullptr;
+	float m_epsilon = 0.0f;	// Children with this weight or less are not evaluated
+	int m_samples = 0;		// Clips sampled
+	int m_saved = 0;		// Clips a full evaluation would have sampled on top
+	int m_shared = 0;		// Leaves that took the pose of another leaf with the same clip
+};
 
 struct blend_node
 {
@@ -23,14 +40,23 @@ struct blend_node
 	int m_model = 0;
 	int m_anim = 0;
 
-	anim_pose m_current_pose;
+	// Keyframe cursors of the animation sampled by this node (leaf nodes only)
+	sampling_context m_context;
 
-	void produce_pose(glm::vec2& blend_param, float time);
+	// Returns the pose of the node, taken from the pool of the evaluation (the caller gives it back)
+	dense_pose* produce_pose(glm::vec2& blend_param, float time, blend_eval& eval);
+
+	// Number of clips sampled under this node when no child is skipped
+	int sample_count(glm::vec2 blend_param);
+
+	// Child with the largest blend weight for the given parameter
+	blend_node* dominant_child(glm::vec2 blend_param);
 
 	// Implemented by objects that inherit from blend_node
-	virtual void blend_children(glm::vec2& blend_param, float time) {}
+	// Children blended for the parameter and their weights (3 at most), returns the count
+	virtual int child_weights(glm::vec2& blend_param, blend_node** children, float* weights) { return 0; }
 	virtual void insert_node(int model_idx, int anim_idx, const glm::vec2& blend_pos) {}
-	virtual void imgui(int tree_level, int child_id, blend_node*& selected) {}
+	virtual bool imgui(int tree_level, int child_id, blend_node*& selected) { return false; }
 	virtual void sort_childs() {}
 	virtual void erase_child(blend_node* node) {}
 	virtual void blend_graph(const glm::vec2& blend_param) {}
@@ -42,9 +68,9 @@ struct blend_node
 struct blend_node_1d : public blend_node
 {
 	void find_segment(float param, blend_node*& to, blend_node*& from);
-	virtual void blend_children(glm::vec2& blend_param, float time);
+	virtual int child_weights(glm::vec2& blend_param, blend_node** children, float* weights);
 	virtual void insert_node(int model_idx, int anim_idx, const glm::vec2& blend_pos);
-	virtual void imgui(int tree_level, int child_id, blend_node*& selected);
+	virtual bool imgui(int tree_level, int child_id, blend_node*& selected);
 	virtual void sort_childs();
 	virtual void erase_child(blend_node* node);
 	virtual void blend_graph(const glm::vec2& blend_param);
@@ -57,19 +83,35 @@ private:
 
 struct blend_node_2d : public blend_node
 {
-	virtual void blend_children(glm::vec2& blend_param, float time);
+	virtual int child_weights(glm::vec2& blend_param, blend_node** children, float* weights);
 	virtual void insert_node(int model_idx, int anim_idx, const glm::vec2& blend_pos);
-	virtual void imgui(int tree_level, int child_id, blend_node*& selected);
+	virtual bool imgui(int tree_level, int child_id, blend_node*& selected);
 	virtual void erase_child(blend_node* node);
 	virtual void blend_graph(const glm::vec2& blend_param);
 	virtual bool enough_blend_nodes();
 	virtual void get_min_max_blend_param(glm::vec2& min, glm::vec2& max);
 	virtual void update_min_max_blend_param();
 
+	const std::vector<std::array<unsigned int, 3>>& get_triangles() { update_triangles(); return m_triangles; }
+	const triangle_locator& get_locator() { update_triangles(); return m_locator; }
+
+	// Resolution of the baked weight table (0 locates every parameter by walking)
+	void set_lookup_resolution(int resolution) { update_triangles(); m_locator.bake(resolution); }
+
+	// Updates the triangles around a child whose blend position changed
+	void move_child(blend_node* node);
+
 private:
-	// Triangle container. Populated generate_triangles()
+	// Triangle container. Populated from m_delaunay by update_triangles()
 	std::vector<std::array<unsigned int, 3>> m_triangles;
 
+	// Triangulation of the children, updated in place by every edit
+	delaunay_triangulation m_delaunay;
+	bool m_triangles_dirty = false;
+
+	// Finds the triangle of the blend parameter, rebuilt with the triangles
+	triangle_locator m_locator;
+
 	// Min and max blend parameters
 	glm::vec2 m_min = glm::vec2(0.0f);
 	glm::vec2 m_max = glm::vec2(1.0f);
@@ -79,12 +121,8 @@ private:
 	void find_nodes_barycentric(const glm::vec2& blend_param,
 		blend_node*& n0, blend_node*& n1, blend_node*& n2, float& a0, float& a1, float& a2);
 
-	float cross_product(const glm::vec2& v0, const glm::vec2& v1);
-	bool compute_barycentric(const glm::vec2& point, const glm::vec2& p0, const glm::vec2& p1, const glm::vec2& p2, 
-		float& a0, float& a1, float& a2);
-
-	// Generates the triangles using delaunay triangulation
-	void generate_triangles();
+	// Copies the triangles of m_delaunay and rebuilds the locator if they changed
+	void update_triangles();
 
 	int m_inside_triangle = -1;
 };
@@ -94,12 +132,41 @@ class blend_tree
 public:
 	void destroy();
 	void imgui();
-	const anim_pose* produce_pose(float time);
+	const dense_pose* produce_pose(float time);
 	void create_1d_blend_tree();
 	void create_2d_blend_tree();
 	void insert_blend_node(int model_idx, int anim_idx, const glm::vec2& blend_pos);
 	void set_blend_param(const glm::vec2& param) { m_blend_param = param; }
 	void display_blend_graph() const { if (m_root) m_root->blend_graph(m_blend_param); }
+	const pose_pool& get_pose_pool() const { return m_pool; }
+	blend_node* get_root() const { return m_root; }
+
+	// Adds a blend node built by the caller, with its children, under a 1D root. The tree owns it after
+	void insert_blend_subtree(blend_node* node);
+
+	// Number of clips a full evaluation samples for the given parameter (0 if the tree is incomplete)
+	int sample_count(const glm::vec2& param) const { return m_root ? m_root->sample_count(param) : 0; }
+
+	// Children with this weight or less are skipped and the weights of the rest renormalized
+	void set_prune_epsilon(float epsilon) { m_epsilon = epsilon; }
+	float get_prune_epsilon() const { return m_epsilon; }
+
+	// Clips sampled, clips skipped and leaves that reused a clip in the last evaluation
+	int samples() const { return m_samples; }
+	int saved_samples() const { return m_saved; }
+	int shared_samples() const { return m_shared; }
+
+	// Leaf node whose clip has the largest weight in the final pose (null if the tree is incomplete)
+	blend_node* dominant_leaf();
+
+	// Evaluate the compiled program instead of the nodes. The program is rebuilt
+	// after the tree is edited
+	void set_use_program(bool use_program) { m_use_program = use_program; }
+	bool get_use_program() const { return m_use_program; }
+	const blend_program& get_program() const { return m_program; }
+
+	// Compiles the program from the nodes
+	void compile();
 
 private:
 	void destroy_rec(blend_node* node);
@@ -107,5 +174,19 @@ private:
 	blend_node* m_selected = nullptr;
 	blend_node* m_root = nullptr;
 	glm::vec2 m_blend_param = glm::vec2(0.0f);
+
+	// Intermediate poses, the final pose is kept until the next evaluation
+	pose_pool m_pool;
+	dense_pose* m_final_pose = nullptr;
+
+	float m_epsilon = 0.001f;
+	int m_samples = 0;
+	int m_saved = 0;
+	int m_shared = 0;
+
+	// Flat version of the nodes
+	blend_program m_program;
+	bool m_use_program = true;
+	bool m_dirty = true;
 };
 }
\ No newline at end of file
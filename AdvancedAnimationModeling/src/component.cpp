@@ -5,7 +5,11 @@
 * @copyright Copyright (C) 2020 DigiPen Institute of Technology .
 */
 #include "component.h"
+#include "node.h"
 
 namespace cs460 {
-
+bool component::in_scene() const
+{
+	return m_owner && m_owner->m_in_scene;
+}
 }
\ No newline at end of file
@@ -8,6 +8,9 @@
 
 namespace cs460 {
 struct node;
+template <typename T> class component_pool;
+
+// Components live in the pool of their type, see component_pool.h
 class component
 {
 public:
@@ -19,7 +22,19 @@ public:
 	node* get_owner() { return m_owner; }
 	void set_owner(node* parent) { m_owner = parent; }
 
+	// Id of the type the component was created as
+	unsigned get_type_id() const { return m_type_id; }
+
+	// True if the owner is attached under the root of the scene
+	bool in_scene() const;
+
 private:
+	template <typename T> friend class component_pool;
+
 	node* m_owner = nullptr;
+
+	// Type and slot in the pool, set by the pool
+	unsigned m_type_id = 0;
+	unsigned m_pool_slot = 0;
 };
 }
\ No newline at end of file
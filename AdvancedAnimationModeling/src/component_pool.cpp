@@ -0,0 +1,28 @@
+/**
+* @file component_pool.cpp
+* @date 2026/10/17
+*/
+#include "component_pool.h"
+
+namespace cs460 {
+component_pools& component_pools::get_instance()
+{
+	static component_pools p;
+	return p;
+}
+
+void component_pools::add(unsigned type_id, component_pool_base* pool)
+{
+	if (m_pools.size() <= type_id)
+		m_pools.resize(type_id + 1, nullptr);
+	m_pools[type_id] = pool;
+	m_order.push_back(pool);
+}
+
+void component_pools::update_all()
+{
+	// Updates can create the first component of a new type
+	for (size_t i = 0; i < m_order.size(); ++i)
+		m_order[i]->update_all();
+}
+}
@@ -0,0 +1,167 @@
+/**
+* @file component_pool.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "component.h"
+
+namespace cs460 {
+// Base of the typed pools, so they can be reached from the type id of a component
+class component_pool_base
+{
+public:
+	virtual ~component_pool_base() {}
+
+	// Destroys a component of the pool
+	virtual void release(component* comp) = 0;
+
+	// Updates every component of the pool, nothing if the type does not override update
+	virtual void update_all() = 0;
+};
+
+// All the component pools, indexed by component type id
+class component_pools
+{
+public:
+	static component_pools& get_instance();
+
+	// Returns the id of a new component type
+	unsigned new_type_id() { return m_next_id++; }
+
+	void add(unsigned type_id, component_pool_base* pool);
+	component_pool_base* get(unsigned type_id) { return m_pools[type_id]; }
+
+	// Updates the pools in the order they were created. Components of one type are
+	// updated together, not in the order of their nodes in the scene
+	void update_all();
+
+private:
+	unsigned m_next_id = 0;
+	std::vector<component_pool_base*> m_pools;
+	std::vector<component_pool_base*> m_order;
+};
+
+#define g_component_pools component_pools::get_instance()
+
+// Id of each component type, given the first time the type is used. Only the
+// exact type matches, a pool of derived components is not found from the base
+template <typename T>
+unsigned component_type_id()
+{
+	static const unsigned id = g_component_pools.new_type_id();
+	return id;
+}
+
+// Components of one type stored in blocks of 64 so the addresses never change.
+// A mask per block tells which slots are alive
+template <typename T>
+class component_pool : public component_pool_base
+{
+public:
+	static component_pool& get_instance()
+	{
+		static component_pool p;
+		return p;
+	}
+
+	T* create();
+	virtual void release(component* comp);
+	virtual void update_all();
+
+	// Calls f on every component of the pool whose owner is in the scene, block by block
+	template <typename F>
+	void for_each(F f);
+
+	unsigned size() const { return m_size; }
+
+private:
+	component_pool() { g_component_pools.add(component_type_id<T>(), this); }
+
+	static const unsigned s_block_size = 64;
+	struct block
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type m_slots[s_block_size];
+		uint64_t m_live = 0;
+
+		T* get(unsigned i) { return reinterpret_cast<T*>(&m_slots[i]); }
+	};
+
+	std::vector<std::unique_ptr<block>> m_blocks;
+
+	// Blocks with some free slot
+	std::vector<unsigned> m_free_blocks;
+	unsigned m_size = 0;
+};
+
+template <typename T>
+T* component_pool<T>::create()
+{
+	if (m_free_blocks.empty())
+	{
+		m_free_blocks.push_back((unsigned)m_blocks.size());
+		m_blocks.emplace_back(new block);
+	}
+
+	// First free slot of the block
+	unsigned b = m_free_blocks.back();
+	block& blk = *m_blocks[b];
+	unsigned i = 0;
+	while ((blk.m_live >> i) & 1)
+		++i;
+	blk.m_live |= uint64_t(1) << i;
+	if (blk.m_live == ~uint64_t(0))
+		m_free_blocks.pop_back();
+
+	T* comp = new (blk.get(i)) T;
+	comp->m_type_id = component_type_id<T>();
+	comp->m_pool_slot = b * s_block_size + i;
+	m_size++;
+	return comp;
+}
+
+template <typename T>
+void component_pool<T>::release(component* comp)
+{
+	unsigned b = comp->m_pool_slot / s_block_size;
+	unsigned i = comp->m_pool_slot % s_block_size;
+	block& blk = *m_blocks[b];
+	if (blk.m_live == ~uint64_t(0))
+		m_free_blocks.push_back(b);
+
+	static_cast<T*>(comp)->~T();
+	blk.m_live &= ~(uint64_t(1) << i);
+	m_size--;
+}
+
+template <typename T>
+template <typename F>
+void component_pool<T>::for_each(F f)
+{
+	// Components created or released by f are seen by the rest of the loop
+	for (size_t b = 0; b < m_blocks.size(); ++b)
+	{
+		block& blk = *m_blocks[b];
+		for (unsigned i = 0; i < s_block_size && (blk.m_live >> i) != 0; ++i)
+		{
+			if (((blk.m_live >> i) & 1) && blk.get(i)->in_scene())
+				f(*blk.get(i));
+		}
+	}
+}
+
+template <typename T>
+void component_pool<T>::update_all()
+{
+	// Types that keep the empty update of the base have nothing to do
+	if (std::is_same<decltype(&T::update), void (component::*)()>::value)
+		return;
+
+	// Called without the virtual dispatch
+	for_each([](T& comp) { comp.T::update(); });
+}
+}
@@ -0,0 +1,174 @@
+/**
+* @file compression.cpp
+* @date 2026/10/17
+*/
+#include "compression.h"
+
+namespace cs460 {
+void pack_quat(const glm::quat& q, uint16_t out[3])
+{
+	const float scale = 1.41421356f / 32767.0f;
+	const float offset = 0.70710678f;
+
+	glm::quat n = glm::normalize(q);
+	float v[4] = { n.x, n.y, n.z, n.w };
+
+	// Find the largest component
+	unsigned largest = 0;
+	for (unsigned i = 1; i < 4; ++i)
+	{
+		if (glm::abs(v[i]) > glm::abs(v[largest]))
+			largest = i;
+	}
+
+	// q and -q are the same rotation, keep the largest component positive
+	float sign = v[largest] < 0.0f ? -1.0f : 1.0f;
+
+	// Quantize the other three (they are in [-1/sqrt(2), 1/sqrt(2)])
+	uint64_t bits = (uint64_t)largest << 45;
+	for (unsigned i = 0, j = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+		float u = glm::clamp((v[i] * sign + offset) / scale, 0.0f, 32767.0f);
+		bits |= (uint64_t)glm::round(u) << (30 - 15 * j);
+		++j;
+	}
+
+	out[0] = (uint16_t)(bits >> 32);
+	out[1] = (uint16_t)(bits >> 16);
+	out[2] = (uint16_t)bits;
+}
+
+void compress_sampler(animation::sampler& sp, bool rotation)
+{
+	size_t n_keys = sp.m_input.size();
+	size_t n_comps = rotation ? 4 : 3;
+	if (sp.m_quantized || sp.m_lerp_mode == animation::sampler::lerp_mode::cubic)
+		return;
+	if (n_keys == 0 || sp.m_output.size() != n_keys * n_comps)
+		return;
+
+	sp.m_packed.resize(n_keys * 3);
+	const float* data = sp.m_output.data();
+
+	if (rotation)
+	{
+		for (size_t k = 0; k < n_keys; ++k)
+		{
+			const float* o = data + k * 4;
+			pack_quat(glm::quat(o[3], o[0], o[1], o[2]), &sp.m_packed[k * 3]);
+		}
+	}
+	else
+	{
+		// Range of the track
+		glm::vec3 min_v(data[0], data[1], data[2]);
+		glm::vec3 max_v = min_v;
+		for (size_t k = 1; k < n_keys; ++k)
+		{
+			glm::vec3 v(data[k * 3], data[k * 3 + 1], data[k * 3 + 2]);
+			min_v = glm::min(min_v, v);
+			max_v = glm::max(max_v, v);
+		}
+		glm::vec3 extent = max_v - min_v;
+		sp.m_range_min = min_v;
+		sp.m_range_scale = extent / 65535.0f;
+
+		// Quantize each component to 16 bits inside the range
+		for (size_t k = 0; k < n_keys; ++k)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				float u = extent[c] > 0.0f ? (data[k * 3 + c] - min_v[c]) / extent[c] * 65535.0f : 0.0f;
+				sp.m_packed[k * 3 + c] = (uint16_t)glm::round(glm::clamp(u, 0.0f, 65535.0f));
+			}
+		}
+	}
+
+	// Free the raw keys
+	sp.m_quantized = true;
+	sp.m_output.clear();
+	sp.m_output.shrink_to_fit();
+}
+
+std::vector<float> compute_bone_lengths(const std::vector<float>& offsets, const std::vector<std::vector<int>>& children)
+{
+	size_t n_nodes = offsets.size();
+	std::vector<float> lengths(n_nodes, 0.0f);
+	for (size_t i = 0; i < n_nodes && i < children.size(); ++i)
+	{
+		for (int child : children[i])
+			lengths[i] = glm::max(lengths[i], offsets[child]);
+
+		if (lengths[i] == 0.0f)
+			lengths[i] = offsets[i];
+	}
+	return lengths;
+}
+
+compression_stats compress_animation(animation& anim, const std::vector<float>& bone_lengths)
+{
+	typedef animation::channel::path_type path_type;
+	compression_stats stats;
+
+	// Keep the raw tracks to measure the error
+	const std::vector<animation::sampler> raw = anim.m_samplers;
+	std::vector<bool> compressed(raw.size(), false);
+
+	for (const auto& ch : anim.m_chanels)
+	{
+		if (ch.m_path_type == path_type::weights || compressed[ch.m_sampler])
+			continue;
+
+		// Tracks quantized at import have no raw keys left to compare against
+		animation::sampler& sp = anim.m_samplers[ch.m_sampler];
+		if (sp.m_quantized)
+			continue;
+		bool rotation = ch.m_path_type == path_type::rotation;
+		compress_sampler(sp, rotation);
+		if (!sp.m_quantized)
+			continue;
+
+		compressed[ch.m_sampler] = true;
+		stats.m_raw_bytes += raw[ch.m_sampler].m_output.size() * sizeof(float);
+		stats.m_packed_bytes += sp.m_packed.size() * sizeof(uint16_t) + (rotation ? 0 : 2 * sizeof(glm::vec3));
+	}
+
+	// Measure the error at the keys and between them
+	for (const auto& ch : anim.m_chanels)
+	{
+		if (!compressed[ch.m_sampler])
+			continue;
+
+		const animation::sampler& ref = raw[ch.m_sampler];
+		const animation::sampler& sp = anim.m_samplers[ch.m_sampler];
+		float length = ch.m_node >= 0 && ch.m_node < (int)bone_lengths.size() ? bone_lengths[ch.m_node] : 0.0f;
+
+		size_t n_keys = ref.m_input.size();
+		for (size_t k = 0; k < n_keys; ++k)
+		{
+			float times[2] = { ref.m_input[k], k + 1 < n_keys ? 0.5f * (ref.m_input[k] + ref.m_input[k + 1]) : ref.m_input[k] };
+			for (float t : times)
+			{
+				if (ch.m_path_type == path_type::rotation)
+				{
+					glm::quat q0 = ch.lerp_rot(t, ref, true);
+					glm::quat q1 = ch.lerp_rot(t, sp, true);
+					float angle = quat_angle(q0, q1);
+					stats.m_max_rotation = glm::max(stats.m_max_rotation, glm::degrees(angle));
+					stats.m_max_bone = glm::max(stats.m_max_bone, 2.0f * glm::sin(0.5f * angle) * length);
+				}
+				else
+				{
+					float error = glm::length(ch.lerp_pos(t, ref) - ch.lerp_pos(t, sp));
+					float& max_error = ch.m_path_type == path_type::translation ? stats.m_max_translation : stats.m_max_scale;
+					max_error = glm::max(max_error, error);
+				}
+			}
+		}
+	}
+
+	return stats;
+}
+}
@@ -0,0 +1,73 @@
+/**
+* @file compression.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "resources.h"
+
+namespace cs460 {
+// Packs a unit quaternion in 48 bits: index of the largest component (2 bits)
+// followed by the other three components quantized to 15 bits each
+void pack_quat(const glm::quat& q, uint16_t out[3]);
+
+inline glm::quat unpack_quat(const uint16_t in[3])
+{
+	const float scale = 1.41421356f / 32767.0f;
+	const float offset = 0.70710678f;
+
+	uint64_t bits = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 16) | in[2];
+	unsigned largest = (unsigned)(bits >> 45) & 3;
+
+	// Decode the three smallest components
+	float v[4];
+	float sum = 0.0f;
+	for (unsigned i = 0, j = 0; i < 4; ++i)
+	{
+		if (i == largest)
+			continue;
+		v[i] = (float)((bits >> (30 - 15 * j)) & 0x7fff) * scale - offset;
+		sum += v[i] * v[i];
+		++j;
+	}
+
+	// The largest one is positive and completes the unit length
+	v[largest] = glm::sqrt(glm::max(1.0f - sum, 0.0f));
+	return glm::quat(v[3], v[0], v[1], v[2]);
+}
+
+// Angle between two rotations in radians (accurate for tiny angles, unlike acos of the dot)
+inline float quat_angle(const glm::quat& a, const glm::quat& b)
+{
+	glm::quat d = glm::dot(a, b) < 0.0f ? b + a : b - a;
+	float chord = glm::sqrt(glm::dot(d, d));
+	return 4.0f * glm::asin(glm::min(0.5f * chord, 1.0f));
+}
+
+// Error of a compressed clip
+struct compression_stats
+{
+	size_t m_raw_bytes = 0;
+	size_t m_packed_bytes = 0;
+	float m_max_translation = 0.0f;	// Distance
+	float m_max_rotation = 0.0f;	// Angle in degrees
+	float m_max_bone = 0.0f;		// Displacement of the bone tip due to the rotation error
+	float m_max_scale = 0.0f;
+
+	float ratio() const { return m_packed_bytes ? (float)m_raw_bytes / m_packed_bytes : 1.0f; }
+};
+
+// Quantizes the output of a sampler in place (3 x 16 bits per key)
+void compress_sampler(animation::sampler& sp, bool rotation);
+
+// Length of each bone from the rest offset of each node to its parent and the children of
+// each node: the longest offset to a child, or the node's own offset for leaves
+std::vector<float> compute_bone_lengths(const std::vector<float>& offsets, const std::vector<std::vector<int>>& children);
+
+// Compresses the T, R, S tracks of an animation. The rotation error is also measured
+// at the tip of each bone, given the bone lengths indexed by node
+compression_stats compress_animation(animation& anim, const std::vector<float>& bone_lengths);
+}
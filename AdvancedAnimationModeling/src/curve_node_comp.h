@@ -11,7 +11,6 @@ namespace cs460 {
 struct curve_node_comp : public component
 {
 	virtual void initialize() {}
-	virtual void update() {}
 	virtual void imgui() {}
 private:
 };
@@ -123,6 +123,8 @@ public:
 	void set_follower(node* follower);
 
 private:
+	// The pool calls update without the virtual dispatch
+	template <typename T> friend class component_pool;
 	virtual void update();
 	virtual void imgui();
 	void render_curve_points();
@@ -155,6 +157,7 @@ public:
 	void add_point(const glm::vec3& pos);
 
 private:
+	template <typename T> friend class component_pool;
 	virtual void update();
 	virtual void imgui();
 	void render_curve();
@@ -173,6 +176,7 @@ private:
 	float get_segment_points(float t, const glm::vec3** p0, glm::vec3* t0, const glm::vec3** p1, glm::vec3* t1) const;
 	struct tangent { node* m_t1 = nullptr; node* m_t2 = nullptr; };
 	std::vector<tangent> m_tangents;
+	template <typename T> friend class component_pool;
 	virtual void update();
 	virtual void imgui();
 	void render_curve();
@@ -190,6 +194,7 @@ public:
 private:
 	float get_segment_points(float t, const glm::vec3** p0, const glm::vec3** t0, const glm::vec3** p1, const glm::vec3** t1) const;
 	std::vector<glm::vec3> m_tangents;
+	template <typename T> friend class component_pool;
 	virtual void update();
 	virtual void imgui();
 	void render_curve();
@@ -209,6 +214,7 @@ private:
 	float get_segment_points(float t, const glm::vec3** p0, const glm::vec3** p1, const glm::vec3** p2, const glm::vec3** p3) const;
 	struct control_point { node* m_c1 = nullptr; node* m_c2 = nullptr; };
 	std::vector<control_point> m_control_points;
+	template <typename T> friend class component_pool;
 	virtual void update();
 	virtual void imgui();
 	void render_curve();
@@ -22,6 +22,9 @@
 #include "debug.h"
 #include "curve_node_comp.h"
 #include "anim_comp.h"
+#include "benchmark.h"
+#include "animation_system.h"
+#include "pose_cache.h"
 
 namespace cs460 {
 editor::editor()
@@ -85,9 +88,9 @@ bool editor::render_guizmo()
         if (m_selected_node->m_parent)
         {
             // Get node and parent transforms
-            transform& node_local = m_selected_node->m_local;
-            transform& node_world = m_selected_node->m_world;
-            transform& parent_world = m_selected_node->m_parent->m_world;
+            transform_handle& node_local = m_selected_node->m_local;
+            transform_handle& node_world = m_selected_node->m_world;
+            transform_handle& parent_world = m_selected_node->m_parent->m_world;
 
             // Decompose matrix and set it as the new node world
             node_world.set_transform(m2w);
@@ -151,6 +154,25 @@ void editor::load_gltf_files()
             ImGui::EndMenu();
         }
 
+        if (ImGui::BeginMenu("Import Options"))
+        {
+            // Processing of the animations of the next imported models
+            import_options& options = get_import_options();
+            ImGui::MenuItem("Resample Clips", nullptr, &options.m_resample);
+            if (ImGui::MenuItem("30 Hz", nullptr, options.m_sample_rate == 30.0f, options.m_resample))
+                options.m_sample_rate = 30.0f;
+            if (ImGui::MenuItem("60 Hz", nullptr, options.m_sample_rate == 60.0f, options.m_resample))
+                options.m_sample_rate = 60.0f;
+            ImGui::Separator();
+            ImGui::MenuItem("Decimate Clips", nullptr, &options.m_decimate);
+            ImGui::DragFloat("Position Tolerance", &options.m_position_tolerance, 0.0001f, 0.0f, 1.0f, "%.4f");
+            ImGui::DragFloat("Angle Tolerance", &options.m_angle_tolerance, 0.01f, 0.0f, 10.0f, "%.2f deg");
+            ImGui::Separator();
+            ImGui::MenuItem("Compress Clips", nullptr, &options.m_compress);
+
+            ImGui::EndMenu();
+        }
+
         ImGui::EndMenu();
     }
 
@@ -236,7 +258,7 @@ void editor::picking()
     const glm::vec3& origin = g_scene.get_camera().get_pos();
 
     float t_min = -1;
-    raycast_rec(g_scene.get_root(), origin, ray, &t_min);
+    raycast(origin, ray, &t_min);
     
     if (t_min < 0.0f)
         m_selected_node = nullptr;
@@ -404,38 +426,35 @@ void editor::render_scene_graph_rec(node* node, bool opened)
     }
 }
 
-void editor::raycast_rec(node* node, const glm::vec3& origin, const glm::vec3& dir, float* t_min)
+void editor::raycast(const glm::vec3& origin, const glm::vec3& dir, float* t_min)
 {
-    // Get the number of childs
-    size_t n_childs = node->m_children.size();
-
-    if (mesh_comp* m = node->get_component<mesh_comp>())
-    {
+    // Meshes
+    component_pool<mesh_comp>::get_instance().for_each([&](mesh_comp& m) {
         glm::vec3 min, max;
-        m->get_vb_min_max(min, max);
+        m.get_vb_min_max(min, max);
         float t = ray_vs_aabb(origin, dir, min, max);
         if (t >= 0 && (t < *t_min || *t_min < 0.0f))
         {
-            m_selected_node = node;
+            m_selected_node = m.get_owner();
             *t_min = t;
         }
-    }
+    });
+
+    // Curve control points
+    component_pool<curve_node_comp>::get_instance().for_each([&](curve_node_comp& c) {
+        node* n = c.get_owner();
+        if (n->get_component<mesh_comp>())
+            return;
 
-    else if (node->get_component<curve_node_comp>())
-    {
         glm::vec3 offset(0.05f);
-        const glm::vec3& pos = node->m_world.get_position();
+        const glm::vec3& pos = n->m_world.get_position();
         float t = ray_vs_aabb(origin, dir, pos - offset, pos + offset);
         if (t >= 0 && (t < *t_min || *t_min < 0.0f))
         {
-            m_selected_node = node;
+            m_selected_node = n;
             *t_min = t;
         }
-    }
-
-    // Raycast each child
-    for (unsigned int i = 0; i < n_childs; ++i)
-        raycast_rec(node->m_children[i], origin, dir, t_min);
+    });
 }
 
 void editor::render_scene_graph()
@@ -489,6 +508,15 @@ void editor::render()
 
     // Render settings
     g_renderer.imgui();
+
+    // Benchmarks
+    g_benchmark.imgui();
+
+    // Animation level of detail
+    g_animation_system.imgui();
+
+    // Shared pose cache
+    g_pose_cache.imgui();
     
     if (st == scene_graph::scene_type::curves)
         curve_creator();
@@ -26,7 +26,7 @@ private:
 	editor();
 	void render_scene_graph();
 	void render_scene_graph_rec(node* node, bool opened = false);
-	void raycast_rec(node* node, const glm::vec3& origin, const glm::vec3& dir, float* t_min);
+	void raycast(const glm::vec3& origin, const glm::vec3& dir, float* t_min);
 	void imgui_render_frame();
 	void imgui_new_frame();
 	void render_inspector();
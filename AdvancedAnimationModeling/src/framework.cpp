@@ -16,6 +16,7 @@
 #include "renderer.h"
 #include "resources.h"
 #include "debug.h"
+#include "job_system.h"
 
 namespace cs460 {
 void framework::create()
@@ -65,5 +66,8 @@ void framework::destroy()
 	g_resources.destroy();
 	g_renderer.destroy();
 	g_scene.destroy();
+
+	// Join the worker threads
+	g_jobs.set_thread_count(1);
 }
 }
\ No newline at end of file
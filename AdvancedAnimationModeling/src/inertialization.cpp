@@ -0,0 +1,315 @@
+/**
+* @file inertialization.cpp
+* @date 2026/10/17
+*/
+#include "inertialization.h"
+
+namespace cs460 {
+// Rotation vector (axis times angle) of a quaternion, the short way around
+static glm::vec3 rotation_vector(glm::quat q)
+{
+	if (q.w < 0.0f)
+		q = -q;
+	glm::vec3 v(q.x, q.y, q.z);
+	float s = glm::length(v);
+	if (s < 1e-7f)
+		return v * 2.0f;
+	return v * (2.0f * glm::atan(s, q.w) / s);
+}
+
+void inertializer::begin(const dense_pose& prev, const dense_pose& current, float dt, float blend_time)
+{
+	m_blend_time = blend_time;
+	m_time = 0.0f;
+	if (blend_time <= 0.0f || current.size() == 0)
+	{
+		m_state = idle;
+		return;
+	}
+
+	// Velocities of the channels valid in both poses
+	unsigned n_joints = current.size();
+	m_source = current;
+	m_linear.assign(n_joints, glm::vec3(0.0f));
+	m_angular.assign(n_joints, glm::vec3(0.0f));
+	m_scaling.assign(n_joints, glm::vec3(0.0f));
+	if (prev.size() == n_joints && dt > 0.0f)
+	{
+		float inv_dt = 1.0f / dt;
+		for (unsigned j = 0; j < n_joints; ++j)
+		{
+			unsigned char flags = current.get_flags(j) & prev.get_flags(j);
+			if ((flags & translation) != 0)
+				m_linear[j] = (current.get_position(j) - prev.get_position(j)) * inv_dt;
+			// The rotation between two frames is small, its angle is close to twice the sine of the half angle
+			if ((flags & rotation) != 0)
+			{
+				glm::quat q = current.get_rotation(j) * glm::conjugate(prev.get_rotation(j));
+				m_angular[j] = glm::vec3(q.x, q.y, q.z) * (q.w < 0.0f ? -2.0f * inv_dt : 2.0f * inv_dt);
+			}
+			if ((flags & scale) != 0)
+				m_scaling[j] = (current.get_scale(j) - prev.get_scale(j)) * inv_dt;
+		}
+	}
+	m_state = recorded;
+}
+
+void inertializer::start(const dense_pose& target)
+{
+	unsigned n_joints = glm::min(target.size(), m_source.size());
+	m_stride = (n_joints + 7) & ~7u;
+	for (auto& o : m_offsets)
+	{
+		for (auto& d : o.m_dir)
+			d.assign(m_stride, 0.0f);
+		for (auto& a : o.m_coefs)
+			a.assign(m_stride, 0.0f);
+		o.m_end.assign(m_stride, 0.0f);
+		o.m_any = false;
+	}
+
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		unsigned char flags = target.get_flags(j) & m_source.get_flags(j);
+		for (int ch = 0; ch < 3; ++ch)
+		{
+			if ((flags & (1 << ch)) == 0)
+				continue;
+
+			// Rotation offsets are taken so that source = offset * target
+			glm::vec3 offset, velocity;
+			if (ch == 0)
+			{
+				offset = m_source.get_position(j) - target.get_position(j);
+				velocity = m_linear[j];
+			}
+			else if (ch == 1)
+			{
+				offset = rotation_vector(m_source.get_rotation(j) * glm::conjugate(target.get_rotation(j)));
+				velocity = m_angular[j];
+			}
+			else
+			{
+				offset = m_source.get_scale(j) - target.get_scale(j);
+				velocity = m_scaling[j];
+			}
+
+			// Only the velocity along the offset decays with it
+			float x0 = glm::length(offset);
+			if (x0 <= 1e-6f)
+				continue;
+			channel_offsets& o = m_offsets[ch];
+			glm::vec3 dir = offset / x0;
+			for (int c = 0; c < 3; ++c)
+				o.m_dir[c][j] = dir[c];
+			fit(x0, glm::dot(velocity, dir), o, j);
+			o.m_any = true;
+		}
+	}
+	m_state = running;
+}
+
+void inertializer::fit(float x0, float v0, channel_offsets& o, unsigned j) const
+{
+	// The offset only moves towards zero, and stops early if it would overshoot
+	v0 = glm::min(v0, 0.0f);
+	float t1 = m_blend_time;
+	if (v0 < 0.0f)
+		t1 = glm::min(t1, -5.0f * x0 / v0);
+
+	float t2 = t1 * t1;
+	float t3 = t2 * t1;
+	float a0 = glm::max((-8.0f * v0 * t1 - 20.0f * x0) / t2, 0.0f);
+	o.m_end[j] = t1;
+	o.m_coefs[0][j] = x0;
+	o.m_coefs[1][j] = v0;
+	o.m_coefs[2][j] = 0.5f * a0;
+	o.m_coefs[3][j] = -(3.0f * a0 * t2 + 12.0f * v0 * t1 + 20.0f * x0) / (2.0f * t3);
+	o.m_coefs[4][j] = (3.0f * a0 * t2 + 16.0f * v0 * t1 + 30.0f * x0) / (2.0f * t3 * t1);
+	o.m_coefs[5][j] = -(a0 * t2 + 6.0f * v0 * t1 + 12.0f * x0) / (2.0f * t3 * t2);
+}
+
+// Arrays of one channel handed to the kernels
+struct offset_arrays
+{
+	const float* m_dir[3];
+	const float* m_coefs[6];
+	const float* m_end;
+	float* m_out[4];		// x, y, z (w) components of the pose
+	bool m_rotation;
+};
+
+// Offsets are at most half a turn, so the sin and cos of the half angle are Taylor
+// series up to h^11 and h^10 (error below 5e-7 at h = pi/2). Offsets past their
+// end time are zero
+static void apply_offsets_scalar(const offset_arrays& o, float t, unsigned stride)
+{
+	for (unsigned j = 0; j < stride; ++j)
+	{
+		const float* const* a = o.m_coefs;
+		float v = a[0][j] + t * (a[1][j] + t * (a[2][j] + t * (a[3][j] + t * (a[4][j] + t * a[5][j]))));
+		float x = t < o.m_end[j] ? v : 0.0f;
+		if (!o.m_rotation)
+		{
+			for (int c = 0; c < 3; ++c)
+				o.m_out[c][j] += o.m_dir[c][j] * x;
+			continue;
+		}
+
+		// Rotation of the offset times the rotation of the pose
+		float h = 0.5f * x;
+		float h2 = h * h;
+		float s = h * (1.0f - h2 / 6.0f * (1.0f - h2 / 20.0f * (1.0f - h2 / 42.0f * (1.0f - h2 / 72.0f * (1.0f - h2 / 110.0f)))));
+		float c = 1.0f - h2 / 2.0f * (1.0f - h2 / 12.0f * (1.0f - h2 / 30.0f * (1.0f - h2 / 56.0f * (1.0f - h2 / 90.0f))));
+		float ox = o.m_dir[0][j] * s;
+		float oy = o.m_dir[1][j] * s;
+		float oz = o.m_dir[2][j] * s;
+
+		float px = o.m_out[0][j], py = o.m_out[1][j], pz = o.m_out[2][j], pw = o.m_out[3][j];
+		o.m_out[0][j] = c * px + pw * ox + oy * pz - oz * py;
+		o.m_out[1][j] = c * py + pw * oy + oz * px - ox * pz;
+		o.m_out[2][j] = c * pz + pw * oz + ox * py - oy * px;
+		o.m_out[3][j] = c * pw - ox * px - oy * py - oz * pz;
+	}
+}
+
+SIMD_TARGET_SSE4 static void apply_offsets_sse4(const offset_arrays& o, float t, unsigned stride)
+{
+#if defined(SIMD_X86)
+	__m128 vt = _mm_set1_ps(t);
+	__m128 one = _mm_set1_ps(1.0f);
+	for (unsigned j = 0; j < stride; j += 4)
+	{
+		__m128 v = _mm_load_ps(o.m_coefs[5] + j);
+		for (int k = 4; k >= 0; --k)
+			v = _mm_add_ps(_mm_load_ps(o.m_coefs[k] + j), _mm_mul_ps(vt, v));
+		__m128 x = _mm_and_ps(_mm_cmplt_ps(vt, _mm_load_ps(o.m_end + j)), v);
+		if (!o.m_rotation)
+		{
+			for (int c = 0; c < 3; ++c)
+				_mm_store_ps(o.m_out[c] + j, _mm_add_ps(_mm_load_ps(o.m_out[c] + j), _mm_mul_ps(_mm_load_ps(o.m_dir[c] + j), x)));
+			continue;
+		}
+
+		// Series of the sin and cos of the half angle, innermost term first
+		__m128 h = _mm_mul_ps(_mm_set1_ps(0.5f), x);
+		__m128 h2 = _mm_mul_ps(h, h);
+		const float sin_div[] = { 110.0f, 72.0f, 42.0f, 20.0f, 6.0f };
+		const float cos_div[] = { 90.0f, 56.0f, 30.0f, 12.0f, 2.0f };
+		__m128 s = one;
+		for (float d : sin_div)
+			s = _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(h2, _mm_set1_ps(1.0f / d)), s));
+		s = _mm_mul_ps(h, s);
+		__m128 c = one;
+		for (float d : cos_div)
+			c = _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(h2, _mm_set1_ps(1.0f / d)), c));
+
+		__m128 ox = _mm_mul_ps(_mm_load_ps(o.m_dir[0] + j), s);
+		__m128 oy = _mm_mul_ps(_mm_load_ps(o.m_dir[1] + j), s);
+		__m128 oz = _mm_mul_ps(_mm_load_ps(o.m_dir[2] + j), s);
+		__m128 px = _mm_load_ps(o.m_out[0] + j);
+		__m128 py = _mm_load_ps(o.m_out[1] + j);
+		__m128 pz = _mm_load_ps(o.m_out[2] + j);
+		__m128 pw = _mm_load_ps(o.m_out[3] + j);
+		_mm_store_ps(o.m_out[0] + j, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c, px), _mm_mul_ps(pw, ox)), _mm_sub_ps(_mm_mul_ps(oy, pz), _mm_mul_ps(oz, py))));
+		_mm_store_ps(o.m_out[1] + j, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c, py), _mm_mul_ps(pw, oy)), _mm_sub_ps(_mm_mul_ps(oz, px), _mm_mul_ps(ox, pz))));
+		_mm_store_ps(o.m_out[2] + j, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c, pz), _mm_mul_ps(pw, oz)), _mm_sub_ps(_mm_mul_ps(ox, py), _mm_mul_ps(oy, px))));
+		_mm_store_ps(o.m_out[3] + j, _mm_sub_ps(_mm_mul_ps(c, pw), _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, px), _mm_mul_ps(oy, py)), _mm_mul_ps(oz, pz))));
+	}
+#else
+	apply_offsets_scalar(o, t, stride);
+#endif
+}
+
+SIMD_TARGET_AVX2 static void apply_offsets_avx2(const offset_arrays& o, float t, unsigned stride)
+{
+#if defined(SIMD_X86)
+	__m256 vt = _mm256_set1_ps(t);
+	__m256 one = _mm256_set1_ps(1.0f);
+	for (unsigned j = 0; j < stride; j += 8)
+	{
+		__m256 v = _mm256_load_ps(o.m_coefs[5] + j);
+		for (int k = 4; k >= 0; --k)
+			v = _mm256_fmadd_ps(vt, v, _mm256_load_ps(o.m_coefs[k] + j));
+		__m256 x = _mm256_and_ps(_mm256_cmp_ps(vt, _mm256_load_ps(o.m_end + j), _CMP_LT_OQ), v);
+		if (!o.m_rotation)
+		{
+			for (int c = 0; c < 3; ++c)
+				_mm256_store_ps(o.m_out[c] + j, _mm256_fmadd_ps(_mm256_load_ps(o.m_dir[c] + j), x, _mm256_load_ps(o.m_out[c] + j)));
+			continue;
+		}
+
+		// Series of the sin and cos of the half angle, innermost term first
+		__m256 h = _mm256_mul_ps(_mm256_set1_ps(0.5f), x);
+		__m256 h2 = _mm256_mul_ps(h, h);
+		const float sin_div[] = { 110.0f, 72.0f, 42.0f, 20.0f, 6.0f };
+		const float cos_div[] = { 90.0f, 56.0f, 30.0f, 12.0f, 2.0f };
+		__m256 s = one;
+		for (float d : sin_div)
+			s = _mm256_fnmadd_ps(_mm256_mul_ps(h2, _mm256_set1_ps(1.0f / d)), s, one);
+		s = _mm256_mul_ps(h, s);
+		__m256 c = one;
+		for (float d : cos_div)
+			c = _mm256_fnmadd_ps(_mm256_mul_ps(h2, _mm256_set1_ps(1.0f / d)), c, one);
+
+		__m256 ox = _mm256_mul_ps(_mm256_load_ps(o.m_dir[0] + j), s);
+		__m256 oy = _mm256_mul_ps(_mm256_load_ps(o.m_dir[1] + j), s);
+		__m256 oz = _mm256_mul_ps(_mm256_load_ps(o.m_dir[2] + j), s);
+		__m256 px = _mm256_load_ps(o.m_out[0] + j);
+		__m256 py = _mm256_load_ps(o.m_out[1] + j);
+		__m256 pz = _mm256_load_ps(o.m_out[2] + j);
+		__m256 pw = _mm256_load_ps(o.m_out[3] + j);
+		_mm256_store_ps(o.m_out[0] + j, _mm256_fmadd_ps(c, px, _mm256_fmadd_ps(pw, ox, _mm256_fmsub_ps(oy, pz, _mm256_mul_ps(oz, py)))));
+		_mm256_store_ps(o.m_out[1] + j, _mm256_fmadd_ps(c, py, _mm256_fmadd_ps(pw, oy, _mm256_fmsub_ps(oz, px, _mm256_mul_ps(ox, pz)))));
+		_mm256_store_ps(o.m_out[2] + j, _mm256_fmadd_ps(c, pz, _mm256_fmadd_ps(pw, oz, _mm256_fmsub_ps(ox, py, _mm256_mul_ps(oy, px)))));
+		_mm256_store_ps(o.m_out[3] + j, _mm256_fmsub_ps(c, pw, _mm256_fmadd_ps(ox, px, _mm256_fmadd_ps(oy, py, _mm256_mul_ps(oz, pz)))));
+	}
+#else
+	apply_offsets_scalar(o, t, stride);
+#endif
+}
+
+void inertializer::apply(dense_pose& pose, float dt)
+{
+	if (m_state == idle)
+		return;
+	if (m_state == recorded)
+		start(pose);
+
+	// The first frame shows the source moved forward by dt
+	m_time += dt;
+	if (m_time >= m_blend_time)
+	{
+		m_state = idle;
+		return;
+	}
+
+	// Joints the pose does not have get offsets too, they stay invalid
+	const unsigned stride = glm::min(m_stride, pose.stride());
+	const int first[] = { dense_pose::tx, dense_pose::qx, dense_pose::sx };
+	simd_level level = get_simd_level();
+	for (int ch = 0; ch < 3; ++ch)
+	{
+		const channel_offsets& offsets = m_offsets[ch];
+		if (!offsets.m_any)
+			continue;
+
+		offset_arrays o;
+		for (int c = 0; c < 3; ++c)
+			o.m_dir[c] = offsets.m_dir[c].data();
+		for (int k = 0; k < 6; ++k)
+			o.m_coefs[k] = offsets.m_coefs[k].data();
+		o.m_end = offsets.m_end.data();
+		o.m_rotation = ch == 1;
+		for (int c = 0; c < (o.m_rotation ? 4 : 3); ++c)
+			o.m_out[c] = pose.m_data[first[ch] + c].data();
+
+		if (level == simd_level::avx2)
+			apply_offsets_avx2(o, m_time, stride);
+		else if (level == simd_level::sse4)
+			apply_offsets_sse4(o, m_time, stride);
+		else
+			apply_offsets_scalar(o, m_time, stride);
+	}
+}
+}
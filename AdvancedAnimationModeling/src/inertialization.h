@@ -0,0 +1,67 @@
+/**
+* @file inertialization.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include "pose.h"
+
+namespace cs460 {
+// Smooths the switch to a new clip or blend tree without sampling the old one.
+// When the switch happens, it records how far the last pose shown is from the
+// first pose of the destination and how fast it was moving, per joint and
+// channel. The offset is then added to the destination and decays to zero
+// with a quintic polynomial over the blend time, which starts at the offset
+// with its velocity and ends with zero velocity and acceleration
+class inertializer
+{
+public:
+	// Records the last two poses shown before the switch, dt seconds apart. The
+	// offsets are taken from the first pose given to apply
+	void begin(const dense_pose& prev, const dense_pose& current, float dt, float blend_time);
+
+	// Advances dt seconds and adds the remaining offsets to the pose of the destination
+	void apply(dense_pose& pose, float dt);
+
+	// A transition is in progress
+	bool active() const { return m_state != idle; }
+	void stop() { m_state = idle; }
+
+	float elapsed() const { return m_time; }
+	float blend_time() const { return m_blend_time; }
+
+private:
+	// Offsets of one channel (translation, rotation or scale) as arrays indexed by
+	// joint. Translation and scale move along a direction, rotation turns around
+	// an axis. Joints without an offset have zero coefficients, so every joint is
+	// processed the same way
+	struct channel_offsets
+	{
+		float_array m_dir[3];
+		float_array m_coefs[6];	// Polynomial of the length, constant first
+		float_array m_end;		// Time where the length reaches zero
+		bool m_any = false;
+	};
+
+	// Fits the polynomial of joint j to an offset of length x0 with velocity v0 along it
+	void fit(float x0, float v0, channel_offsets& offsets, unsigned j) const;
+
+	// Computes the offsets from the recorded poses to the destination
+	void start(const dense_pose& target);
+
+	enum state { idle, recorded, running };
+	state m_state = idle;
+
+	float m_time = 0.0f;
+	float m_blend_time = 0.0f;
+
+	// Last pose shown and its velocity per channel until the offsets are computed
+	dense_pose m_source;
+	std::vector<glm::vec3> m_linear;
+	std::vector<glm::vec3> m_angular;
+	std::vector<glm::vec3> m_scaling;
+
+	channel_offsets m_offsets[3];
+	unsigned m_stride = 0;
+};
+}
@@ -0,0 +1,233 @@
+/**
+* @file job_system.cpp
+* @date 2026/10/17
+*/
+#include "job_system.h"
+#include <algorithm>
+
+namespace cs460 {
+// Queue owned by the calling thread (0 for the main thread)
+static thread_local unsigned t_queue = 0;
+
+job_system& job_system::get_instance()
+{
+	static job_system j;
+	return j;
+}
+
+job_system::job_system() : m_quit(false), m_queued(0)
+{
+	m_queues.emplace_back(new job_queue);
+
+	// Leave a core for the rest of the system
+	unsigned n_cores = std::thread::hardware_concurrency();
+	set_thread_count(n_cores > 1 ? std::min(n_cores - 1, 16u) : 1u);
+}
+
+job_system::~job_system()
+{
+	stop_workers();
+}
+
+void job_system::set_thread_count(unsigned n_threads)
+{
+	n_threads = std::max(n_threads, 1u);
+	if (n_threads == thread_count())
+		return;
+
+	stop_workers();
+
+	// One queue per thread
+	m_queues.resize(n_threads);
+	for (auto& q : m_queues)
+	{
+		if (!q)
+			q.reset(new job_queue);
+	}
+
+	m_quit = false;
+	for (unsigned i = 1; i < n_threads; ++i)
+		m_workers.emplace_back(&job_system::worker_loop, this, i);
+}
+
+void job_system::stop_workers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& w : m_workers)
+		w.join();
+	m_workers.clear();
+}
+
+void job_system::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+	if (count == 0)
+		return;
+	grain = std::max(grain, (size_t)1);
+
+	// Nothing to split
+	size_t n_chunks = (count + grain - 1) / grain;
+	if (n_chunks == 1 || m_workers.empty())
+	{
+		for (size_t begin = 0; begin < count; begin += grain)
+			fn(begin, std::min(begin + grain, count));
+		return;
+	}
+
+	// Queue every chunk but the first one, which runs here
+	std::atomic<int> counter((int)n_chunks - 1);
+	for (size_t c = 1; c < n_chunks; ++c)
+	{
+		size_t begin = c * grain;
+		size_t end = std::min(begin + grain, count);
+		submit([&fn, begin, end]() { fn(begin, end); }, &counter);
+	}
+
+	fn(0, std::min(grain, count));
+	wait(counter);
+}
+
+void job_system::submit(std::function<void()> fn, std::atomic<int>* counter)
+{
+	job_queue& q = *m_queues[t_queue];
+	{
+		std::lock_guard<std::mutex> lock(q.m_mutex);
+		q.m_jobs.push_back({ std::move(fn), counter });
+	}
+
+	// Wake a sleeping worker
+	{
+		std::lock_guard<std::mutex> lock(m_sleep_mutex);
+		++m_queued;
+	}
+	m_wake.notify_one();
+}
+
+void job_system::wait(const std::atomic<int>& counter)
+{
+	// Help with the queued jobs instead of blocking
+	job j;
+	while (counter.load() > 0)
+	{
+		if (get_job(t_queue, j))
+			run_job(j);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool job_system::get_job(unsigned queue, job& j)
+{
+	// Newest job of the own queue first, it is the most likely to be in cache
+	{
+		job_queue& q = *m_queues[queue];
+		std::lock_guard<std::mutex> lock(q.m_mutex);
+		if (!q.m_jobs.empty())
+		{
+			j = std::move(q.m_jobs.back());
+			q.m_jobs.pop_back();
+			--m_queued;
+			return true;
+		}
+	}
+
+	// Steal the oldest job of another queue
+	unsigned n_queues = (unsigned)m_queues.size();
+	for (unsigned i = 1; i < n_queues; ++i)
+	{
+		job_queue& q = *m_queues[(queue + i) % n_queues];
+		std::lock_guard<std::mutex> lock(q.m_mutex);
+		if (!q.m_jobs.empty())
+		{
+			j = std::move(q.m_jobs.front());
+			q.m_jobs.pop_front();
+			--m_queued;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void job_system::run_job(job& j)
+{
+	j.m_fn();
+	if (j.m_counter)
+		--(*j.m_counter);
+}
+
+void job_system::worker_loop(unsigned queue)
+{
+	t_queue = queue;
+
+	job j;
+	while (true)
+	{
+		if (get_job(queue, j))
+		{
+			run_job(j);
+			continue;
+		}
+
+		// Sleep until there is work
+		std::unique_lock<std::mutex> lock(m_sleep_mutex);
+		m_wake.wait(lock, [this]() { return m_quit || m_queued > 0; });
+		if (m_quit)
+			return;
+	}
+}
+
+int task_graph::add(std::function<void()> fn, const std::vector<int>& dependencies)
+{
+	int id = (int)m_tasks.size();
+	m_tasks.emplace_back(new task);
+	task& t = *m_tasks.back();
+	t.m_fn = std::move(fn);
+	t.m_n_dependencies = (int)dependencies.size();
+
+	// Dependencies must be added before
+	for (int d : dependencies)
+		m_tasks[d]->m_next.push_back(id);
+
+	return id;
+}
+
+void task_graph::run()
+{
+	if (m_tasks.empty())
+		return;
+
+	for (auto& t : m_tasks)
+		t->m_remaining = t->m_n_dependencies;
+
+	// Queue the tasks that are ready, the rest are queued by their dependencies
+	std::atomic<int> counter((int)m_tasks.size());
+	int n_tasks = (int)m_tasks.size();
+	for (int i = 0; i < n_tasks; ++i)
+	{
+		if (m_tasks[i]->m_n_dependencies == 0)
+			submit(i, &counter);
+	}
+
+	g_jobs.wait(counter);
+}
+
+void task_graph::submit(int id, std::atomic<int>* counter)
+{
+	g_jobs.submit([this, id, counter]() {
+		task& t = *m_tasks[id];
+		t.m_fn();
+
+		// Release the tasks that were waiting on this one
+		for (int next : t.m_next)
+		{
+			if (--m_tasks[next]->m_remaining == 0)
+				submit(next, counter);
+		}
+	}, counter);
+}
+}
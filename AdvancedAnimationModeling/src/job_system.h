@@ -0,0 +1,99 @@
+/**
+* @file job_system.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+namespace cs460 {
+// Thread pool where each thread owns a job queue and steals from the others
+// when its own runs dry. The thread that waits on a group of jobs helps run
+// them, so jobs can wait on other jobs without blocking a thread
+class job_system
+{
+public:
+	static job_system& get_instance();
+	~job_system();
+
+	// Number of threads that run jobs, counting the main thread (1 runs everything inline)
+	void set_thread_count(unsigned n_threads);
+	unsigned thread_count() const { return (unsigned)m_workers.size() + 1; }
+
+	// Calls fn(begin, end) for chunks of at most grain items covering [0, count).
+	// The chunks do not depend on the thread count, so the results are deterministic
+	// as long as each chunk only writes its own items
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+	// Queues a job that decrements the counter once it is done
+	void submit(std::function<void()> fn, std::atomic<int>* counter);
+
+	// Runs queued jobs until the counter reaches zero
+	void wait(const std::atomic<int>& counter);
+
+private:
+	job_system();
+
+	struct job
+	{
+		std::function<void()> m_fn;
+		std::atomic<int>* m_counter = nullptr;
+	};
+
+	struct job_queue
+	{
+		std::mutex m_mutex;
+		std::deque<job> m_jobs;
+	};
+
+	// Takes a job from the given queue, or steals one from another queue
+	bool get_job(unsigned queue, job& j);
+	void run_job(job& j);
+	void worker_loop(unsigned queue);
+	void stop_workers();
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<job_queue>> m_queues; // Queue 0 belongs to the main thread
+
+	std::atomic<bool> m_quit;
+	std::atomic<int> m_queued;
+	std::mutex m_sleep_mutex;
+	std::condition_variable m_wake;
+};
+
+#define g_jobs job_system::get_instance()
+
+// Set of tasks with dependencies. A task is queued once all the tasks it
+// depends on are done
+class task_graph
+{
+public:
+	// Adds a task that runs after the given ones and returns its id
+	int add(std::function<void()> fn, const std::vector<int>& dependencies = {});
+
+	// Runs all the tasks and waits for them
+	void run();
+
+	void clear() { m_tasks.clear(); }
+	size_t size() const { return m_tasks.size(); }
+
+private:
+	struct task
+	{
+		std::function<void()> m_fn;
+		std::vector<int> m_next;
+		int m_n_dependencies = 0;
+		std::atomic<int> m_remaining;
+	};
+
+	void submit(int id, std::atomic<int>* counter);
+
+	std::vector<std::unique_ptr<task>> m_tasks;
+};
+}
@@ -16,11 +16,18 @@
 #include "resources.h"
 #include <glad/glad.h>
 #include "mesh_comp.h"
+#include "compression.h"
 
 namespace cs460 {
 typedef std::vector<int> indices;
 typedef tinygltf::Model gltf_model;
 
+import_options& get_import_options()
+{
+	static import_options options;
+	return options;
+}
+
 bool load_model(gltf_model& model, const char* file_name)
 {
 	// Create a tinygltf loader
@@ -564,6 +571,309 @@ void create_sampler(const gltf_model& model, animation& anim, const tinygltf::An
 	anim.m_samplers.push_back(s);
 }
 
+// Evaluates a linear sampler with the given number of components (rotations are slerped)
+void eval_sampler(const animation::sampler& sp, size_t n_comps, bool rotation, float t, float* out, int* cursor)
+{
+	int start, end;
+	float tn = sp.lerp(t, &start, &end, cursor);
+	const float* p0 = sp.m_output.data() + start * n_comps;
+	const float* p1 = sp.m_output.data() + end * n_comps;
+
+	if (rotation)
+	{
+		glm::quat q0(p0[3], p0[0], p0[1], p0[2]);
+		glm::quat q1(p1[3], p1[0], p1[1], p1[2]);
+		glm::quat q = glm::normalize(glm::slerp(q0, q1, tn));
+		out[0] = q.x;
+		out[1] = q.y;
+		out[2] = q.z;
+		out[3] = q.w;
+		return;
+	}
+
+	for (size_t c = 0; c < n_comps; ++c)
+		out[c] = p0[c] + (p1[c] - p0[c]) * tn;
+}
+
+// Distance between two samples (angle in degrees for rotations)
+float sample_error(const float* a, const float* b, size_t n_comps, bool rotation)
+{
+	if (rotation)
+		return glm::degrees(quat_angle(glm::quat(a[3], a[0], a[1], a[2]), glm::quat(b[3], b[0], b[1], b[2])));
+
+	float sum = 0.0f;
+	for (size_t c = 0; c < n_comps; ++c)
+		sum += (a[c] - b[c]) * (a[c] - b[c]);
+	return glm::sqrt(sum);
+}
+
+// Resamples the linear tracks of a uniformly keyed clip to a fixed rate
+void resample_animation(animation& anim, float rate)
+{
+	typedef animation::sampler::lerp_mode lerp_mode;
+	auto& samplers = anim.m_samplers;
+	size_t n_samplers = samplers.size();
+
+	// Keep the original keys if any track is far from uniformly keyed
+	for (const auto& sp : samplers)
+	{
+		size_t n_input = sp.m_input.size();
+		if (sp.m_lerp_mode != lerp_mode::linear || n_input < 2)
+			continue;
+
+		float mean = (sp.m_input.back() - sp.m_input.front()) / (n_input - 1);
+		for (size_t i = 1; i < n_input; ++i)
+		{
+			float interval = sp.m_input[i] - sp.m_input[i - 1];
+			if (interval < 0.5f * mean || interval > 1.5f * mean)
+			{
+				std::cout << "animation " << anim.m_name << " is not uniformly keyed, keeping the original keys" << std::endl;
+				return;
+			}
+		}
+	}
+
+	// Rotation samplers are slerped
+	std::vector<bool> rotation(n_samplers, false);
+	for (const auto& ch : anim.m_chanels)
+	{
+		if (ch.m_path_type == animation::channel::path_type::rotation)
+			rotation[ch.m_sampler] = true;
+	}
+
+	int n_keys = (int)glm::ceil(anim.m_max_time * rate - 1e-3f) + 1;
+	std::vector<float> max_error(n_samplers, 0.0f);
+
+	for (size_t i = 0; i < n_samplers; ++i)
+	{
+		const animation::sampler src = samplers[i];
+		if (src.m_lerp_mode != lerp_mode::linear || src.m_input.empty())
+			continue;
+
+		animation::sampler& dst = samplers[i];
+		size_t n_comps = src.m_output.size() / src.m_input.size();
+		dst.m_input.resize(n_keys);
+		dst.m_output.resize(n_keys * n_comps);
+		dst.m_rate = rate;
+
+		// Sample the original track at the fixed rate
+		int cursor = 1;
+		for (int k = 0; k < n_keys; ++k)
+		{
+			dst.m_input[k] = k / rate;
+			eval_sampler(src, n_comps, rotation[i], dst.m_input[k], dst.m_output.data() + k * n_comps, &cursor);
+		}
+
+		// Measure the error at the original keys and between the new ones
+		std::vector<float> times = src.m_input;
+		for (int k = 0; k + 1 < n_keys; ++k)
+			times.push_back((k + 0.5f) / rate);
+
+		std::vector<float> a(n_comps), b(n_comps);
+		for (float t : times)
+		{
+			eval_sampler(src, n_comps, rotation[i], t, a.data(), nullptr);
+			eval_sampler(dst, n_comps, rotation[i], t, b.data(), nullptr);
+			max_error[i] = glm::max(max_error[i], sample_error(a.data(), b.data(), n_comps, rotation[i]));
+		}
+	}
+
+	anim.m_fixed_rate = true;
+	anim.m_sample_rate = rate;
+
+	// Report the error of each track
+	std::cout << "animation " << anim.m_name << " resampled to " << rate << " Hz (" << n_keys << " keys)" << std::endl;
+	for (const auto& ch : anim.m_chanels)
+	{
+		if (samplers[ch.m_sampler].m_rate <= 0.0f)
+			continue;
+
+		static const char* paths[] = { "translation", "rotation", "scale", "weights" };
+		std::cout << "  node " << ch.m_node << " " << paths[(int)ch.m_path_type] << ": max error "
+			<< max_error[ch.m_sampler] << (rotation[ch.m_sampler] ? " deg" : "") << std::endl;
+	}
+}
+
+// Length of the rest translation of each node
+std::vector<float> rest_offsets(const gltf_model& model)
+{
+	size_t n_nodes = model.nodes.size();
+	std::vector<float> offsets(n_nodes, 0.0f);
+	for (size_t i = 0; i < n_nodes; ++i)
+	{
+		const auto& tr = model.nodes[i].translation;
+		if (tr.size() == 3)
+			offsets[i] = glm::length(glm::vec3(tr[0], tr[1], tr[2]));
+	}
+	return offsets;
+}
+
+// Compresses the tracks of an animation and reports the error
+void compress_tracks(const gltf_model& model, animation& anim)
+{
+	// Length of each bone
+	std::vector<std::vector<int>> children(model.nodes.size());
+	for (size_t i = 0; i < model.nodes.size(); ++i)
+		children[i] = model.nodes[i].children;
+	std::vector<float> bone_lengths = compute_bone_lengths(rest_offsets(model), children);
+
+	compression_stats stats = compress_animation(anim, bone_lengths);
+	std::cout << "animation " << anim.m_name << " compressed " << stats.m_raw_bytes << " -> " << stats.m_packed_bytes
+		<< " bytes (" << stats.ratio() << ":1), max error: translation " << stats.m_max_translation
+		<< ", rotation " << stats.m_max_rotation << " deg (" << stats.m_max_bone << " at the bone tip)"
+		<< ", scale " << stats.m_max_scale << std::endl;
+}
+
+// Computes the reach of each node (longest rest chain below it) and the depth of the hierarchy
+void compute_reach(const gltf_model& model, const std::vector<float>& offsets, int node, int level, std::vector<float>& reach, int& depth)
+{
+	depth = glm::max(depth, level);
+
+	float node_reach = 0.0f;
+	for (int child : model.nodes[node].children)
+	{
+		compute_reach(model, offsets, child, level + 1, reach, depth);
+		node_reach = glm::max(node_reach, offsets[child] + reach[child]);
+	}
+	reach[node] = node_reach;
+}
+
+// Checks if the keys between first and last are rebuilt within the tolerance from first and last alone
+bool segment_fits(const animation::sampler& sp, size_t n_comps, bool rotation, int first, int last, float tolerance)
+{
+	const float* out = sp.m_output.data();
+	const float* a = out + first * n_comps;
+	const float* b = out + last * n_comps;
+	float t0 = sp.m_input[first];
+	float t1 = sp.m_input[last];
+	bool step = sp.m_lerp_mode == animation::sampler::lerp_mode::step;
+
+	for (int k = first + 1; k < last; ++k)
+	{
+		const float* v = out + k * n_comps;
+		float tn = step ? 0.0f : (sp.m_input[k] - t0) / (t1 - t0);
+
+		float error = 0.0f;
+		if (rotation)
+		{
+			glm::quat q = glm::normalize(glm::slerp(glm::quat(a[3], a[0], a[1], a[2]), glm::quat(b[3], b[0], b[1], b[2]), tn));
+			error = quat_angle(q, glm::quat(v[3], v[0], v[1], v[2]));
+		}
+		else
+		{
+			for (size_t c = 0; c < n_comps; ++c)
+			{
+				float d = a[c] + (b[c] - a[c]) * tn - v[c];
+				error += d * d;
+			}
+			error = glm::sqrt(error);
+		}
+
+		if (error > tolerance)
+			return false;
+	}
+	return true;
+}
+
+// Removes the keys of a track that can be rebuilt from their neighbours, returns the number of keys removed
+size_t decimate_sampler(animation::sampler& sp, size_t n_comps, bool rotation, float tolerance)
+{
+	int n_keys = (int)sp.m_input.size();
+	if (n_keys < 3)
+		return 0;
+
+	// Extend each segment from the last kept key as far as the tolerance allows
+	std::vector<int> keep(1, 0);
+	int anchor = 0;
+	for (int k = 2; k < n_keys; ++k)
+	{
+		if (!segment_fits(sp, n_comps, rotation, anchor, k, tolerance))
+		{
+			anchor = k - 1;
+			keep.push_back(anchor);
+		}
+	}
+	keep.push_back(n_keys - 1);
+
+	// Rebuild the track with the kept keys
+	std::vector<float> input;
+	std::vector<float> output;
+	for (int k : keep)
+	{
+		input.push_back(sp.m_input[k]);
+		output.insert(output.end(), sp.m_output.begin() + k * n_comps, sp.m_output.begin() + (k + 1) * n_comps);
+	}
+	sp.m_input.swap(input);
+	sp.m_output.swap(output);
+
+	return n_keys - keep.size();
+}
+
+// Removes redundant keys of an animation. The position tolerance is split among the levels
+// of the hierarchy, and each joint turns it into an angle given how far its children reach
+void decimate_animation(const gltf_model& model, animation& anim, const import_options& options)
+{
+	typedef animation::channel::path_type path_type;
+	typedef animation::sampler::lerp_mode lerp_mode;
+
+	// Reach of every joint in the rest pose
+	std::vector<float> offsets = rest_offsets(model);
+	std::vector<float> reach(model.nodes.size(), 0.0f);
+	int depth = 1;
+	for (const auto& scene : model.scenes)
+	{
+		for (int root : scene.nodes)
+			compute_reach(model, offsets, root, 1, reach, depth);
+	}
+
+	// Each level of the hierarchy gets an equal share of the error at the tips
+	float budget = options.m_position_tolerance / depth;
+	float max_angle = glm::radians(options.m_angle_tolerance);
+
+	size_t n_samplers = anim.m_samplers.size();
+	std::vector<bool> done(n_samplers, false);
+	size_t total_keys = 0;
+	size_t removed_keys = 0;
+	size_t saved_bytes = 0;
+
+	for (const auto& ch : anim.m_chanels)
+	{
+		animation::sampler& sp = anim.m_samplers[ch.m_sampler];
+		if (done[ch.m_sampler] || ch.m_path_type == path_type::weights)
+			continue;
+		done[ch.m_sampler] = true;
+
+		// Fixed rate tracks keep their uniform keys
+		if (sp.m_lerp_mode == lerp_mode::cubic || sp.m_rate > 0.0f || sp.m_quantized)
+			continue;
+
+		float node_reach = ch.m_node >= 0 && ch.m_node < (int)reach.size() ? reach[ch.m_node] : 0.0f;
+		bool rotation = ch.m_path_type == path_type::rotation;
+		size_t n_comps = rotation ? 4 : 3;
+		if (sp.m_output.size() != sp.m_input.size() * n_comps)
+			continue;
+
+		// Tolerance of the track
+		float tolerance = budget;
+		if (rotation)
+		{
+			tolerance = max_angle;
+			if (node_reach > 0.0f)
+				tolerance = glm::min(tolerance, 2.0f * glm::asin(glm::min(budget / (2.0f * node_reach), 1.0f)));
+		}
+		else if (ch.m_path_type == path_type::scale && node_reach > 0.0f)
+			tolerance = budget / node_reach;
+
+		total_keys += sp.m_input.size();
+		size_t removed = decimate_sampler(sp, n_comps, rotation, tolerance);
+		removed_keys += removed;
+		saved_bytes += removed * (1 + n_comps) * sizeof(float);
+	}
+
+	std::cout << "animation " << anim.m_name << " decimated: removed " << removed_keys << " of " << total_keys
+		<< " keys, saved " << saved_bytes << " bytes" << std::endl;
+}
+
 void create_animation(const gltf_model& model, unsigned int anim_id, model_rsc& rsc)
 {
 	const tinygltf::Animation& anim_data = model.animations[anim_id];
@@ -601,6 +911,24 @@ void create_animation(const gltf_model& model, unsigned int anim_id, model_rsc&
 		ch.m_sampler = ch_data.sampler;
 		anim.m_chanels.push_back(ch);
 	}
+
+	// Resample to a fixed rate
+	const import_options& options = get_import_options();
+	if (options.m_resample)
+		resample_animation(anim, options.m_sample_rate);
+
+	// Remove the redundant keys
+	if (options.m_decimate)
+		decimate_animation(model, anim, options);
+
+	// Quantize the tracks
+	if (options.m_compress)
+		compress_tracks(model, anim);
+
+	// Pack the tracks for the runtime sampler. Compressed clips are sampled from the
+	// quantized tracks, a float bake would keep a second full copy of their keys
+	if (!options.m_compress)
+		anim.m_baked.bake(anim, (unsigned)model.nodes.size());
 }
 
 void create_animations(const gltf_model& model, model_rsc& rsc)
@@ -7,5 +7,24 @@
 #pragma once
 
 namespace cs460 {
+// Options applied to the animations of the imported models
+struct import_options
+{
+	// Resample the uniformly keyed clips to a fixed rate
+	bool m_resample = false;
+	float m_sample_rate = 30.0f;
+
+	// Remove the keys that can be rebuilt within the tolerances. The position
+	// tolerance bounds the error at the tips of the skeleton
+	bool m_decimate = false;
+	float m_position_tolerance = 0.001f;
+	float m_angle_tolerance = 0.1f; // Degrees
+
+	// Quantize the T, R, S tracks (smallest three rotations, 16 bit vectors)
+	bool m_compress = false;
+};
+
+import_options& get_import_options();
+
 void import_gltf_file(const char* file_name);
 }
\ No newline at end of file
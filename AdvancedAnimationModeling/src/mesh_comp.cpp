@@ -19,10 +19,6 @@ void mesh_comp::initialize()
 {
 }
 
-void mesh_comp::update()
-{
-}
-
 void mesh_comp::imgui()
 {
 	ImGui::Text("Mesh Component");
@@ -78,17 +74,17 @@ void mesh_comp::render_vb()
 
 void mesh_comp::render_skin()
 {
-	// Model idx and instance
-	int model_inst = get_owner()->m_model_inst;
+	// Model idx and nodes of the instance
 	int model_idx = get_owner()->m_model;
+	const std::vector<node*>& nodes = g_scene.get_instance_nodes(get_owner()->m_instance);
 
 	// Render bones
 	glm::vec4 bone_color(0.0f, 1.0f, 0.0f, 1.0f);
 	size_t n_segments = m_skin_segments.size();
 	for (size_t i = 0; i < n_segments; i += 2)
 	{
-		const node* start = g_scene.get_model_node(model_idx, model_inst, m_skin_segments[i]);
-		const node* end   = g_scene.get_model_node(model_idx, model_inst, m_skin_segments[i + 1]);
+		const node* start = nodes[m_skin_segments[i]];
+		const node* end   = nodes[m_skin_segments[i + 1]];
 		g_debug.debug_draw_line(start->m_world.get_position(), end->m_world.get_position(), bone_color);
 	}
 
@@ -99,7 +95,7 @@ void mesh_comp::render_skin()
 	size_t n_joints = joints.size();
 	for (size_t i = 0; i < n_joints; ++i)
 	{
-		const node* joint = g_scene.get_model_node(model_idx, model_inst, joints[i]);
+		const node* joint = nodes[joints[i]];
 		g_debug.debug_draw_aabb(joint->m_world.get_position() - offset, joint->m_world.get_position() + offset, joint_color, false, false);
 	}
 }
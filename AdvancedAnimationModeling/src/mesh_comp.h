@@ -16,7 +16,6 @@ struct model_rsc;
 struct mesh_comp : public component
 {
 	virtual void initialize();
-	virtual void update();
 	virtual void imgui();
 
 	void set_mesh(int mesh_idx, int skin_idx, int skin_root_idx);
@@ -5,9 +5,54 @@
 * @copyright Copyright (C) 2020 DigiPen Institute of Technology .
 */
 #include "node.h"
+#include "slab_allocator.h"
 #include <imgui.h>
 
 namespace cs460 {
+// Slots for all the nodes, created with the first node
+static slab_allocator& node_slab()
+{
+	static slab_allocator s(sizeof(node), 256);
+	return s;
+}
+
+static bool s_heap_nodes = false;
+
+void* node::operator new(size_t size)
+{
+	return s_heap_nodes ? ::operator new(size) : node_slab().allocate();
+}
+
+void node::operator delete(void* p)
+{
+	if (!p)
+		return;
+	if (s_heap_nodes)
+		::operator delete(p);
+	else
+		node_slab().release(p);
+}
+
+void node::set_heap_allocation(bool heap)
+{
+	s_heap_nodes = heap;
+}
+
+size_t node::pool_size()
+{
+	return node_slab().size();
+}
+
+size_t node::pool_capacity()
+{
+	return node_slab().capacity();
+}
+
+node::node()
+	: m_local(g_transforms.create(), transform_hierarchy::local)
+	, m_world(m_local.get_handle(), transform_hierarchy::world)
+{}
+
 // Free all components
 node::~node()
 {
@@ -15,8 +60,10 @@ node::~node()
 	for (size_t i = 0; i < n_comps; ++i)
 	{
 		m_comps[i]->destroy();
-		delete m_comps[i];
+		g_component_pools.get(m_comps[i]->get_type_id())->release(m_comps[i]);
 	}
+
+	g_transforms.destroy(m_local.get_handle());
 }
 
 // Update all components
@@ -42,6 +89,17 @@ void node::imgui()
 void node::add_child(node* child)
 {
 	child->m_parent = this;
+	g_transforms.set_parent(child->m_local.get_handle(), m_local.get_handle());
 	m_children.push_back(child);
+	if (m_in_scene)
+		child->set_in_scene(true);
+}
+
+void node::set_in_scene(bool in_scene)
+{
+	m_in_scene = in_scene;
+	size_t n_children = m_children.size();
+	for (size_t i = 0; i < n_children; ++i)
+		m_children[i]->set_in_scene(in_scene);
 }
 }
\ No newline at end of file
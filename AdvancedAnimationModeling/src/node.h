@@ -5,10 +5,10 @@
 * @copyright Copyright (C) 2020 DigiPen Institute of Technology .
 */
 #pragma once
-#include "transform.h"
+#include "transform_hierarchy.h"
 #include <vector>
 #include <string>
-#include "component.h"
+#include "component_pool.h"
 
 namespace cs460 {
 struct node
@@ -24,34 +24,52 @@ struct node
 	// Instance id
 	int m_model_inst = 0;
 
+	// Handle of the model instance in the scene registry (-1 if not from a model)
+	int m_instance = -1;
+
+	// Attached under the root of the scene. Only the components of these nodes are
+	// updated, rendered and picked
+	bool m_in_scene = false;
+
+	// Creates the transforms of the node in the hierarchy
+	node();
+
 	// Free all components
 	~node();
 
+	// Nodes are allocated from a slab, the slots of destroyed nodes are reused
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+
+	// Slots of the node slab in use and allocated
+	static size_t pool_size();
+	static size_t pool_capacity();
+
+	// Takes new nodes from the global heap instead of the slab, to measure the slab
+	// against it. Nodes have to be deleted with the setting they were created with
+	static void set_heap_allocation(bool heap);
+
 	// Updates components
 	void update();
 	void imgui();
 	void add_child(node* child);
+
+	// Sets m_in_scene of the node and everything below it
+	void set_in_scene(bool in_scene);
 	
 	// Returns a pointer to the requested component
-	// Returns null pointer if there is no T component
+	// Returns null pointer if there is no T component (derived types do not match)
 	template <typename T>
 	T* get_component() {
-		// Search for T component
-		size_t n_comps = m_comps.size();
-		for (size_t i = 0; i < n_comps; ++i) {
-			if (T* comp = dynamic_cast<T*>(m_comps[i]))
-				return comp;
-		}
-
-		// Not found
-		return nullptr;
+		unsigned id = component_type_id<T>();
+		return id < m_types.size() ? static_cast<T*>(m_types[id]) : nullptr;
 	}
 
 	// Adds a component
 	template <typename T>
 	T* add_component() {
-		// Create the component
-		T* comp = new T;
+		// Create the component in the pool of its type
+		T* comp = component_pool<T>::get_instance().create();
 
 		// Set the owner of the component
 		comp->set_owner(this);
@@ -59,16 +77,24 @@ struct node
 		// Initialize the component
 		comp->initialize();
 		
-		// Store the component
+		// Store the component, the first one of each type is found by get_component
 		m_comps.push_back(comp);
+		unsigned id = component_type_id<T>();
+		if (m_types.size() <= id)
+			m_types.resize(id + 1, nullptr);
+		if (!m_types[id])
+			m_types[id] = comp;
 
 		// Not found
 		return comp;
 	}
 
-	// Transforms
-	transform m_local;
-	transform m_world;
+	// Transforms, stored in the transform hierarchy
+	transform_handle m_local;
+	transform_handle m_world;
 	std::vector<component*> m_comps;
+
+	// Components indexed by type id (null if the node has none of that type)
+	std::vector<component*> m_types;
 };
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+* @file node_registry.cpp
+* @date 2026/10/17
+*/
+#include "node_registry.h"
+
+namespace cs460 {
+int node_registry::create_instance(int model_idx, int n_nodes)
+{
+	// Reuse a free handle
+	int handle = (int)m_instances.size();
+	if (!m_free_handles.empty())
+	{
+		handle = m_free_handles.back();
+		m_free_handles.pop_back();
+	}
+	else
+		m_instances.emplace_back();
+
+	if ((int)m_model_instances.size() <= model_idx)
+		m_model_instances.resize(model_idx + 1);
+
+	// Reuse a free index of the model
+	model_instances& model = m_model_instances[model_idx];
+	instance& inst = m_instances[handle];
+	inst.m_model = model_idx;
+	if (!model.m_free.empty())
+	{
+		inst.m_index = model.m_free.back();
+		model.m_free.pop_back();
+		model.m_handles[inst.m_index] = handle;
+	}
+	else
+	{
+		inst.m_index = (int)model.m_handles.size();
+		model.m_handles.push_back(handle);
+	}
+	inst.m_nodes.assign(n_nodes, nullptr);
+	return handle;
+}
+
+void node_registry::destroy_instance(int handle)
+{
+	instance& inst = m_instances[handle];
+	model_instances& model = m_model_instances[inst.m_model];
+	model.m_handles[inst.m_index] = -1;
+	model.m_free.push_back(inst.m_index);
+	inst.m_model = -1;
+	inst.m_index = -1;
+	inst.m_nodes.clear();
+	m_free_handles.push_back(handle);
+}
+
+void node_registry::clear()
+{
+	// Keep the arrays of the instances so new instances do not allocate
+	m_free_handles.clear();
+	for (int i = (int)m_instances.size() - 1; i >= 0; --i)
+	{
+		m_instances[i].m_model = -1;
+		m_instances[i].m_index = -1;
+		m_instances[i].m_nodes.clear();
+		m_free_handles.push_back(i);
+	}
+
+	for (model_instances& model : m_model_instances)
+	{
+		model.m_handles.clear();
+		model.m_free.clear();
+	}
+}
+
+int node_registry::find_instance(int model_idx, int instance_idx) const
+{
+	if (model_idx < 0 || model_idx >= (int)m_model_instances.size())
+		return -1;
+
+	const std::vector<int>& handles = m_model_instances[model_idx].m_handles;
+	if (instance_idx < 0 || instance_idx >= (int)handles.size())
+		return -1;
+
+	return handles[instance_idx];
+}
+
+node* node_registry::find_node(int handle, int node_idx) const
+{
+	if (handle < 0 || handle >= (int)m_instances.size())
+		return nullptr;
+
+	const std::vector<node*>& nodes = m_instances[handle].m_nodes;
+	if (node_idx < 0 || node_idx >= (int)nodes.size())
+		return nullptr;
+
+	return nodes[node_idx];
+}
+
+int node_registry::instance_count(int model_idx) const
+{
+	if (model_idx < 0 || model_idx >= (int)m_model_instances.size())
+		return 0;
+
+	const model_instances& model = m_model_instances[model_idx];
+	return (int)(model.m_handles.size() - model.m_free.size());
+}
+}
@@ -0,0 +1,64 @@
+/**
+* @file node_registry.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+
+namespace cs460 {
+struct node;
+
+// Nodes of every model instance in the scene. Each instance keeps its nodes in
+// one array indexed by gltf node index and is referenced by a handle that stays
+// valid until the instance is destroyed, so lookups do not hash anything
+class node_registry
+{
+public:
+	// Adds an instance of a model with room for n_nodes nodes and returns its handle
+	int create_instance(int model_idx, int n_nodes);
+	void destroy_instance(int handle);
+	void clear();
+
+	// Node of an instance by gltf node index (null if the model does not have it).
+	// The handle and the index are not checked, see find_node
+	node* get_node(int handle, int node_idx) const { return m_instances[handle].m_nodes[node_idx]; }
+
+	// Same as get_node, but null when the handle or the node index is out of range
+	node* find_node(int handle, int node_idx) const;
+	void set_node(int handle, int node_idx, node* n) { m_instances[handle].m_nodes[node_idx] = n; }
+
+	// All the nodes of an instance, indexed by gltf node index
+	const std::vector<node*>& get_nodes(int handle) const { return m_instances[handle].m_nodes; }
+
+	// Index of the instance among the instances of its model. Indices of destroyed
+	// instances are given to the next instances of the model
+	int get_instance_index(int handle) const { return m_instances[handle].m_index; }
+
+	// Handle of an instance from its model and its index among the instances of
+	// the model (-1 if there is no such instance)
+	int find_instance(int model_idx, int instance_idx) const;
+
+	// Number of instances of the model alive
+	int instance_count(int model_idx) const;
+
+private:
+	struct instance
+	{
+		int m_model = -1;
+		int m_index = -1;
+		std::vector<node*> m_nodes;
+	};
+
+	// Instances by handle, freed ones keep their arrays to be reused
+	std::vector<instance> m_instances;
+	std::vector<int> m_free_handles;
+
+	// Handle of each instance of a model by index (-1 once destroyed) and the free indices
+	struct model_instances
+	{
+		std::vector<int> m_handles;
+		std::vector<int> m_free;
+	};
+	std::vector<model_instances> m_model_instances;
+};
+}
@@ -34,7 +34,7 @@ void player_controller::initialize()
 	else
 	{
 		// Player pos
-		glm::vec3& player_pos = get_owner()->m_local.get_position();
+		const glm::vec3& player_pos = get_owner()->m_local.get_position();
 
 		// Orientation
 		glm::vec3 dir = glm::normalize(m_target - player_pos);
@@ -129,12 +129,13 @@ void player_controller::move_player()
 		m_forward = glm::vec3(0.0f);
 
 	// Move player
-	glm::vec3& player_pos = get_owner()->m_local.get_position();
+	glm::vec3 player_pos = get_owner()->m_local.get_position();
 
 	if (m_speed < 1.2f)
 		player_pos += m_forward * 3.0f * g_clock.dt();
 	else if (m_speed > 1.0f)
 		player_pos += m_forward * 4.0f * g_clock.dt();
+	get_owner()->m_local.set_position(player_pos);
 }
 
 void player_controller::orientation(const glm::vec3& dir)
@@ -199,7 +200,7 @@ void player_controller::targeted_movement()
 	}
 
 	// Player pos
-	glm::vec3& player_pos = get_owner()->m_local.get_position();
+	glm::vec3 player_pos = get_owner()->m_local.get_position();
 	m_speed += (glm::abs(length) - m_speed) * 5.0f * g_clock.dt();
 	player_pos += m_speed * m_forward * 2.0f * g_clock.dt();
 
@@ -207,6 +208,7 @@ void player_controller::targeted_movement()
 	{
 		player_pos = glm::normalize(player_pos) * 3.0f;
 	}
+	get_owner()->m_local.set_position(player_pos);
 
 	// Orientation
 	glm::vec3 dir = glm::normalize(m_target - player_pos);
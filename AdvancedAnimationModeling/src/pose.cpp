@@ -0,0 +1,778 @@
+/**
+* @file pose.cpp
+* @date 2026/10/17
+*/
+#include "pose.h"
+#include <algorithm>
+
+namespace cs460 {
+void dense_pose::resize(unsigned n_joints)
+{
+	m_size = n_joints;
+	m_stride = (n_joints + 7) & ~7u;
+
+	// Identity transforms for the padding and the new joints
+	for (int c = 0; c < n_components; ++c)
+	{
+		float identity = (c == qw || c >= sx) ? 1.0f : 0.0f;
+		m_data[c].resize(m_stride, identity);
+	}
+
+	// Validity masks
+	unsigned n_words = (m_stride + 63) / 64;
+	for (int i = 0; i < 3; ++i)
+		m_valid[i].assign(n_words, 0);
+}
+
+void dense_pose::clear()
+{
+	for (int i = 0; i < 3; ++i)
+		std::fill(m_valid[i].begin(), m_valid[i].end(), 0);
+}
+
+unsigned char dense_pose::get_flags(unsigned joint) const
+{
+	unsigned char flags = 0;
+	if (is_valid(joint, translation))
+		flags |= translation;
+	if (is_valid(joint, rotation))
+		flags |= rotation;
+	if (is_valid(joint, scale))
+		flags |= scale;
+	return flags;
+}
+
+glm::vec3 dense_pose::get_position(unsigned joint) const
+{
+	return glm::vec3(m_data[tx][joint], m_data[ty][joint], m_data[tz][joint]);
+}
+
+glm::quat dense_pose::get_rotation(unsigned joint) const
+{
+	return glm::quat(m_data[qw][joint], m_data[qx][joint], m_data[qy][joint], m_data[qz][joint]);
+}
+
+glm::vec3 dense_pose::get_scale(unsigned joint) const
+{
+	return glm::vec3(m_data[sx][joint], m_data[sy][joint], m_data[sz][joint]);
+}
+
+void dense_pose::set_position(unsigned joint, const glm::vec3& p)
+{
+	m_data[tx][joint] = p.x;
+	m_data[ty][joint] = p.y;
+	m_data[tz][joint] = p.z;
+	set_valid(joint, translation);
+}
+
+void dense_pose::set_rotation(unsigned joint, const glm::quat& q)
+{
+	m_data[qx][joint] = q.x;
+	m_data[qy][joint] = q.y;
+	m_data[qz][joint] = q.z;
+	m_data[qw][joint] = q.w;
+	set_valid(joint, rotation);
+}
+
+void dense_pose::set_scale(unsigned joint, const glm::vec3& s)
+{
+	m_data[sx][joint] = s.x;
+	m_data[sy][joint] = s.y;
+	m_data[sz][joint] = s.z;
+	set_valid(joint, scale);
+}
+
+// Components that are linearly interpolated (rotations are normalized afterwards)
+static const int g_blend_comps[] = {
+	dense_pose::tx, dense_pose::ty, dense_pose::tz,
+	dense_pose::sx, dense_pose::sy, dense_pose::sz
+};
+
+static void lerp_poses_scalar(const dense_pose& a, const dense_pose& b, float t, dense_pose& out)
+{
+	const unsigned stride = a.stride();
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		const float* pa = a.m_data[c].data();
+		const float* pb = b.m_data[c].data();
+		float* po = out.m_data[c].data();
+		for (unsigned i = 0; i < stride; ++i)
+			po[i] = pa[i] + (pb[i] - pa[i]) * t;
+	}
+
+	// Rotation, b is flipped to the hemisphere of a
+	const float* ra[4];
+	const float* rb[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		ra[c] = a.m_data[dense_pose::qx + c].data();
+		rb[c] = b.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+	}
+
+	for (unsigned i = 0; i < stride; ++i)
+	{
+		float dot = 0.0f;
+		for (int c = 0; c < 4; ++c)
+			dot += ra[c][i] * rb[c][i];
+		float tb = dot < 0.0f ? -t : t;
+
+		float q[4];
+		float len2 = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			q[c] = ra[c][i] * (1.0f - t) + rb[c][i] * tb;
+			len2 += q[c] * q[c];
+		}
+
+		float inv_len = 1.0f / glm::sqrt(len2);
+		for (int c = 0; c < 4; ++c)
+			ro[c][i] = q[c] * inv_len;
+	}
+}
+
+SIMD_TARGET_SSE4 static void lerp_poses_sse4(const dense_pose& a, const dense_pose& b, float t, dense_pose& out)
+{
+#if defined(SIMD_X86)
+	const unsigned stride = a.stride();
+	__m128 vt = _mm_set1_ps(t);
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		const float* pa = a.m_data[c].data();
+		const float* pb = b.m_data[c].data();
+		float* po = out.m_data[c].data();
+		for (unsigned i = 0; i < stride; i += 4)
+		{
+			__m128 va = _mm_load_ps(pa + i);
+			__m128 vb = _mm_load_ps(pb + i);
+			_mm_store_ps(po + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), vt)));
+		}
+	}
+
+	// Rotation, b is flipped to the hemisphere of a
+	const float* ra[4];
+	const float* rb[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		ra[c] = a.m_data[dense_pose::qx + c].data();
+		rb[c] = b.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+	}
+	__m128 ta = _mm_set1_ps(1.0f - t);
+	__m128 sign = _mm_set1_ps(-0.0f);
+	for (unsigned i = 0; i < stride; i += 4)
+	{
+		__m128 qa[4], qb[4];
+		__m128 dot = _mm_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			qa[c] = _mm_load_ps(ra[c] + i);
+			qb[c] = _mm_load_ps(rb[c] + i);
+			dot = _mm_add_ps(dot, _mm_mul_ps(qa[c], qb[c]));
+		}
+		__m128 tb = _mm_xor_ps(vt, _mm_and_ps(dot, sign));
+
+		__m128 q[4];
+		__m128 len2 = _mm_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			q[c] = _mm_add_ps(_mm_mul_ps(qa[c], ta), _mm_mul_ps(qb[c], tb));
+			len2 = _mm_add_ps(len2, _mm_mul_ps(q[c], q[c]));
+		}
+
+		__m128 inv_len = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm_store_ps(ro[c] + i, _mm_mul_ps(q[c], inv_len));
+	}
+#else
+	lerp_poses_scalar(a, b, t, out);
+#endif
+}
+
+SIMD_TARGET_AVX2 static void lerp_poses_avx2(const dense_pose& a, const dense_pose& b, float t, dense_pose& out)
+{
+#if defined(SIMD_X86)
+	const unsigned stride = a.stride();
+	__m256 vt = _mm256_set1_ps(t);
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		const float* pa = a.m_data[c].data();
+		const float* pb = b.m_data[c].data();
+		float* po = out.m_data[c].data();
+		for (unsigned i = 0; i < stride; i += 8)
+		{
+			__m256 va = _mm256_load_ps(pa + i);
+			__m256 vb = _mm256_load_ps(pb + i);
+			_mm256_store_ps(po + i, _mm256_fmadd_ps(_mm256_sub_ps(vb, va), vt, va));
+		}
+	}
+
+	// Rotation, b is flipped to the hemisphere of a
+	const float* ra[4];
+	const float* rb[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		ra[c] = a.m_data[dense_pose::qx + c].data();
+		rb[c] = b.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+	}
+	__m256 ta = _mm256_set1_ps(1.0f - t);
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	for (unsigned i = 0; i < stride; i += 8)
+	{
+		__m256 qa[4], qb[4];
+		__m256 dot = _mm256_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			qa[c] = _mm256_load_ps(ra[c] + i);
+			qb[c] = _mm256_load_ps(rb[c] + i);
+			dot = _mm256_fmadd_ps(qa[c], qb[c], dot);
+		}
+		__m256 tb = _mm256_xor_ps(vt, _mm256_and_ps(dot, sign));
+
+		__m256 q[4];
+		__m256 len2 = _mm256_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+		{
+			q[c] = _mm256_fmadd_ps(qb[c], tb, _mm256_mul_ps(qa[c], ta));
+			len2 = _mm256_fmadd_ps(q[c], q[c], len2);
+		}
+
+		__m256 inv_len = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm256_store_ps(ro[c] + i, _mm256_mul_ps(q[c], inv_len));
+	}
+#else
+	lerp_poses_scalar(a, b, t, out);
+#endif
+}
+
+void lerp_poses(const dense_pose& a, const dense_pose& b, float t, dense_pose& out)
+{
+	lerp_poses(a, b, t, out, get_simd_level());
+}
+
+void lerp_poses(const dense_pose& a, const dense_pose& b, float t, dense_pose& out, simd_level level)
+{
+	if (out.size() != a.size())
+		out.resize(a.size());
+
+	if (level == simd_level::avx2)
+		lerp_poses_avx2(a, b, t, out);
+	else if (level == simd_level::sse4)
+		lerp_poses_sse4(a, b, t, out);
+	else
+		lerp_poses_scalar(a, b, t, out);
+
+	// Validity, joints missing in one pose take the other one
+	bool same = true;
+	for (int ch = 0; ch < 3; ++ch)
+	{
+		out.m_valid[ch] = a.m_valid[ch];
+		same = same && a.m_valid[ch] == b.m_valid[ch];
+	}
+	if (same)
+		return;
+
+	unsigned n_joints = a.size();
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		unsigned char fa = a.get_flags(j);
+		unsigned char fb = b.get_flags(j);
+		if (fa == fb)
+			continue;
+
+		const dense_pose& tr = (fa & translation) != 0 ? a : b;
+		const dense_pose& rot = (fa & rotation) != 0 ? a : b;
+		const dense_pose& sca = (fa & scale) != 0 ? a : b;
+		if (((fa ^ fb) & translation) != 0)
+			out.set_position(j, tr.get_position(j));
+		if (((fa ^ fb) & rotation) != 0)
+			out.set_rotation(j, rot.get_rotation(j));
+		if (((fa ^ fb) & scale) != 0)
+			out.set_scale(j, sca.get_scale(j));
+	}
+}
+
+// Blends a single joint using only the poses that have each channel
+static void blend_joint(const dense_pose* const* poses, const float* weights, unsigned n_poses, unsigned j, dense_pose& out)
+{
+	// Translation
+	glm::vec3 p(0.0f);
+	float w_sum = 0.0f;
+	for (unsigned k = 0; k < n_poses; ++k)
+	{
+		if (poses[k]->is_valid(j, translation))
+		{
+			p += poses[k]->get_position(j) * weights[k];
+			w_sum += weights[k];
+		}
+	}
+	if (w_sum > 0.0f)
+		out.set_position(j, p / w_sum);
+	else
+		out.clear_valid(j, translation);
+
+	// Rotation, in the hemisphere of the first pose that has it
+	glm::quat q(0.0f, 0.0f, 0.0f, 0.0f);
+	glm::quat ref;
+	bool has_ref = false;
+	for (unsigned k = 0; k < n_poses; ++k)
+	{
+		if (!poses[k]->is_valid(j, rotation))
+			continue;
+
+		glm::quat qk = poses[k]->get_rotation(j);
+		if (!has_ref)
+		{
+			ref = qk;
+			has_ref = true;
+		}
+		float w = glm::dot(ref, qk) < 0.0f ? -weights[k] : weights[k];
+		q = q + qk * w;
+	}
+	float len = glm::length(q);
+	if (len > 0.0f)
+		out.set_rotation(j, q / len);
+	else
+		out.clear_valid(j, rotation);
+
+	// Scale
+	glm::vec3 s(0.0f);
+	w_sum = 0.0f;
+	for (unsigned k = 0; k < n_poses; ++k)
+	{
+		if (poses[k]->is_valid(j, scale))
+		{
+			s += poses[k]->get_scale(j) * weights[k];
+			w_sum += weights[k];
+		}
+	}
+	if (w_sum > 0.0f)
+		out.set_scale(j, s / w_sum);
+	else
+		out.clear_valid(j, scale);
+}
+
+static void blend_poses_scalar(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out)
+{
+	const dense_pose& first = *poses[0];
+	const unsigned stride = first.stride();
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		float* po = out.m_data[c].data();
+		const float* p0 = first.m_data[c].data();
+		float w0 = weights[0];
+		for (unsigned i = 0; i < stride; ++i)
+			po[i] = p0[i] * w0;
+
+		for (unsigned k = 1; k < n_poses; ++k)
+		{
+			const float* pk = poses[k]->m_data[c].data();
+			float wk = weights[k];
+			for (unsigned i = 0; i < stride; ++i)
+				po[i] += pk[i] * wk;
+		}
+	}
+
+	// Rotation, every pose is flipped to the hemisphere of the first one
+	const float* r0[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		r0[c] = first.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+		for (unsigned i = 0; i < stride; ++i)
+			ro[c][i] = r0[c][i] * weights[0];
+	}
+
+	for (unsigned k = 1; k < n_poses; ++k)
+	{
+		const float* rk[4];
+		for (int c = 0; c < 4; ++c)
+			rk[c] = poses[k]->m_data[dense_pose::qx + c].data();
+
+		float wk = weights[k];
+		for (unsigned i = 0; i < stride; ++i)
+		{
+			float dot = r0[0][i] * rk[0][i] + r0[1][i] * rk[1][i] + r0[2][i] * rk[2][i] + r0[3][i] * rk[3][i];
+			float w = dot < 0.0f ? -wk : wk;
+			for (int c = 0; c < 4; ++c)
+				ro[c][i] += rk[c][i] * w;
+		}
+	}
+
+	for (unsigned i = 0; i < stride; ++i)
+	{
+		float len2 = ro[0][i] * ro[0][i] + ro[1][i] * ro[1][i] + ro[2][i] * ro[2][i] + ro[3][i] * ro[3][i];
+		float inv_len = 1.0f / glm::sqrt(len2);
+		for (int c = 0; c < 4; ++c)
+			ro[c][i] *= inv_len;
+	}
+}
+
+SIMD_TARGET_SSE4 static void blend_poses_sse4(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out)
+{
+#if defined(SIMD_X86)
+	const dense_pose& first = *poses[0];
+	const unsigned stride = first.stride();
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		float* po = out.m_data[c].data();
+		__m128 w0 = _mm_set1_ps(weights[0]);
+		const float* p0 = first.m_data[c].data();
+		for (unsigned i = 0; i < stride; i += 4)
+			_mm_store_ps(po + i, _mm_mul_ps(_mm_load_ps(p0 + i), w0));
+
+		for (unsigned k = 1; k < n_poses; ++k)
+		{
+			__m128 wk = _mm_set1_ps(weights[k]);
+			const float* pk = poses[k]->m_data[c].data();
+			for (unsigned i = 0; i < stride; i += 4)
+				_mm_store_ps(po + i, _mm_add_ps(_mm_load_ps(po + i), _mm_mul_ps(_mm_load_ps(pk + i), wk)));
+		}
+	}
+
+	// Rotation, every pose is flipped to the hemisphere of the first one
+	const float* r0[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		r0[c] = first.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+	}
+	__m128 w0 = _mm_set1_ps(weights[0]);
+	__m128 sign = _mm_set1_ps(-0.0f);
+	for (unsigned i = 0; i < stride; i += 4)
+	{
+		__m128 q0[4], q[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			q0[c] = _mm_load_ps(r0[c] + i);
+			q[c] = _mm_mul_ps(q0[c], w0);
+		}
+
+		for (unsigned k = 1; k < n_poses; ++k)
+		{
+			__m128 qk[4];
+			__m128 dot = _mm_setzero_ps();
+			for (int c = 0; c < 4; ++c)
+			{
+				qk[c] = _mm_load_ps(poses[k]->m_data[dense_pose::qx + c].data() + i);
+				dot = _mm_add_ps(dot, _mm_mul_ps(q0[c], qk[c]));
+			}
+			__m128 wk = _mm_xor_ps(_mm_set1_ps(weights[k]), _mm_and_ps(dot, sign));
+			for (int c = 0; c < 4; ++c)
+				q[c] = _mm_add_ps(q[c], _mm_mul_ps(qk[c], wk));
+		}
+
+		__m128 len2 = _mm_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+			len2 = _mm_add_ps(len2, _mm_mul_ps(q[c], q[c]));
+		__m128 inv_len = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm_store_ps(ro[c] + i, _mm_mul_ps(q[c], inv_len));
+	}
+#else
+	blend_poses_scalar(poses, weights, n_poses, out);
+#endif
+}
+
+SIMD_TARGET_AVX2 static void blend_poses_avx2(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out)
+{
+#if defined(SIMD_X86)
+	const dense_pose& first = *poses[0];
+	const unsigned stride = first.stride();
+
+	// Translation and scale
+	for (int c : g_blend_comps)
+	{
+		float* po = out.m_data[c].data();
+		__m256 w0 = _mm256_set1_ps(weights[0]);
+		const float* p0 = first.m_data[c].data();
+		for (unsigned i = 0; i < stride; i += 8)
+			_mm256_store_ps(po + i, _mm256_mul_ps(_mm256_load_ps(p0 + i), w0));
+
+		for (unsigned k = 1; k < n_poses; ++k)
+		{
+			__m256 wk = _mm256_set1_ps(weights[k]);
+			const float* pk = poses[k]->m_data[c].data();
+			for (unsigned i = 0; i < stride; i += 8)
+				_mm256_store_ps(po + i, _mm256_fmadd_ps(_mm256_load_ps(pk + i), wk, _mm256_load_ps(po + i)));
+		}
+	}
+
+	// Rotation, every pose is flipped to the hemisphere of the first one
+	const float* r0[4];
+	float* ro[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		r0[c] = first.m_data[dense_pose::qx + c].data();
+		ro[c] = out.m_data[dense_pose::qx + c].data();
+	}
+	__m256 w0 = _mm256_set1_ps(weights[0]);
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	for (unsigned i = 0; i < stride; i += 8)
+	{
+		__m256 q0[4], q[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			q0[c] = _mm256_load_ps(r0[c] + i);
+			q[c] = _mm256_mul_ps(q0[c], w0);
+		}
+
+		for (unsigned k = 1; k < n_poses; ++k)
+		{
+			__m256 qk[4];
+			__m256 dot = _mm256_setzero_ps();
+			for (int c = 0; c < 4; ++c)
+			{
+				qk[c] = _mm256_load_ps(poses[k]->m_data[dense_pose::qx + c].data() + i);
+				dot = _mm256_fmadd_ps(q0[c], qk[c], dot);
+			}
+			__m256 wk = _mm256_xor_ps(_mm256_set1_ps(weights[k]), _mm256_and_ps(dot, sign));
+			for (int c = 0; c < 4; ++c)
+				q[c] = _mm256_fmadd_ps(qk[c], wk, q[c]);
+		}
+
+		__m256 len2 = _mm256_setzero_ps();
+		for (int c = 0; c < 4; ++c)
+			len2 = _mm256_fmadd_ps(q[c], q[c], len2);
+		__m256 inv_len = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(len2));
+		for (int c = 0; c < 4; ++c)
+			_mm256_store_ps(ro[c] + i, _mm256_mul_ps(q[c], inv_len));
+	}
+#else
+	blend_poses_scalar(poses, weights, n_poses, out);
+#endif
+}
+
+void blend_poses(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out)
+{
+	blend_poses(poses, weights, n_poses, out, get_simd_level());
+}
+
+void blend_poses(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out, simd_level level)
+{
+	const dense_pose& first = *poses[0];
+	if (out.size() != first.size())
+		out.resize(first.size());
+
+	if (level == simd_level::avx2)
+		blend_poses_avx2(poses, weights, n_poses, out);
+	else if (level == simd_level::sse4)
+		blend_poses_sse4(poses, weights, n_poses, out);
+	else
+		blend_poses_scalar(poses, weights, n_poses, out);
+
+	// Validity, joints missing in some poses are blended again on their own
+	bool same = true;
+	for (int ch = 0; ch < 3; ++ch)
+	{
+		out.m_valid[ch] = first.m_valid[ch];
+		for (unsigned k = 1; k < n_poses; ++k)
+			same = same && first.m_valid[ch] == poses[k]->m_valid[ch];
+	}
+	if (same)
+		return;
+
+	unsigned n_joints = first.size();
+	for (unsigned j = 0; j < n_joints; ++j)
+	{
+		unsigned char flags = first.get_flags(j);
+		bool differ = false;
+		for (unsigned k = 1; k < n_poses && !differ; ++k)
+			differ = poses[k]->get_flags(j) != flags;
+		if (differ)
+			blend_joint(poses, weights, n_poses, j, out);
+	}
+}
+
+void bone_mask::resize(unsigned n_joints)
+{
+	m_size = n_joints;
+	unsigned stride = (n_joints + 7) & ~7u;
+	m_weights.assign(stride, 0.0f);
+
+	unsigned n_words = (stride + 63) / 64;
+	for (int i = 0; i < 3; ++i)
+		m_valid[i].assign(n_words, 0);
+	m_spans.clear();
+}
+
+void bone_mask::include(unsigned joint, unsigned char flags, float weight)
+{
+	if (joint >= m_size)
+		return;
+
+	const target_type types[] = { translation, rotation, scale };
+	for (target_type type : types)
+	{
+		if ((flags & type) != 0)
+			m_valid[dense_pose::channel(type)][joint >> 6] |= (uint64_t)1 << (joint & 63);
+	}
+	m_weights[joint] = weight;
+}
+
+void bone_mask::finalize()
+{
+	// Spans, consecutive blocks of 8 joints that have a joint included
+	m_spans.clear();
+	unsigned stride = (unsigned)m_weights.size();
+	for (unsigned block = 0; block < stride; block += 8)
+	{
+		uint64_t bits = 0;
+		for (int i = 0; i < 3; ++i)
+			bits |= (m_valid[i][block >> 6] >> (block & 63)) & 0xff;
+		if (bits == 0)
+			continue;
+
+		if (!m_spans.empty() && m_spans.back().second == block)
+			m_spans.back().second = block + 8;
+		else
+			m_spans.push_back({ block, block + 8 });
+	}
+}
+
+unsigned char bone_mask::get_flags(unsigned joint) const
+{
+	unsigned char flags = 0;
+	if (includes(joint, translation))
+		flags |= translation;
+	if (includes(joint, rotation))
+		flags |= rotation;
+	if (includes(joint, scale))
+		flags |= scale;
+	return flags;
+}
+
+unsigned bone_mask::joint_count() const
+{
+	unsigned n_joints = 0;
+	for (unsigned j = 0; j < m_size; ++j)
+	{
+		if (get_flags(j) != 0)
+			++n_joints;
+	}
+	return n_joints;
+}
+
+void apply_layer(dense_pose& pose, const dense_pose& layer, const dense_pose* reference, const bone_mask& mask, float weight)
+{
+	unsigned n_joints = glm::min(glm::min(pose.size(), layer.size()), mask.size());
+	if (reference)
+		n_joints = glm::min(n_joints, reference->size());
+
+	for (const auto& span : mask.m_spans)
+	{
+		unsigned last = glm::min(span.second, n_joints);
+		for (unsigned j = span.first; j < last; ++j)
+		{
+			unsigned char flags = mask.get_flags(j) & layer.get_flags(j);
+			float w = weight * mask.m_weights[j];
+			if (flags == 0 || w <= 0.0f)
+				continue;
+
+			// Override, joints the pose does not have take the layer
+			if (!reference)
+			{
+				unsigned char missing = flags & ~pose.get_flags(j);
+				if ((flags & translation) != 0)
+				{
+					glm::vec3 p = layer.get_position(j);
+					pose.set_position(j, (missing & translation) != 0 ? p : glm::mix(pose.get_position(j), p, w));
+				}
+				if ((flags & rotation) != 0)
+				{
+					glm::quat q = layer.get_rotation(j);
+					if ((missing & rotation) == 0)
+					{
+						glm::quat q0 = pose.get_rotation(j);
+						if (glm::dot(q0, q) < 0.0f)
+							q = -q;
+						q = glm::normalize(q0 * (1.0f - w) + q * w);
+					}
+					pose.set_rotation(j, q);
+				}
+				if ((flags & scale) != 0)
+				{
+					glm::vec3 s = layer.get_scale(j);
+					pose.set_scale(j, (missing & scale) != 0 ? s : glm::mix(pose.get_scale(j), s, w));
+				}
+				continue;
+			}
+
+			// Additive, the difference from the reference scaled by the weight
+			flags &= reference->get_flags(j) & pose.get_flags(j);
+			if ((flags & translation) != 0)
+				pose.set_position(j, pose.get_position(j) + (layer.get_position(j) - reference->get_position(j)) * w);
+			if ((flags & rotation) != 0)
+			{
+				glm::quat delta = glm::inverse(reference->get_rotation(j)) * layer.get_rotation(j);
+				if (delta.w < 0.0f)
+					delta = -delta;
+				delta = glm::normalize(glm::quat(1.0f, 0.0f, 0.0f, 0.0f) * (1.0f - w) + delta * w);
+				pose.set_rotation(j, glm::normalize(pose.get_rotation(j) * delta));
+			}
+			if ((flags & scale) != 0)
+			{
+				glm::vec3 ref = reference->get_scale(j);
+				glm::vec3 ratio = layer.get_scale(j);
+				for (int c = 0; c < 3; ++c)
+					ratio[c] = ref[c] != 0.0f ? ratio[c] / ref[c] : 1.0f;
+				pose.set_scale(j, pose.get_scale(j) * glm::mix(glm::vec3(1.0f), ratio, w));
+			}
+		}
+	}
+}
+
+dense_pose* pose_pool::acquire()
+{
+	dense_pose* pose = nullptr;
+	if (!m_free.empty())
+	{
+		pose = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		m_poses.emplace_back(new dense_pose);
+		pose = m_poses.back().get();
+
+		// Room to give every pose back without growing
+		m_free.reserve(m_poses.size());
+		++m_allocations;
+	}
+
+	if (pose->size() != m_n_joints)
+	{
+		pose->resize(m_n_joints);
+		++m_allocations;
+	}
+	return pose;
+}
+
+void pose_pool::release(dense_pose* pose)
+{
+	m_free.push_back(pose);
+}
+
+void pose_pool::clear()
+{
+	m_poses.clear();
+	m_free.clear();
+}
+}
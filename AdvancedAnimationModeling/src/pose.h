@@ -0,0 +1,156 @@
+/**
+* @file pose.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "simd.h"
+
+namespace cs460 {
+enum target_type { translation = 1, rotation = 2, scale = 4 };
+
+typedef std::vector<float, aligned_allocator<float>> float_array;
+
+// Local transforms of a skeleton stored as structure of arrays and indexed by
+// joint slot (gltf node index). Each channel keeps a validity bitmask that
+// tells which joints carry animation data
+struct dense_pose
+{
+	// Components of a transform (3 translation, 4 rotation, 3 scale)
+	enum component { tx, ty, tz, qx, qy, qz, qw, sx, sy, sz, n_components };
+
+	// Resizes the pose, the arrays are padded to a multiple of 8 joints
+	void resize(unsigned n_joints);
+
+	// Marks every channel of every joint as invalid
+	void clear();
+
+	unsigned size() const { return m_size; }
+	unsigned stride() const { return m_stride; }
+
+	// Validity of the T, R, S channels of the given joint
+	bool is_valid(unsigned joint, target_type type) const {
+		return ((m_valid[channel(type)][joint >> 6] >> (joint & 63)) & 1) != 0;
+	}
+	void set_valid(unsigned joint, target_type type) {
+		m_valid[channel(type)][joint >> 6] |= (uint64_t)1 << (joint & 63);
+	}
+	void clear_valid(unsigned joint, target_type type) {
+		m_valid[channel(type)][joint >> 6] &= ~((uint64_t)1 << (joint & 63));
+	}
+
+	// Returns the T, R, S flags of the given joint
+	unsigned char get_flags(unsigned joint) const;
+
+	glm::vec3 get_position(unsigned joint) const;
+	glm::quat get_rotation(unsigned joint) const;
+	glm::vec3 get_scale(unsigned joint) const;
+
+	void set_position(unsigned joint, const glm::vec3& p);
+	void set_rotation(unsigned joint, const glm::quat& q);
+	void set_scale(unsigned joint, const glm::vec3& s);
+
+	// Index of the validity mask of a channel
+	static unsigned channel(target_type type) { return type == translation ? 0 : (type == rotation ? 1 : 2); }
+
+	// Component arrays
+	float_array m_data[n_components];
+
+	// Validity bitmasks (translation, rotation, scale)
+	std::vector<uint64_t> m_valid[3];
+
+private:
+	unsigned m_size = 0;
+	unsigned m_stride = 0;
+};
+
+// Joints and T, R, S channels a layer is sampled and blended for, with a weight
+// per joint. The joints are tracked in blocks of 8 so sampling can skip the
+// blocks the mask leaves out
+struct bone_mask
+{
+	// Resizes the mask with no joint included
+	void resize(unsigned n_joints);
+
+	unsigned size() const { return m_size; }
+	bool empty() const { return m_spans.empty(); }
+
+	// Includes the channels in flags (target_type bits) of a joint
+	void include(unsigned joint, unsigned char flags, float weight = 1.0f);
+
+	// Builds the spans from the joints included, call it after the last include
+	void finalize();
+
+	bool includes(unsigned joint, target_type type) const {
+		return ((m_valid[dense_pose::channel(type)][joint >> 6] >> (joint & 63)) & 1) != 0;
+	}
+	unsigned char get_flags(unsigned joint) const;
+
+	// Joints with at least one channel included
+	unsigned joint_count() const;
+
+	// Weight of each joint, padded like the arrays of a dense pose
+	float_array m_weights;
+
+	// Channels included (translation, rotation, scale), same layout as dense_pose::m_valid
+	std::vector<uint64_t> m_valid[3];
+
+	// Joint ranges [first, last) made of the blocks of 8 with a joint included
+	std::vector<std::pair<unsigned, unsigned>> m_spans;
+
+private:
+	unsigned m_size = 0;
+};
+
+// Blends a layer into the pose, only for the joints and channels of the mask and
+// by weight times the weight of each joint. Without a reference the layer overrides
+// the pose. With one, the difference between the layer and the reference is added
+// on top of the pose (joints the pose does not have are left out)
+void apply_layer(dense_pose& pose, const dense_pose& layer, const dense_pose* reference, const bone_mask& mask, float weight);
+
+// Interpolates two poses of the same skeleton (lerp for translation and scale,
+// nlerp for rotation). Joints valid in only one of them are copied
+void lerp_poses(const dense_pose& a, const dense_pose& b, float t, dense_pose& out);
+void lerp_poses(const dense_pose& a, const dense_pose& b, float t, dense_pose& out, simd_level level);
+
+// Weighted blend of several poses of the same skeleton. Rotations are flipped to
+// the hemisphere of the first pose and normalized. Joints missing in some of the
+// poses blend the ones that have them, with the weights renormalized
+void blend_poses(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out);
+void blend_poses(const dense_pose* const* poses, const float* weights, unsigned n_poses, dense_pose& out, simd_level level);
+
+// Poses lent to the nodes of a blend tree while it is evaluated. A node takes a
+// pose, fills it and gives back the poses of its children, so the number of live
+// poses grows with the depth of the tree and the memory is reused every frame
+class pose_pool
+{
+public:
+	// Joint count of the poses lent from now on
+	void set_joint_count(unsigned n_joints) { m_n_joints = n_joints; }
+	unsigned joint_count() const { return m_n_joints; }
+
+	// Takes a pose sized for the joint count (the contents are undefined)
+	dense_pose* acquire();
+	void release(dense_pose* pose);
+
+	// Frees every pose, lent poses become invalid
+	void clear();
+
+	// Poses created or resized since the pool was created
+	int allocations() const { return m_allocations; }
+
+	// Poses in use and poses owned
+	int live() const { return (int)(m_poses.size() - m_free.size()); }
+	int size() const { return (int)m_poses.size(); }
+
+private:
+	std::vector<std::unique_ptr<dense_pose>> m_poses;
+	std::vector<dense_pose*> m_free;
+	unsigned m_n_joints = 0;
+	int m_allocations = 0;
+};
+}
@@ -0,0 +1,221 @@
+/**
+* @file pose_cache.cpp
+* @date 2026/10/17
+*/
+#include "pose_cache.h"
+#include "animation_system.h"
+#include "compression.h"
+#include <imgui.h>
+#include <cstring>
+
+namespace cs460 {
+pose_cache& pose_cache::get_instance()
+{
+	static pose_cache c;
+	return c;
+}
+
+void pose_cache::begin_frame()
+{
+	m_last_hits = m_hits;
+	m_last_misses = m_misses;
+	m_last_bound = m_bound;
+	m_last_used = (int)m_used;
+	m_hits = 0;
+	m_misses = 0;
+	m_bound = clip_speed();
+
+	// Free the slots in use, the entries go back to the pool
+	for (size_t i = 0; i < m_used; ++i)
+		m_table[m_pool[i]->m_slot].m_entry = nullptr;
+	m_used = 0;
+}
+
+float pose_cache::quantize(float t) const
+{
+	return m_step > 0.0f ? glm::round(t / m_step) * m_step : t;
+}
+
+const dense_pose* pose_cache::sample(int model, int anim, float t, bool baked, bool nlerp, dense_pose& scratch)
+{
+	const animation& clip = g_resources.get_model_rsc(model).m_anims[anim];
+	float tq = quantize(t);
+
+	// Key: model (16 bits), clip (14 bits), sampling flags (2 bits), time step (32 bits).
+	// Without a step only instances at the exact same time share the pose
+	uint32_t tick = 0;
+	if (m_step > 0.0f)
+		tick = (uint32_t)(int64_t)glm::round(t / m_step);
+	else
+		std::memcpy(&tick, &tq, sizeof(tick));
+	uint64_t key = ((uint64_t)(model & 0xffff) << 48) | ((uint64_t)(anim & 0x3fff) << 34) |
+		((uint64_t)baked << 33) | ((uint64_t)nlerp << 32) | tick;
+
+	entry* e = nullptr;
+	unsigned n_joints = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Track the error bound of the clips in use
+		const clip_speed& speed = get_clip_speed(model, anim);
+		m_bound.m_rotation = glm::max(m_bound.m_rotation, speed.m_rotation);
+		m_bound.m_translation = glm::max(m_bound.m_translation, speed.m_translation);
+
+		if ((m_used + 1) * 2 > m_table.size())
+			grow_table();
+
+		slot& s = m_table[find_slot(key)];
+		if (s.m_entry)
+		{
+			// Still being sampled by another thread, sample a private copy
+			if (!s.m_entry->m_ready)
+			{
+				++m_misses;
+				n_joints = get_joint_count(model);
+			}
+			else
+			{
+				++m_hits;
+				return &s.m_entry->m_pose;
+			}
+		}
+		else
+		{
+			// Claim an entry of the pool
+			if (m_used == m_pool.size())
+			{
+				m_pool.emplace_back(new entry);
+				++m_allocations;
+			}
+			e = m_pool[m_used++].get();
+			e->m_ready = false;
+			e->m_slot = &s - m_table.data();
+			s.m_key = key;
+			s.m_entry = e;
+
+			++m_misses;
+			n_joints = get_joint_count(model);
+			if (e->m_pose.size() < n_joints)
+				++m_allocations;
+		}
+	}
+
+	// Sample outside the lock
+	if (!e)
+	{
+		sampling_context context;
+		int cursor = 1;
+		sample_clip(clip, tq, baked, nlerp, context, &cursor, n_joints, scratch);
+		return &scratch;
+	}
+
+	sample_clip(clip, tq, baked, nlerp, e->m_context, &e->m_cursor, n_joints, e->m_pose);
+	e->m_ready = true;
+	return &e->m_pose;
+}
+
+size_t pose_cache::find_slot(uint64_t key) const
+{
+	// Mix the bits so nearby ticks and clips spread over the table
+	uint64_t h = key * 0x9e3779b97f4a7c15ull;
+	size_t mask = m_table.size() - 1;
+	size_t i = (size_t)(h >> 32) & mask;
+	while (m_table[i].m_entry && m_table[i].m_key != key)
+		i = (i + 1) & mask;
+	return i;
+}
+
+void pose_cache::grow_table()
+{
+	std::vector<slot> old;
+	old.swap(m_table);
+	m_table.resize(old.empty() ? 64 : old.size() * 2);
+	++m_allocations;
+
+	for (size_t i = 0; i < m_used; ++i)
+	{
+		entry* e = m_pool[i].get();
+		size_t index = find_slot(old[e->m_slot].m_key);
+		m_table[index] = old[e->m_slot];
+		e->m_slot = index;
+	}
+}
+
+const pose_cache::clip_speed& pose_cache::get_clip_speed(int model, int anim)
+{
+	uint64_t key = ((uint64_t)model << 32) | (uint32_t)anim;
+	auto it = m_speeds.find(key);
+	if (it != m_speeds.end())
+		return it->second;
+
+	clip_speed& speed = m_speeds[key];
+	const animation& clip = g_resources.get_model_rsc(model).m_anims[anim];
+
+	// Fastest segment between two keys of each track
+	for (const auto& ch : clip.m_chanels)
+	{
+		const auto& sp = clip.m_samplers[ch.m_sampler];
+		size_t n_keys = sp.m_input.size();
+		for (size_t k = 1; k < n_keys; ++k)
+		{
+			float t0 = sp.m_input[k - 1];
+			float t1 = sp.m_input[k];
+			float dt = t1 - t0;
+			if (dt <= 0.0f)
+				continue;
+
+			if (ch.m_path_type == animation::channel::path_type::rotation)
+			{
+				float angle = quat_angle(ch.lerp_rot(t0, sp, true), ch.lerp_rot(t1, sp, true));
+				speed.m_rotation = glm::max(speed.m_rotation, angle / dt);
+			}
+			else if (ch.m_path_type == animation::channel::path_type::translation)
+			{
+				float dist = glm::length(ch.lerp_pos(t1, sp) - ch.lerp_pos(t0, sp));
+				speed.m_translation = glm::max(speed.m_translation, dist / dt);
+			}
+		}
+	}
+	return speed;
+}
+
+unsigned pose_cache::get_joint_count(int model)
+{
+	auto it = m_joint_counts.find(model);
+	if (it != m_joint_counts.end())
+		return it->second;
+
+	// One slot per gltf node
+	int n_joints = 0;
+	for (const auto& n : g_resources.get_model_rsc(model).m_nodes)
+		n_joints = glm::max(n_joints, n.first + 1);
+	m_joint_counts[model] = (unsigned)n_joints;
+	return (unsigned)n_joints;
+}
+
+void pose_cache::imgui()
+{
+	bool open = true;
+	ImGui::Begin("Pose Cache", &open, ImGuiWindowFlags_NoMove);
+
+	ImGui::Checkbox("Enabled", &m_enabled);
+
+	// Step in milliseconds
+	float step_ms = m_step * 1000.0f;
+	if (ImGui::SliderFloat("step (ms)", &step_ms, 0.0f, 50.0f))
+		m_step = step_ms / 1000.0f;
+
+	// Counters of the last frame
+	int total = m_last_hits + m_last_misses;
+	ImGui::Text("hits %d  misses %d  (%.1f%%)", m_last_hits, m_last_misses, total ? 100.0f * m_last_hits / total : 0.0f);
+	ImGui::Text("poses %d  (pool %d)", m_last_used, (int)m_pool.size());
+
+	// The sampled time is at most half a step away
+	float half_step = 0.5f * m_step;
+	ImGui::Text("time error <= %.2f ms", half_step * 1000.0f);
+	ImGui::Text("rotation error <= %.3f deg", glm::degrees(m_last_bound.m_rotation * half_step));
+	ImGui::Text("translation error <= %.4f", m_last_bound.m_translation * half_step);
+
+	ImGui::End();
+}
+}
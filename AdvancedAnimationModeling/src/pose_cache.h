@@ -0,0 +1,113 @@
+/**
+* @file pose_cache.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "pose.h"
+#include "resources.h"
+
+namespace cs460 {
+// Local poses sampled during the current frame, keyed by (model, clip, time).
+// Instances that play the same clip at the same time reuse the pose instead of
+// sampling it again. With a step the time is quantized first, so instances at
+// nearby times share too; every instance samples at the quantized time, so the
+// result does not depend on which one samples first. Without a step (the
+// default) playback is the same as with the cache off
+class pose_cache
+{
+public:
+	static pose_cache& get_instance();
+
+	// Drops the poses of the previous frame (keeps the memory)
+	void begin_frame();
+
+	// Returns the pose of the clip at time t. If another thread is still sampling
+	// it, the pose is sampled into scratch and scratch is returned
+	const dense_pose* sample(int model, int anim, float t, bool baked, bool nlerp, dense_pose& scratch);
+
+	// Time the cache samples at for time t
+	float quantize(float t) const;
+
+	bool enabled() const { return m_enabled; }
+	void set_enabled(bool enabled) { m_enabled = enabled; }
+	void set_step(float step) { m_step = step; }
+	float get_step() const { return m_step; }
+
+	// Counters of the current frame
+	int hits() const { return m_hits; }
+	int misses() const { return m_misses; }
+	int entries() const { return (int)m_used; }
+
+	// Entries, poses and table slots allocated since the start
+	int allocations() const { return m_allocations; }
+
+	// Settings and counters window
+	void imgui();
+
+private:
+	pose_cache() {}
+
+	struct entry
+	{
+		dense_pose m_pose;
+		sampling_context m_context;
+		int m_cursor = 1;
+		std::atomic<bool> m_ready;
+		size_t m_slot = 0;	// Slot of the table that points to the entry
+	};
+
+	// Slot of the open addressing table (free when the entry is null)
+	struct slot
+	{
+		uint64_t m_key = 0;
+		entry* m_entry = nullptr;
+	};
+
+	// Slot of the key, or the free slot where it goes
+	size_t find_slot(uint64_t key) const;
+
+	// Doubles the table and inserts the entries in use again
+	void grow_table();
+
+	// Fastest rotation and translation of a clip, used to bound the quantization error
+	struct clip_speed
+	{
+		float m_rotation = 0.0f;	// Radians per second
+		float m_translation = 0.0f;	// Units per second
+	};
+	const clip_speed& get_clip_speed(int model, int anim);
+	unsigned get_joint_count(int model);
+
+	bool m_enabled = true;
+	float m_step = 0.0f;
+
+	// Entries of the frame in a linear probing table at most half full. The
+	// table and the entries are kept across frames, so once the frame with the
+	// most poses has been seen the cache does not allocate
+	std::mutex m_mutex;
+	std::vector<slot> m_table;
+	std::vector<std::unique_ptr<entry>> m_pool;
+	size_t m_used = 0;
+	int m_allocations = 0;
+
+	// Per model data, filled the first time a model is sampled
+	std::unordered_map<uint64_t, clip_speed> m_speeds;
+	std::unordered_map<int, unsigned> m_joint_counts;
+
+	// Counters
+	int m_hits = 0;
+	int m_misses = 0;
+	int m_last_hits = 0;
+	int m_last_misses = 0;
+	int m_last_used = 0;
+	clip_speed m_bound;
+	clip_speed m_last_bound;
+};
+
+#define g_pose_cache pose_cache::get_instance()
+}
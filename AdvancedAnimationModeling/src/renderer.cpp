@@ -253,7 +253,7 @@ void renderer::set_primitve_uniforms(const int model_idx, const primitive& prim)
 		m_shader->SetUniform("u_use_normal_map", false);
 }
 
-void renderer::skinning(int model_idx, int model_inst, const mesh_comp* m)
+void renderer::skinning(int model_idx, int instance, const mesh_comp* m)
 {
 	// Get the skin index
 	int skin_idx = m->get_skin();
@@ -268,8 +268,11 @@ void renderer::skinning(int model_idx, int model_inst, const mesh_comp* m)
 	// Get the skin
 	const skin& skin = g_resources.get_model_skin(model_idx, skin_idx);
 
+	// Nodes of the instance indexed by gltf node
+	const std::vector<node*>& nodes = g_scene.get_instance_nodes(instance);
+
 	// Get the world to model of the skin root node
-	const node* root_node = g_scene.get_model_node(model_idx, model_inst, m->get_skin_root());
+	const node* root_node = nodes[m->get_skin_root()];
 	glm::mat4 w2m_root = root_node->m_local.compute_matrix() * root_node->m_world.compute_inv_matrix();
 
 	// Compute joint matrices
@@ -281,7 +284,7 @@ void renderer::skinning(int model_idx, int model_inst, const mesh_comp* m)
 
 		// Get the model to world mtx of the current joint
 		int node_idx = skin.m_joints[i];
-		const node* joint_node = g_scene.get_model_node(model_idx, model_inst, node_idx);
+		const node* joint_node = nodes[node_idx];
 		glm::mat4 m2w_joint = joint_node->m_world.compute_matrix();
 
 		// Joint matrix
@@ -295,7 +298,7 @@ void renderer::skinning(int model_idx, int model_inst, const mesh_comp* m)
 	m_shader->SetUniform("u_skinned", true);
 }
 
-void renderer::render_mesh(const glm::mat4& world_matrix, int model_idx, int model_inst, const mesh_comp* m)
+void renderer::render_mesh(const glm::mat4& world_matrix, int model_idx, int instance, const mesh_comp* m)
 {
 	// Set the m2w matrix
 	set_world_matrix(world_matrix);
@@ -304,7 +307,7 @@ void renderer::render_mesh(const glm::mat4& world_matrix, int model_idx, int mod
 	const mesh& mesh = g_resources.get_model_mesh(model_idx, m->get_mesh());
 
 	// Compute joint matrices if necessary
-	skinning(model_idx, model_inst, m);
+	skinning(model_idx, instance, m);
 
 	// Render each primitive
 	size_t n_primitives = mesh.m_primitives.size();
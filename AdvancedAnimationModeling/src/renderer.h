@@ -36,7 +36,8 @@ public:
 	// Returns the main and only window
 	const window& get_window() { return m_window; };
 
-	void render_mesh(const glm::mat4& world_matrix, int model_idx, int model_inst, const mesh_comp* m);
+	// The instance is the registry handle of the model instance that owns the mesh (node::m_instance)
+	void render_mesh(const glm::mat4& world_matrix, int model_idx, int instance, const mesh_comp* m);
 
 	shader* get_shader() { return m_shader; }
 
@@ -67,7 +68,7 @@ private:
 	
 	void set_world_matrix(const glm::mat4& world_matrix);
 	void set_primitve_uniforms(const int model_idx, const primitive& prim);
-	void skinning(int model_idx, int model_inst, const mesh_comp* m);
+	void skinning(int model_idx, int instance, const mesh_comp* m);
 	
 	// Main shader program
 	shader* m_shader;
@@ -9,6 +9,8 @@
 #include <imgui.h>
 #include "scene_graph.h"
 #include <iostream>
+#include <algorithm>
+#include "compression.h"
 
 namespace cs460 {
 resources& resources::get_instance()
@@ -222,30 +224,26 @@ void primitive::set_attribute_pointer(unsigned int vbo, int attrib_idx, int size
 	glBindVertexArray(0);
 }
 
-glm::vec3 animation::channel::lerp_pos(float t, const sampler& sp) const
+glm::vec3 animation::channel::lerp_pos(float t, const sampler& sp, int* cursor) const
 {
 	// Normalized t
 	int start, end;
-	float tn = sp.lerp(t, &start, &end);
+	float tn = sp.lerp(t, &start, &end, cursor);
 
 	if (tn < 0)
 		return glm::vec3(0.0f);
 
 	// Get the segment
-	const unsigned char* data = reinterpret_cast<const unsigned char*>(
-		sp.m_output.data());
-	const glm::vec3* p0 = reinterpret_cast<const glm::vec3*>(
-		data + start * sizeof(glm::vec3));
-	const glm::vec3* p1 = reinterpret_cast<const glm::vec3*>(
-		data + end * sizeof(glm::vec3));
+	glm::vec3 p0 = sp.get_vec3(start);
+	glm::vec3 p1 = sp.get_vec3(end);
 
 	// Linear interpolation
 	if (sp.m_lerp_mode == sampler::lerp_mode::linear)
-		return *p0 + (*p1 - *p0) * tn;
+		return p0 + (p1 - p0) * tn;
 
 	// Step
 	else if (sp.m_lerp_mode == sampler::lerp_mode::step)
-		return *p0;
+		return p0;
 
 	else
 	{
@@ -254,27 +252,23 @@ glm::vec3 animation::channel::lerp_pos(float t, const sampler& sp) const
 	}
 }
 
-glm::quat animation::channel::lerp_rot(float t, const sampler& sp, bool normalize) const
+glm::quat animation::channel::lerp_rot(float t, const sampler& sp, bool normalize, int* cursor) const
 {
 	// Normalized t
 	int start, end;
-	float tn = sp.lerp(t, &start, &end);
+	float tn = sp.lerp(t, &start, &end, cursor);
 
 	if (tn < 0)
 		return glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
 
 	// Get the segment
-	const unsigned char* data = reinterpret_cast<const unsigned char*>(
-		sp.m_output.data());
-	const glm::quat* p0 = reinterpret_cast<const glm::quat*>(
-		data + start * sizeof(glm::quat));
-	const glm::quat* p1 = reinterpret_cast<const glm::quat*>(
-		data + end * sizeof(glm::quat));
+	glm::quat p0 = sp.get_quat(start);
+	glm::quat p1 = sp.get_quat(end);
 
 	// Linear interpolation
 	if (sp.m_lerp_mode == sampler::lerp_mode::linear)
 	{
-		glm::quat res = glm::slerp(*p0, *p1, tn);
+		glm::quat res = glm::slerp(p0, p1, tn);
 
 		// Nlerp
 		if (normalize)
@@ -287,7 +281,7 @@ glm::quat animation::channel::lerp_rot(float t, const sampler& sp, bool normaliz
 
 	// Step
 	else if (sp.m_lerp_mode == sampler::lerp_mode::step)
-		return *p0;
+		return p0;
 
 	else
 	{
@@ -296,41 +290,127 @@ glm::quat animation::channel::lerp_rot(float t, const sampler& sp, bool normaliz
 	}
 }
 
-float animation::sampler::lerp(float t, int* start, int* end) const
+glm::vec3 animation::sampler::get_vec3(int key) const
+{
+	// Decode the range reduced key
+	if (m_quantized)
+	{
+		const uint16_t* k = m_packed.data() + key * 3;
+		return m_range_min + glm::vec3(k[0], k[1], k[2]) * m_range_scale;
+	}
+
+	return *reinterpret_cast<const glm::vec3*>(m_output.data() + key * 3);
+}
+
+glm::quat animation::sampler::get_quat(int key) const
+{
+	// Decode the smallest three key
+	if (m_quantized)
+		return unpack_quat(m_packed.data() + key * 3);
+
+	return *reinterpret_cast<const glm::quat*>(m_output.data() + key * 4);
+}
+
+float animation::sampler::lerp(float t, int* start, int* end, int* cursor) const
+{
+	// Resampled tracks index the keys directly
+	if (m_rate > 0.0f)
+		return lerp_fixed(m_rate, m_input.size(), t, start, end);
+
+	return lerp_keys(m_input, t, start, end, cursor);
+}
+
+// Returns the first key whose time is not less than t (t is inside the input range)
+static int find_key(const std::vector<float>& input, float t, int* cursor)
+{
+	const int max_steps = 4;
+	int last = (int)input.size() - 1;
+
+	if (cursor)
+	{
+		int frame_idx = glm::clamp(*cursor, 1, last);
+
+		// Step forwards from the previous key
+		int steps = 0;
+		while (t > input[frame_idx] && steps < max_steps)
+		{
+			++frame_idx;
+			++steps;
+		}
+
+		// Step backwards from the previous key
+		while (t <= input[frame_idx - 1] && steps < max_steps)
+		{
+			--frame_idx;
+			++steps;
+		}
+
+		// Found the segment close to the previous one
+		if (t <= input[frame_idx] && t > input[frame_idx - 1])
+		{
+			*cursor = frame_idx;
+			return frame_idx;
+		}
+	}
+
+	// Seek or loop wrap: binary search the segment
+	auto it = std::lower_bound(input.begin() + 1, input.end(), t);
+	int frame_idx = (int)(it - input.begin());
+
+	if (cursor)
+		*cursor = frame_idx;
+
+	return frame_idx;
+}
+
+float lerp_keys(const std::vector<float>& input, float t, int* start, int* end, int* cursor)
 {
 	// Get the number of points
-	size_t n_points = m_input.size();
+	size_t n_points = input.size();
 	if (n_points == 0)
 		return -1;
 
 	// Cap lerp output
-	if (t < m_input[0])
+	if (t <= input[0] || n_points == 1)
 	{
 		*start = 0;
 		*end = 0;
 		return 0.0f;
 	}
-	else if (t > m_input[n_points - 1])
+	else if (t > input[n_points - 1])
 	{
 		*start = (int)n_points - 1;
 		*end = *start;
 		return 0.0f;
 	}
 
-	int frame_idx = 1;
-	while (t > m_input[frame_idx])
-		++frame_idx;
+	int frame_idx = find_key(input, t, cursor);
 
 	// Get the segment
 	*start = frame_idx - 1;
 	*end = frame_idx;
 
 	// Normalize the t parameter
-	float interval = m_input[frame_idx] - m_input[frame_idx - 1];
-	float local_time = t - m_input[frame_idx - 1];
+	float interval = input[frame_idx] - input[frame_idx - 1];
+	float local_time = t - input[frame_idx - 1];
 	float tn = local_time / interval;
 
 	// Linear interpolation
 	return tn;
 }
+
+float lerp_fixed(float rate, size_t n_keys, float t, int* start, int* end)
+{
+	if (n_keys == 0)
+		return -1;
+
+	// Key index straight from the time, clamped to the clip range
+	int last = (int)n_keys - 1;
+	float ft = glm::clamp(t * rate, 0.0f, (float)last);
+	int key = glm::min((int)ft, glm::max(last - 1, 0));
+
+	*start = key;
+	*end = glm::min(key + 1, last);
+	return ft - (float)key;
+}
 }
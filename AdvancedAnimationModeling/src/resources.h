@@ -6,9 +6,11 @@
 */
 #pragma once
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
 #include <glm/glm.hpp>
 #include "transform.h"
+#include "baked_clip.h"
 #include <string>
 
 namespace cs460 {
@@ -70,6 +72,14 @@ struct skin
 	std::vector<int> m_joints;
 };
 
+// Finds the keyframe segment [start, end] of the input times that contains t and
+// returns the normalized time inside it. The search starts from the cursor if given
+float lerp_keys(const std::vector<float>& input, float t, int* start, int* end, int* cursor = nullptr);
+
+// Same as lerp_keys for n_keys spaced 1/rate apart starting at 0. The segment is
+// found directly from the time, without searching
+float lerp_fixed(float rate, size_t n_keys, float t, int* start, int* end);
+
 struct animation
 {
 	struct sampler
@@ -78,7 +88,24 @@ struct animation
 		lerp_mode m_lerp_mode;
 		std::vector<float> m_input;
 		std::vector<float> m_output;
-		float lerp(float t, int* start, int* end) const;
+
+		// Keys are spaced 1/m_rate apart starting at 0 (0 if not resampled)
+		float m_rate = 0.0f;
+
+		// Quantized keys (3 x 16 bits each) that replace m_output once compressed.
+		// Rotations are smallest three quaternions, vectors are m_range_min + u * m_range_scale
+		bool m_quantized = false;
+		std::vector<uint16_t> m_packed;
+		glm::vec3 m_range_min = glm::vec3(0.0f);
+		glm::vec3 m_range_scale = glm::vec3(0.0f);
+
+		// Returns the given key of a translation/scale or rotation track
+		glm::vec3 get_vec3(int key) const;
+		glm::quat get_quat(int key) const;
+
+		// Returns the normalized time inside the keyframe segment [start, end].
+		// If a cursor is given, the search starts from the key it remembers
+		float lerp(float t, int* start, int* end, int* cursor = nullptr) const;
 	};
 
 	struct channel
@@ -88,16 +115,38 @@ struct animation
 		path_type m_path_type;
 		int m_sampler;
 
-		glm::vec3 lerp_pos(float t, const sampler& sp) const;
-		glm::quat lerp_rot(float t, const sampler& sp, bool normalize) const;
+		glm::vec3 lerp_pos(float t, const sampler& sp, int* cursor = nullptr) const;
+		glm::quat lerp_rot(float t, const sampler& sp, bool normalize, int* cursor = nullptr) const;
 	};
 
 	std::vector<channel> m_chanels;
 	std::vector<sampler> m_samplers;
+	baked_clip m_baked;
 	float m_max_time = 0.0f;
+
+	// The linear tracks were resampled to m_sample_rate at import
+	bool m_fixed_rate = false;
+	float m_sample_rate = 0.0f;
 	std::string m_name;
 };
 
+// Remembers the last keyframe sampled by each channel of an animation, so
+// consecutive samples only step from the previous key instead of searching
+struct sampling_context
+{
+	// Resizes the context for an animation with the given number of channels
+	void reset(size_t n_channels) { m_cursors.assign(n_channels, 1); }
+
+	// Returns the cursor of the given channel (resets it if the animation changed)
+	int* get_cursor(const animation& anim, size_t channel) {
+		if (m_cursors.size() != anim.m_chanels.size())
+			reset(anim.m_chanels.size());
+		return &m_cursors[channel];
+	}
+
+	std::vector<int> m_cursors;
+};
+
 struct model_rsc
 {
 	model_rsc();
@@ -172,6 +221,9 @@ public:
 		return m_model_registry.at(name);
 	}
 
+	// Returns the number of loaded models
+	int model_count() const { return (int)m_models.size(); }
+
 private:
 	std::vector<model_rsc> m_models;
 	std::unordered_map<std::string, int> m_model_registry;
@@ -15,6 +15,7 @@
 #include <imgui.h>
 #include "shader.h"
 #include <glm/gtx/rotate_vector.hpp>
+#include <algorithm>
 #include "editor.h"
 #include "curves.h"
 #include "loader.h"
@@ -23,6 +24,9 @@
 #include "2_bone_ik.h"
 #include "inverse_kinematics.h"
 #include "curve_node_comp.h"
+#include "animation_system.h"
+#include "clock.h"
+#include "job_system.h"
 
 namespace cs460 {
 scene_graph& scene_graph::get_instance()
@@ -34,7 +38,7 @@ scene_graph& scene_graph::get_instance()
 // Returns a reference to the main camera
 camera& scene_graph::get_camera()
 {
-	return *m_camera_node->get_component<camera>();
+	return *m_camera;
 }
 
 // Update node transforms
@@ -92,6 +96,10 @@ void scene_graph::update()
 		}
 	}
 
+	// Update all the animated instances in one pass
+	g_animation_system.set_view(get_camera().get_world_to_projection());
+	g_animation_system.update(g_clock.dt());
+
 	// Update nodes
 	update_nodes();
 
@@ -102,8 +110,11 @@ void scene_graph::update()
 // Render all nodes that reference a mesh
 void scene_graph::render()
 {
-	if (m_root)
-		render_rec(m_root);
+	// Every mesh component, without walking the nodes
+	component_pool<mesh_comp>::get_instance().for_each([](mesh_comp& m) {
+		node* owner = m.get_owner();
+		g_renderer.render_mesh(owner->m_world.compute_matrix(), owner->m_model, owner->m_instance, &m);
+	});
 }
 
 void scene_graph::imgui()
@@ -132,17 +143,31 @@ void scene_graph::imgui()
 	if (ImGui::SliderFloat("pitch", &m_pitch_angle, -89.0f, 89.0f))
 		g_renderer.get_shader()->SetUniform("u_light_dir", rotate_light());
 
+	ImGui::Separator();
+	ImGui::Text("Job System");
+	int n_threads = (int)g_jobs.thread_count();
+	if (ImGui::SliderInt("threads", &n_threads, 1, 16))
+		g_jobs.set_thread_count((unsigned)n_threads);
+
+	// Counters of the last frame
+	ImGui::Separator();
+	ImGui::Text("Transforms");
+	ImGui::Text("%u nodes, %u world transforms recomputed", g_transforms.size(), g_transforms.recomputed());
+
 	ImGui::End();
 }
 
 void scene_graph::render_bvs()
 {
-	render_bvs_rec(m_root);
+	component_pool<mesh_comp>::get_instance().for_each([](mesh_comp& m) { m.render_vb(); });
 }
 
 void scene_graph::render_skins()
 {
-	render_skins_rec(m_root);
+	component_pool<mesh_comp>::get_instance().for_each([](mesh_comp& m) {
+		if (m.get_skin() >= 0)
+			m.render_skin();
+	});
 }
 
 // Delete all nodes that are below the given node in the hierarchy
@@ -261,11 +286,25 @@ scene_graph::scene_graph()
 	: m_root(new node)
 {
 	m_root->m_name = "Root Node";
+	m_root->m_in_scene = true;
+
+	// Components update by type, in the order the pools are created. Create them in
+	// the order the scenes relied on: the camera first, then the player controllers
+	// that move it, the curves and the IK chains
+	component_pool<camera>::get_instance();
+	component_pool<player_controller>::get_instance();
+	component_pool<linear_curve>::get_instance();
+	component_pool<hermite_curve>::get_instance();
+	component_pool<catmull_rom_curve>::get_instance();
+	component_pool<bezier_curve>::get_instance();
+	component_pool<ik_2d>::get_instance();
+	component_pool<ccd>::get_instance();
+	component_pool<fabrik>::get_instance();
 
 	// Create a node with a camera component
 	node* cam = new node;
 	cam->m_name = "camera";
-	cam->add_component<camera>();
+	m_camera = cam->add_component<camera>();
 	m_camera_node = cam;
 	
 	// Make the camera node a child of the root node
@@ -299,84 +338,19 @@ void scene_graph::reset_scene_rec(node* node)
 		reset_scene_rec(node->m_children[i]);
 }
 
-void scene_graph::render_bvs_rec(node* node)
-{
-	// Render children
-	size_t n_children = node->m_children.size();
-	for (size_t i = 0; i < n_children; ++i)
-		render_bvs_rec(node->m_children[i]);
-
-	// Render the node's bv
-	if (mesh_comp* m = node->get_component<mesh_comp>())
-		m->render_vb();
-}
-
-void scene_graph::render_skins_rec(node* node)
-{
-	// Render skin of the node
-	if (mesh_comp* m = node->get_component<mesh_comp>())
-	{
-		int skin_idx = m->get_skin();
-		if (skin_idx >= 0)
-			m->render_skin();
-	}
-
-	// Render children
-	size_t n_children = node->m_children.size();
-	for (size_t i = 0; i < n_children; ++i)
-		render_skins_rec(node->m_children[i]);
-}
-
 void scene_graph::update_nodes()
 {
-	update_nodes_rec(m_root);
-}
-
-void scene_graph::update_nodes_rec(node* node)
-{
-	// Update components
-	node->update();
-
-	// Update each child
-	size_t n_childs = node->m_children.size();
-	for (size_t i = 0; i < n_childs; ++i)
-		update_nodes_rec(node->m_children[i]);
-}
-
-// Recursive function. Concatenates the transforms of the nodes in the scene
-void scene_graph::update_node_transforms_rec(node* node, const transform& parent_world)
-{
-	// Concatenate node's world transform
-	node->m_world = parent_world.concatenate(node->m_local);
-
-	// Update each child
-	size_t n_childs = node->m_children.size();
-	for (size_t i = 0; i < n_childs; ++i)
-		update_node_transforms_rec(node->m_children[i], node->m_world);
+	// Each pool updates its components, pools of types without an update are skipped
+	g_component_pools.update_all();
 }
 
 void scene_graph::update_node_transforms()
 {
-	update_node_transforms_rec(m_root, transform());
-}
-
-// Recursive function. Sends the nodes that reference a mesh to the renderer
-void scene_graph::render_rec(node* node)
-{
-	// Render the node
-	if (mesh_comp* m = node->get_component<mesh_comp>())
-	{
-		// Draw the mesh
-		g_renderer.render_mesh(node->m_world.compute_matrix(), node->m_model, node->m_model_inst, m);
-	}
-
-	// Render the childs
-	size_t n_childs = node->m_children.size();
-	for (size_t i = 0; i < n_childs; ++i)
-		render_rec(node->m_children[i]);
+	// Parents come before their children, so every world transform is ready when read
+	g_transforms.update_world();
 }
 
-void scene_graph::create_model_instance_rec(std::unordered_map<node_id, node*>& node_reg, const int inst_id, const int model_id, node* parent, const std::vector<int>& child_idxs)
+void scene_graph::create_model_instance_rec(const int instance, const int inst_id, const int model_id, node* parent, const std::vector<int>& child_idxs)
 {
 	// Get the child nodes
 	const auto& child_nodes = g_resources.get_model_rsc(model_id).m_nodes;
@@ -392,7 +366,7 @@ void scene_graph::create_model_instance_rec(std::unordered_map<node_id, node*>&
 
 		// Register the child
 		int child_idx = child_idxs[i];
-		node_reg[child_idx] = child;
+		m_node_registry.set_node(instance, child_idx, child);
 
 		// Set the data
 		child->m_name = std::to_string(model_id) + std::to_string(inst_id) + std::to_string(child_idx);
@@ -402,6 +376,7 @@ void scene_graph::create_model_instance_rec(std::unordered_map<node_id, node*>&
 		child->m_model = model_id;
 		child->m_node_idx = child_idx;
 		child->m_model_inst = inst_id;
+		child->m_instance = instance;
 		child->m_local = data.m_local;
 
 		if (data.m_mesh >= 0)
@@ -410,44 +385,70 @@ void scene_graph::create_model_instance_rec(std::unordered_map<node_id, node*>&
 		// Add the child to the parent
 		parent->add_child(child);
 
-		create_model_instance_rec(node_reg, inst_id, model_id, child, data.m_childs);
+		create_model_instance_rec(instance, inst_id, model_id, child, data.m_childs);
 	}
 }
 
 node* scene_graph::create_model_instance(const int model_id)
 {
-	// Get the instances of the model
-	auto& model_instances = m_node_registry[model_id];
+	// Get the model
+	const model_rsc& model = g_resources.get_model_rsc(model_id);
+
+	// Create the instance of the model in the registry, sized for the largest node index
+	int n_nodes = 0;
+	for (const auto& n : model.m_nodes)
+		n_nodes = glm::max(n_nodes, n.first + 1);
+	int instance = m_node_registry.create_instance(model_id, n_nodes);
 
 	// Get the new instance id
-	int inst_id = (int)model_instances.size();
+	int inst_id = m_node_registry.get_instance_index(instance);
 
-	// Create the instance of the model in the registry
-	model_instances.emplace_back();
-	
 	// Create the root node
 	node* instance_root = new node;
 	instance_root->m_model = model_id;
 	instance_root->m_model_inst = inst_id;
+	instance_root->m_instance = instance;
 	instance_root->m_name = "Model " + std::to_string(model_id) + ", Inst " + std::to_string(inst_id) + " Root Node";
-	
-	// Get the model
-	const model_rsc& model = g_resources.get_model_rsc(model_id);
 
 	// Add an animation comp to the root node
+	anim_comp* anim = nullptr;
 	if (model.m_anims.empty() == false)
-		instance_root->add_component<anim_comp>()->set_animation(0);
+	{
+		anim = instance_root->add_component<anim_comp>();
+		anim->set_animation(0);
+	}
 
 	m_root->add_child(instance_root);
 
-	create_model_instance_rec(model_instances[inst_id], inst_id, model_id, instance_root, model.m_root_nodes);
+	create_model_instance_rec(instance, inst_id, model_id, instance_root, model.m_root_nodes);
+
+	// Bind the animation to the nodes of the instance
+	if (anim)
+		anim->bind_nodes(m_node_registry.get_nodes(instance));
 
 	return instance_root;
 }
 
+void scene_graph::destroy_model_instance(node* instance_root)
+{
+	// Detach the instance
+	if (node* parent = instance_root->m_parent)
+	{
+		std::vector<node*>& siblings = parent->m_children;
+		siblings.erase(std::find(siblings.begin(), siblings.end(), instance_root));
+	}
+	instance_root->set_in_scene(false);
+
+	int instance = instance_root->m_instance;
+	g_editor.remove_selection();
+	destroy_rec(instance_root);
+	if (instance >= 0)
+		m_node_registry.destroy_instance(instance);
+}
+
 node* scene_graph::get_model_node(const int model_idx, const int instance_idx, const int node_idx)
 {
-	return m_node_registry.at(model_idx).at(instance_idx).at(node_idx);
+	return m_node_registry.find_node(m_node_registry.find_instance(model_idx, instance_idx), node_idx);
 }
 
 glm::vec3 scene_graph::rotate_light()
@@ -656,9 +657,9 @@ void scene_graph::change_scene(const scene_type st)
 		f1->clear_joints();
 		f1->render_bones(false);
 		f1->show_gui(false);
-		f1->add_joint(g_scene.get_model_node(c->m_model, c->m_model_inst, 17));
-		f1->add_joint(g_scene.get_model_node(c->m_model, c->m_model_inst, 18));
-		f1->add_joint(g_scene.get_model_node(c->m_model, c->m_model_inst, 19));
+		f1->add_joint(get_instance_node(c->m_instance, 17));
+		f1->add_joint(get_instance_node(c->m_instance, 18));
+		f1->add_joint(get_instance_node(c->m_instance, 19));
 
 		g_editor.set_selected_node(ik);
 		g_editor.set_picking(false);
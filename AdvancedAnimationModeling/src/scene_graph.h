@@ -7,18 +7,13 @@
 #pragma once
 #include <glm/glm.hpp>
 #include "resources.h"
-#include <unordered_map>
+#include "node_registry.h"
 #include <vector>
 
 namespace cs460 {
 class component;
 class camera;
 struct node;
-class transform;
-
-typedef int model_id;
-typedef int node_id;
-typedef std::unordered_map<model_id, std::vector<std::unordered_map<node_id, node*>>> node_registry;
 
 class scene_graph
 {
@@ -56,8 +51,22 @@ public:
 	// Creates an instance of a model
 	node* create_model_instance(const int model_id);
 
+	// Frees all the nodes of a model instance, its node and registry slots are reused by the next instances
+	void destroy_model_instance(node* instance_root);
+
+	// Node of a model instance from the instance index of the model, null if the
+	// instance or the node is missing. Looks up the instance first, get_instance_node
+	// is faster in loops
 	node* get_model_node(const int model_idx, const int instance_idx, const int node_idx);
 
+	// Node of a model instance from its registry handle (node::m_instance) and gltf node index.
+	// Unchecked, for the skinning and IK paths that already hold a valid handle
+	node* get_instance_node(const int instance, const int node_idx) const { return m_node_registry.get_node(instance, node_idx); }
+	const std::vector<node*>& get_instance_nodes(const int instance) const { return m_node_registry.get_nodes(instance); }
+
+	// Instances of the model alive in the scene
+	int model_instance_count(const int model_id) const { return m_node_registry.instance_count(model_id); }
+
 	enum class scene_type { 
 		curves, skinned_models, animation, 
 		anim_blending_1d, directional_movement, anim_blending_2d, targeted_movement,
@@ -73,7 +82,7 @@ public:
 
 	void render_grid(bool render) { m_render_grid = render; }
 
-	// Updates the world transform of all nodes
+	// Updates the world transform of all nodes in one pass over the transform hierarchy
 	void update_node_transforms();
 
 private:
@@ -87,24 +96,14 @@ private:
 	void reset_scene();
 	void reset_scene_rec(node* node);
 
-	// Renders the bounding volume of all nodes that reference a mesh
-	void render_bvs_rec(node* node);
-	void render_skins_rec(node* node);
-
 	// Updates the components of all nodes
 	void update_nodes();
-	void update_nodes_rec(node* node);
-
-	// Updates the world transform of all nodes
-	void update_node_transforms_rec(node* node, const transform& parent_world);
-
-	// Renders all nodes that reference a mesh
-	void render_rec(node* node);
 
-	void create_model_instance_rec(std::unordered_map<node_id, node*>& node_reg, const int inst_id, const int model, node* parent, const std::vector<int>& child_idxs);
+	void create_model_instance_rec(const int instance, const int inst_id, const int model, node* parent, const std::vector<int>& child_idxs);
 
 	node* m_root = nullptr;
 	node* m_camera_node = nullptr;
+	camera* m_camera = nullptr;
 	
 	// Lighting parameters of the scene
 	glm::vec3 m_light_color = glm::vec3(1.0f);
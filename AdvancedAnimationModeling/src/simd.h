@@ -0,0 +1,134 @@
+/**
+* @file simd.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC compiles any intrinsic without special flags, gcc and clang need the
+// instruction set enabled per function so the rest of the file stays portable
+#if defined(SIMD_X86) && !defined(_MSC_VER)
+#define SIMD_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SIMD_TARGET_SSE4
+#define SIMD_TARGET_AVX2
+#endif
+
+namespace cs460 {
+enum class simd_level { scalar, sse4, avx2 };
+
+// Returns the widest instruction set supported by the cpu
+inline simd_level detect_simd_level()
+{
+#if defined(SIMD_X86)
+	int regs[4] = { 0 };
+
+	// Leaf 1: sse4.1 (ecx bit 19), fma (ecx bit 12), osxsave (ecx bit 27), avx (ecx bit 28)
+#if defined(_MSC_VER)
+	__cpuid(regs, 1);
+#else
+	__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	bool sse4 = (regs[2] & (1 << 19)) != 0;
+	bool fma = (regs[2] & (1 << 12)) != 0;
+	bool avx = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0;
+
+	// Check that the os saves the ymm registers
+	if (avx)
+	{
+#if defined(_MSC_VER)
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		unsigned long long xcr0 = ((unsigned long long)edx << 32) | eax;
+#endif
+		avx = (xcr0 & 6) == 6;
+	}
+
+	// Leaf 7: avx2 (ebx bit 5)
+#if defined(_MSC_VER)
+	__cpuidex(regs, 7, 0);
+#else
+	__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	bool avx2 = (regs[1] & (1 << 5)) != 0;
+
+	if (avx && avx2 && fma)
+		return simd_level::avx2;
+	if (sse4)
+		return simd_level::sse4;
+#endif
+	return simd_level::scalar;
+}
+
+// Returns the instruction set used by the simd kernels (detected once)
+inline simd_level& get_simd_level()
+{
+	static simd_level level = detect_simd_level();
+	return level;
+}
+
+inline const char* simd_level_name(simd_level level)
+{
+	if (level == simd_level::avx2)
+		return "avx2";
+	if (level == simd_level::sse4)
+		return "sse4";
+	return "scalar";
+}
+
+// Allocator for containers that are read with aligned simd loads
+template <typename T, size_t alignment = 32>
+struct aligned_allocator
+{
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind { typedef aligned_allocator<U, alignment> other; };
+
+	aligned_allocator() {}
+	template <typename U>
+	aligned_allocator(const aligned_allocator<U, alignment>&) {}
+
+	T* allocate(size_t n)
+	{
+		size_t bytes = (n * sizeof(T) + alignment - 1) / alignment * alignment;
+#if defined(_MSC_VER)
+		void* ptr = _aligned_malloc(bytes, alignment);
+#else
+		void* ptr = std::aligned_alloc(alignment, bytes);
+#endif
+		if (!ptr)
+			throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+
+	void deallocate(T* ptr, size_t)
+	{
+#if defined(_MSC_VER)
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+
+	template <typename U>
+	bool operator==(const aligned_allocator<U, alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const aligned_allocator<U, alignment>&) const { return false; }
+};
+}
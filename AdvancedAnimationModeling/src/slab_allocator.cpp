@@ -0,0 +1,46 @@
+/**
+* @file slab_allocator.cpp
+* @date 2026/10/17
+*/
+#include "slab_allocator.h"
+
+namespace cs460 {
+slab_allocator::slab_allocator(size_t slot_size, size_t slots_per_block)
+	: m_slots_per_block(slots_per_block)
+{
+	// Room for the free list link and aligned like anything new returns
+	const size_t align = alignof(std::max_align_t);
+	if (slot_size < sizeof(free_slot))
+		slot_size = sizeof(free_slot);
+	m_slot_size = (slot_size + align - 1) / align * align;
+}
+
+void* slab_allocator::allocate()
+{
+	if (!m_free)
+	{
+		// New block, its slots are linked in address order
+		char* block = new char[m_slot_size * m_slots_per_block];
+		m_blocks.emplace_back(block);
+		for (size_t i = m_slots_per_block; i-- > 0;)
+		{
+			free_slot* slot = reinterpret_cast<free_slot*>(block + i * m_slot_size);
+			slot->m_next = m_free;
+			m_free = slot;
+		}
+	}
+
+	free_slot* slot = m_free;
+	m_free = slot->m_next;
+	m_size++;
+	return slot;
+}
+
+void slab_allocator::release(void* slot)
+{
+	free_slot* s = static_cast<free_slot*>(slot);
+	s->m_next = m_free;
+	m_free = s;
+	m_size--;
+}
+}
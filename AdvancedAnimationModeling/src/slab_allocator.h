@@ -0,0 +1,37 @@
+/**
+* @file slab_allocator.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace cs460 {
+// Hands out fixed size slots carved from large blocks. Released slots go to a
+// free list and are handed out again before a new block is allocated, so
+// creating and destroying objects does not go through the heap once warm.
+// Not thread safe, objects are created and destroyed by the main thread
+class slab_allocator
+{
+public:
+	slab_allocator(size_t slot_size, size_t slots_per_block);
+
+	void* allocate();
+	void release(void* slot);
+
+	// Slots in use and slots allocated
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_blocks.size() * m_slots_per_block; }
+
+private:
+	// A free slot stores the next free slot
+	struct free_slot { free_slot* m_next; };
+
+	size_t m_slot_size;
+	size_t m_slots_per_block;
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	free_slot* m_free = nullptr;
+	size_t m_size = 0;
+};
+}
@@ -0,0 +1,276 @@
+/**
+* @file transform_hierarchy.cpp
+* @date 2026/10/17
+*/
+#include "transform_hierarchy.h"
+#include "job_system.h"
+#include <imgui.h>
+#include <atomic>
+
+namespace cs460 {
+transform_hierarchy& transform_hierarchy::get_instance()
+{
+	static transform_hierarchy t;
+	return t;
+}
+
+int transform_hierarchy::create()
+{
+	// Reuse a free handle
+	int handle = (int)m_slots.size();
+	if (!m_free_handles.empty())
+	{
+		handle = m_free_handles.back();
+		m_free_handles.pop_back();
+	}
+	else
+		m_slots.push_back(-1);
+
+	// New slots are roots, so they can go at the end
+	m_slots[handle] = (int)m_parents.size();
+	m_depths_valid = false;
+	m_handles.push_back(handle);
+	m_parents.push_back(-1);
+	m_dirty.push_back(1);
+	m_changed.push_back(0);
+	for (trs_arrays& a : m_trs)
+	{
+		a.m_positions.push_back(glm::vec3(0.0f));
+		a.m_rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		a.m_scales.push_back(glm::vec3(1.0f));
+	}
+	return handle;
+}
+
+void transform_hierarchy::destroy(int handle)
+{
+	// The slot is removed the next time the slots are sorted
+	m_handles[m_slots[handle]] = -1;
+	m_slots[handle] = -1;
+	m_free_handles.push_back(handle);
+	m_dead++;
+	m_sorted = false;
+}
+
+void transform_hierarchy::set_parent(int handle, int parent)
+{
+	int slot = m_slots[handle];
+	int parent_slot = parent < 0 ? -1 : m_slots[parent];
+	m_parents[slot] = parent_slot;
+	m_dirty[slot] = 1;
+	m_depths_valid = false;
+
+	// Only this link can break the order, the children of the slot are still after it
+	if (parent_slot > slot)
+		m_sorted = false;
+}
+
+int transform_hierarchy::get_parent(int handle) const
+{
+	int parent_slot = m_parents[m_slots[handle]];
+	return parent_slot < 0 ? -1 : m_handles[parent_slot];
+}
+
+void transform_hierarchy::sort()
+{
+	int n_slots = (int)m_parents.size();
+
+	// Depth of each live slot. Parents that were destroyed leave their children as roots
+	std::vector<int> depths(n_slots, -1);
+	std::vector<int> chain;
+	int max_depth = 0;
+	for (int i = 0; i < n_slots; ++i)
+	{
+		if (m_handles[i] < 0)
+			continue;
+
+		// Walk up until a slot with a known depth
+		chain.clear();
+		int s = i;
+		while (s >= 0 && m_handles[s] >= 0 && depths[s] < 0)
+		{
+			chain.push_back(s);
+			s = m_parents[s];
+		}
+
+		int depth = (s >= 0 && m_handles[s] >= 0) ? depths[s] : -1;
+		for (size_t k = chain.size(); k-- > 0;)
+			depths[chain[k]] = ++depth;
+		max_depth = glm::max(max_depth, depth);
+	}
+
+	// Counting sort by depth, keeping the order of the slots within a depth
+	std::vector<int> starts(max_depth + 2, 0);
+	for (int i = 0; i < n_slots; ++i)
+		if (depths[i] >= 0)
+			starts[depths[i] + 1]++;
+	for (int d = 0; d <= max_depth; ++d)
+		starts[d + 1] += starts[d];
+	m_depth_starts = starts;
+	m_depths_valid = true;
+
+	std::vector<int> new_slots(n_slots, -1);
+	for (int i = 0; i < n_slots; ++i)
+		if (depths[i] >= 0)
+			new_slots[i] = starts[depths[i]]++;
+
+	// Move every array to the new slots
+	int n_live = n_slots - (int)m_dead;
+	std::vector<int> parents(n_live);
+	std::vector<int> handles(n_live);
+	std::vector<unsigned char> dirty(n_live);
+	std::vector<unsigned char> changed(n_live);
+	trs_arrays trs[2];
+	for (trs_arrays& a : trs)
+	{
+		a.m_positions.resize(n_live);
+		a.m_rotations.resize(n_live);
+		a.m_scales.resize(n_live);
+	}
+
+	for (int i = 0; i < n_slots; ++i)
+	{
+		int slot = new_slots[i];
+		if (slot < 0)
+			continue;
+
+		// Children of a destroyed parent become roots and have to be recomputed
+		int parent = m_parents[i];
+		bool orphan = parent >= 0 && m_handles[parent] < 0;
+		parents[slot] = (parent >= 0 && !orphan) ? new_slots[parent] : -1;
+		dirty[slot] = m_dirty[i] | (orphan ? 1 : 0);
+		changed[slot] = m_changed[i];
+		handles[slot] = m_handles[i];
+		m_slots[m_handles[i]] = slot;
+		for (int s = 0; s < 2; ++s)
+		{
+			trs[s].m_positions[slot] = m_trs[s].m_positions[i];
+			trs[s].m_rotations[slot] = m_trs[s].m_rotations[i];
+			trs[s].m_scales[slot] = m_trs[s].m_scales[i];
+		}
+	}
+
+	m_parents.swap(parents);
+	m_handles.swap(handles);
+	m_dirty.swap(dirty);
+	m_changed.swap(changed);
+	for (int s = 0; s < 2; ++s)
+	{
+		m_trs[s].m_positions.swap(trs[s].m_positions);
+		m_trs[s].m_rotations.swap(trs[s].m_rotations);
+		m_trs[s].m_scales.swap(trs[s].m_scales);
+	}
+	m_dead = 0;
+	m_sorted = true;
+}
+
+void transform_hierarchy::update_world()
+{
+	if (!m_sorted)
+		sort();
+
+	// Small hierarchies or a single thread, one forward loop
+	const size_t parallel_slots = 4096;
+	size_t n_slots = m_parents.size();
+	if (g_jobs.thread_count() == 1 || n_slots < parallel_slots)
+	{
+		m_recomputed = update_range(0, n_slots);
+		return;
+	}
+
+	// The slots of a depth only read their parents, which are one depth up,
+	// so the slots of each depth are updated in parallel
+	if (!m_depths_valid)
+		sort();
+	std::atomic<unsigned> recomputed(0);
+	for (size_t d = 0; d + 1 < m_depth_starts.size(); ++d)
+	{
+		size_t first = m_depth_starts[d];
+		g_jobs.parallel_for(m_depth_starts[d + 1] - first, 1024, [&](size_t begin, size_t end) {
+			recomputed += update_range(first + begin, first + end);
+		});
+	}
+	m_recomputed = recomputed;
+}
+
+unsigned transform_hierarchy::update_range(size_t begin, size_t end)
+{
+	const glm::vec3* local_pos = m_trs[local].m_positions.data();
+	const glm::quat* local_rot = m_trs[local].m_rotations.data();
+	const glm::vec3* local_scale = m_trs[local].m_scales.data();
+	glm::vec3* world_pos = m_trs[world].m_positions.data();
+	glm::quat* world_rot = m_trs[world].m_rotations.data();
+	glm::vec3* world_scale = m_trs[world].m_scales.data();
+	const int* parents = m_parents.data();
+	unsigned char* dirty = m_dirty.data();
+	unsigned char* changed = m_changed.data();
+
+	// The parent of each slot is already updated when the slot is reached,
+	// so a slot changes when it is dirty or when its parent changed
+	unsigned recomputed = 0;
+	for (size_t i = begin; i < end; ++i)
+	{
+		int p = parents[i];
+		changed[i] = dirty[i] | (p >= 0 ? changed[p] : 0);
+		if (changed[i] == 0)
+			continue;
+		dirty[i] = 0;
+		recomputed++;
+
+		if (p < 0)
+		{
+			world_pos[i] = local_pos[i];
+			world_rot[i] = local_rot[i];
+			world_scale[i] = local_scale[i];
+			continue;
+		}
+
+		// Same as transform::concatenate
+		world_scale[i] = world_scale[p] * local_scale[i];
+		world_rot[i] = world_rot[p] * local_rot[i];
+		world_pos[i] = world_rot[p] * (world_scale[p] * local_pos[i]) + world_pos[p];
+	}
+	return recomputed;
+}
+
+transform_handle& transform_handle::operator=(const transform& rhs)
+{
+	set_position(rhs.get_position());
+	set_rotation(rhs.get_rotation());
+	set_scale(rhs.get_scale());
+	return *this;
+}
+
+transform_handle::operator transform() const
+{
+	transform t;
+	t.set_position(get_position());
+	t.set_rotation(get_rotation());
+	t.set_scale(get_scale());
+	return t;
+}
+
+void transform_handle::set_transform(const glm::mat4& trs)
+{
+	transform t;
+	t.set_transform(trs);
+	*this = t;
+}
+
+void transform_handle::imgui()
+{
+	// Edit a copy so the node is only marked dirty when a value changes
+	transform t = *this;
+	bool edited = false;
+	ImGui::Text("Position");
+	edited |= ImGui::DragFloat3("T", &t.get_position()[0]);
+	ImGui::Separator();
+	ImGui::Text("Rotation");
+	edited |= ImGui::DragFloat4("R", &t.get_rotation()[0]);
+	ImGui::Separator();
+	ImGui::Text("Scale");
+	edited |= ImGui::DragFloat3("S", &t.get_scale()[0]);
+	if (edited)
+		*this = t;
+}
+}
@@ -0,0 +1,151 @@
+/**
+* @file transform_hierarchy.h
+* @date 2026/10/17
+*/
+#pragma once
+#include <vector>
+#include "transform.h"
+
+namespace cs460 {
+// Local and world transforms of every node stored as flat arrays. Slots are kept
+// sorted so a parent always comes before its children, which lets the world
+// transforms be computed with a single forward loop instead of a recursion.
+// Only the slots marked dirty and their descendants are recomputed
+class transform_hierarchy
+{
+public:
+	static transform_hierarchy& get_instance();
+
+	// Creates a root transform and returns its handle
+	int create();
+	void destroy(int handle);
+
+	// Attaches the transform to a parent (-1 to make it a root)
+	void set_parent(int handle, int parent);
+	int get_parent(int handle) const;
+
+	// Computes the world transform of the dirty slots and their descendants. Large
+	// hierarchies are updated one depth at a time, each depth split across the jobs
+	void update_world();
+
+	// The world transform was recomputed by the last update
+	bool world_changed(int handle) const { return m_changed[m_slots[handle]] != 0; }
+
+	// Forces the world transform of the slot and its descendants to be recomputed
+	void set_dirty(int handle) { m_dirty[m_slots[handle]] = 1; }
+
+	// Number of live transforms and of world transforms recomputed by the last update
+	unsigned size() const { return (unsigned)(m_parents.size() - m_dead); }
+	unsigned recomputed() const { return m_recomputed; }
+
+	enum space { local, world };
+
+	// Non const access does not mark the slot dirty, call set_dirty after writing
+	glm::vec3& position(int handle, space s) { return m_trs[s].m_positions[m_slots[handle]]; }
+	glm::quat& rotation(int handle, space s) { return m_trs[s].m_rotations[m_slots[handle]]; }
+	glm::vec3& scale(int handle, space s) { return m_trs[s].m_scales[m_slots[handle]]; }
+
+	const glm::vec3& position(int handle, space s) const { return m_trs[s].m_positions[m_slots[handle]]; }
+	const glm::quat& rotation(int handle, space s) const { return m_trs[s].m_rotations[m_slots[handle]]; }
+	const glm::vec3& scale(int handle, space s) const { return m_trs[s].m_scales[m_slots[handle]]; }
+
+private:
+	// Sorts the slots by depth and removes the destroyed ones
+	void sort();
+
+	// Computes the world transforms of the slots in [begin, end), returns how many changed
+	unsigned update_range(size_t begin, size_t end);
+
+	struct trs_arrays
+	{
+		std::vector<glm::vec3> m_positions;
+		std::vector<glm::quat> m_rotations;
+		std::vector<glm::vec3> m_scales;
+	};
+	trs_arrays m_trs[2];
+
+	// Slot of the parent of each slot (-1 for roots)
+	std::vector<int> m_parents;
+
+	// Local transform written since the last update, world transform recomputed by it
+	std::vector<unsigned char> m_dirty;
+	std::vector<unsigned char> m_changed;
+	unsigned m_recomputed = 0;
+
+	// Handle of each slot (-1 if destroyed) and slot of each handle
+	std::vector<int> m_handles;
+	std::vector<int> m_slots;
+	std::vector<int> m_free_handles;
+
+	// Some parent is after its child or some slot was destroyed
+	bool m_sorted = true;
+	unsigned m_dead = 0;
+
+	// First slot of each depth, set by the sort. Creating or moving a slot can
+	// break the grouping, so the parallel update sorts again first
+	std::vector<int> m_depth_starts;
+	bool m_depths_valid = false;
+};
+
+#define g_transforms transform_hierarchy::get_instance()
+
+// Accesses one of the transforms of a node in the hierarchy with the same
+// interface as a transform. References returned by the getters are valid until
+// a transform is created or the world transforms are updated. Only the setters
+// mark the node dirty, a world transform set directly is recomputed by the next update
+class transform_handle
+{
+public:
+	transform_handle(int handle, transform_hierarchy::space s) : m_handle(handle), m_space(s) {}
+	transform_handle(const transform_handle&) = delete;
+
+	// Copies the values, the handle is not changed
+	transform_handle& operator=(const transform& rhs);
+	transform_handle& operator=(const transform_handle& rhs) { return *this = (transform)rhs; }
+	operator transform() const;
+
+	int get_handle() const { return m_handle; }
+
+	// Setting the value the transform already has does not mark the node dirty
+	void set_position(const glm::vec3& pos) { set(get_position(), pos); }
+	void set_rotation(const glm::quat& rot) { set(get_rotation(), rot); }
+	void set_scale(const glm::vec3& scale) { set(get_scale(), scale); }
+	void set_transform(const glm::mat4& trs);
+
+	// The world transform of the node was recomputed by the last update
+	bool changed() const { return g_transforms.world_changed(m_handle); }
+
+	// Writes through these references are not seen by the next update, use the setters
+	glm::vec3& get_position() { return g_transforms.position(m_handle, m_space); }
+	glm::quat& get_rotation() { return g_transforms.rotation(m_handle, m_space); }
+	glm::vec3& get_scale() { return g_transforms.scale(m_handle, m_space); }
+
+	const glm::vec3& get_position() const { return hierarchy().position(m_handle, m_space); }
+	const glm::quat& get_rotation() const { return hierarchy().rotation(m_handle, m_space); }
+	const glm::vec3& get_scale() const { return hierarchy().scale(m_handle, m_space); }
+
+	glm::mat4 compute_matrix() const { return ((transform)*this).compute_matrix(); }
+	glm::mat4 compute_inv_matrix() const { return ((transform)*this).compute_inv_matrix(); }
+
+	void imgui();
+
+	transform concatenate(const transform& rhs) const { return ((transform)*this).concatenate(rhs); }
+	transform inv_concatenate(const transform& rhs) const { return ((transform)*this).inv_concatenate(rhs); }
+
+private:
+	static const transform_hierarchy& hierarchy() { return g_transforms; }
+
+	template <typename T>
+	void set(T& value, const T& new_value)
+	{
+		if (value != new_value)
+		{
+			value = new_value;
+			g_transforms.set_dirty(m_handle);
+		}
+	}
+
+	int m_handle;
+	transform_hierarchy::space m_space;
+};
+}